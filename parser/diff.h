@@ -0,0 +1,179 @@
+#pragma once
+
+#include <stdint.h>
+#include <deque>
+#include <exception>
+#include <unordered_map>
+#include <vector>
+#include "string_view.h"
+#include "tree.h"
+
+namespace xml
+{
+    // This namespace compares two versions of a document (e.g., a config
+    // file before and after it was reloaded), and lists the elements that
+    // were added, removed or changed.  Subtrees that are the same in both
+    // are recognized by their hashes (see tree::document::compute_hashes())
+    // and skipped in constant time, so the comparison costs time in
+    // proportion to the changes (and the siblings of the changed elements),
+    // rather than to the size of the documents.
+    namespace diff
+    {
+        enum change_kind { element_added, element_removed, element_changed };
+
+        // A difference between the documents.  'before' is empty for added
+        // elements, and 'after' for removed ones.  An element is changed if
+        // it has the same name in both, but its attributes or text differ
+        // (changes of its descendants are listed separately, and don't make
+        // it changed).
+        struct change
+        {
+            change_kind kind;
+            tree::element before;
+            tree::element after;
+        };
+
+        // Returns the text without leading and trailing whitespace.
+        inline util::string_view trim(const std::string& text)
+        {
+            size_t first = text.find_first_not_of(" \t\r\n");
+            if (first == std::string::npos) return util::string_view();
+
+            size_t last = text.find_last_not_of(" \t\r\n");
+            return util::string_view(text.data() + first, last + 1 - first);
+        }
+
+        // Returns true if two elements have the same attributes (in any
+        // order) and text, regardless of their children.  Whitespace around
+        // the text is ignored, so that adding or removing children (along
+        // with their indentation) doesn't make the parent changed.
+        inline bool same_content(const tree::element& a, const tree::element& b)
+        {
+            size_t count = 0;
+            for (auto x : a.attributes())
+            {
+                bool found = false;
+                for (auto y : b.attributes())
+                {
+                    if (x.name() == y.name())
+                    {
+                        found = x.value() == y.value();
+                        break;
+                    }
+                }
+                if (!found) return false;
+                count++;
+            }
+
+            for (auto y : b.attributes())
+            {
+                if (count-- == 0) return false;
+            }
+            std::string a_text = a.text(), b_text = b.text();
+            return trim(a_text) == trim(b_text);
+        }
+
+        // Compares two elements that have the same name (and different
+        // hashes), and appends the differences.
+        inline void compare(const tree::element& a, const tree::element& b, std::vector<change>& changes)
+        {
+            if (!same_content(a, b))
+            {
+                change c = { element_changed, a, b };
+                changes.push_back(c);
+            }
+
+            std::vector<tree::element> before, after;
+            for (auto e : a.elements()) before.push_back(e);
+            for (auto e : b.elements()) after.push_back(e);
+
+            // The children that are the same at the start and the end (which
+            // are usually most of them) are skipped first.
+            size_t first = 0;
+            size_t before_last = before.size(), after_last = after.size();
+            while (first < before_last && first < after_last && before[first].hash() == after[first].hash()) first++;
+            while (before_last > first && after_last > first && before[before_last - 1].hash() == after[after_last - 1].hash())
+            {
+                before_last--;
+                after_last--;
+            }
+
+            // Children that are the same elsewhere (e.g., if siblings were
+            // moved) are matched by hash.
+            std::unordered_multimap<uint64_t, size_t> unmatched;
+            for (size_t i = first; i < after_last; i++) unmatched.insert(std::make_pair(after[i].hash(), i));
+
+            std::vector<bool> matched(after.size(), false);
+            std::vector<size_t> changed;
+            for (size_t i = first; i < before_last; i++)
+            {
+                auto it = unmatched.find(before[i].hash());
+                if (it == unmatched.end())
+                {
+                    changed.push_back(i);
+                    continue;
+                }
+
+                matched[it->second] = true;
+                unmatched.erase(it);
+            }
+
+            // The other children are paired by name, in order, and compared,
+            // and those that are left over were removed or added.
+            std::unordered_map<util::string_view, std::deque<size_t>> by_name;
+            for (size_t i = first; i < after_last; i++)
+            {
+                if (!matched[i]) by_name[after[i].name()].push_back(i);
+            }
+
+            for (auto i : changed)
+            {
+                auto it = by_name.find(before[i].name());
+                if (it == by_name.end() || it->second.empty())
+                {
+                    change c = { element_removed, before[i], tree::element() };
+                    changes.push_back(c);
+                    continue;
+                }
+
+                size_t j = it->second.front();
+                it->second.pop_front();
+                matched[j] = true;
+                compare(before[i], after[j], changes);
+            }
+
+            for (size_t i = first; i < after_last; i++)
+            {
+                if (matched[i]) continue;
+
+                change c = { element_added, tree::element(), after[i] };
+                changes.push_back(c);
+            }
+        }
+
+        // Returns the differences between two documents, in the order of
+        // the first (each parent's added elements follow its other
+        // changes).  Both documents must have hashes (see compute_hashes()).
+        inline std::vector<change> compare(const tree::document& before, const tree::document& after)
+        {
+            if (!before.has_hashes() || !after.has_hashes()) throw std::exception("Both documents must have hashes");
+
+            std::vector<change> changes;
+            tree::element a = before.root(), b = after.root();
+            if (a.hash() == b.hash()) return changes;
+
+            if (a.name() == b.name())
+            {
+                compare(a, b, changes);
+            }
+            else
+            {
+                change removed = { element_removed, a, tree::element() };
+                change added = { element_added, tree::element(), b };
+                changes.push_back(removed);
+                changes.push_back(added);
+            }
+            return changes;
+        }
+    }
+}
\ No newline at end of file
@@ -0,0 +1,248 @@
+#pragma once
+
+#include <stdint.h>
+#include <exception>
+#include <functional>
+#include <future>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include "mapped_file.h"
+#include "name_table.h"
+#include "snapshot.h"
+#include "string_pool.h"
+#include "string_view.h"
+#include "tree.h"
+
+namespace xml
+{
+    // This class caches parsed documents by their content, so that
+    // components that load the same XML independently share one parsed
+    // copy, rather than each parsing it.  The key is a checksum of the
+    // source (see tree::snapshot::checksum()) and its size, so identical
+    // sources are parsed once no matter where they come from.  The checksum
+    // isn't cryptographic (different sources with the same checksum are
+    // easy to make), so each entry also keeps a copy of its source, which
+    // is compared on every hit.  A source that only has the same key as a
+    // cached one is parsed without being cached.
+    //
+    // The documents are immutable (they're returned as pointers to const),
+    // and are kept within a memory budget (see tree::document::memory_size())
+    // by evicting the least recently used ones.  Evicted documents remain
+    // valid for as long as they are referred to.  When several threads ask
+    // for the same source at once, it is only parsed by the first, and the
+    // others wait for its result (or exception).
+    //
+    // All of the documents share the cache's (thread-safe) name_table, so
+    // names have the same IDs in all of them (e.g., for xpath queries).
+    // Names aren't removed from the table when documents are evicted.  The
+    // documents can also share a string_pool, so that their common values
+    // are stored once (which are also kept after the documents are evicted,
+    // and aren't counted in the memory budget).
+    class document_cache
+    {
+    public:
+        typedef std::shared_ptr<const tree::document> document_ptr;
+
+    private:
+        struct key
+        {
+            uint64_t checksum;
+            uint64_t size;
+
+            bool operator== (const key& rhs) const { return checksum == rhs.checksum && size == rhs.size; }
+        };
+
+        struct key_hash
+        {
+            size_t operator() (const key& k) const { return static_cast<size_t>(k.checksum); }
+        };
+
+        struct entry
+        {
+            std::shared_future<document_ptr> doc;
+            std::shared_ptr<const std::string> source;
+
+            // The document's memory_size() plus the size of the source, 
+            // once it has been parsed.
+            size_t size;
+            bool ready;
+
+            // Identifies the entry, in case it is replaced by another one 
+            // with the same key (after clear()) while it is being parsed.
+            uint64_t serial;
+
+            // The entry's position in the LRU list.
+            std::list<key>::iterator position;
+        };
+
+        std::shared_ptr<name_table> _names;
+        std::shared_ptr<string_pool> _pool;
+        std::mutex mutex;
+        std::unordered_map<key, entry, key_hash> entries;
+
+        // The keys, from the most to the least recently used.
+        std::list<key> lru;
+
+        size_t budget;
+        size_t used;
+        uint64_t next_serial;
+
+        document_cache(const document_cache&);
+        document_cache& operator= (const document_cache&);
+
+        // Removes the least recently used documents until the total size is
+        // within the budget.  Documents that are still being parsed are
+        // skipped.  The mutex must be locked.
+        void evict()
+        {
+            auto it = lru.end();
+            while (used > budget && it != lru.begin())
+            {
+                --it;
+                auto e = entries.find(*it);
+                if (!e->second.ready) continue;
+
+                used -= e->second.size;
+                entries.erase(e);
+                it = lru.erase(it);
+            }
+        }
+
+        // Returns the document with the specified key and source, calling 
+        // 'parse' to create it if it isn't in the cache (or being parsed 
+        // already).
+        document_ptr find(const key& k, const util::string_view& content, const std::function<document_ptr()>& parse)
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+
+            auto it = entries.find(k);
+            if (it != entries.end())
+            {
+                std::shared_future<document_ptr> doc = it->second.doc;
+                std::shared_ptr<const std::string> source = it->second.source;
+                lock.unlock();
+
+                // The source is immutable, so it's compared without the 
+                // lock.
+                if (util::string_view(*source) != content) return parse();
+
+                lock.lock();
+                it = entries.find(k);
+                if (it != entries.end()) lru.splice(lru.begin(), lru, it->second.position);
+                lock.unlock();
+                return doc.get();
+            }
+
+            std::promise<document_ptr> result;
+            lru.push_front(k);
+            entry& e = entries[k];
+            e.doc = result.get_future().share();
+            e.source = std::make_shared<const std::string>(content.data(), content.size());
+            e.size = 0;
+            e.ready = false;
+            e.serial = next_serial++;
+            e.position = lru.begin();
+
+            uint64_t serial = e.serial;
+            lock.unlock();
+
+            document_ptr doc;
+            try
+            {
+                doc = parse();
+            }
+            catch (...)
+            {
+                // The threads that are waiting get the exception, and later
+                // calls try again.
+                result.set_exception(std::current_exception());
+                lock.lock();
+                it = entries.find(k);
+                if (it != entries.end() && it->second.serial == serial)
+                {
+                    lru.erase(it->second.position);
+                    entries.erase(it);
+                }
+                throw;
+            }
+
+            result.set_value(doc);
+            lock.lock();
+
+            // The entry may have been removed by clear() in the meantime.
+            it = entries.find(k);
+            if (it != entries.end() && it->second.serial == serial)
+            {
+                it->second.ready = true;
+                it->second.size = doc->memory_size() + content.size();
+                used += it->second.size;
+                evict();
+            }
+            return doc;
+        }
+
+        document_ptr parse(const util::string_view& content)
+        {
+            util::string_view data(content);
+            return std::make_shared<tree::document>(data, _names, _pool);
+        }
+
+    public:
+        explicit document_cache(size_t memory_budget = 256 * 1024 * 1024,
+            const std::shared_ptr<string_pool>& pool = std::shared_ptr<string_pool>())
+            : _names(std::make_shared<name_table>(true)), _pool(pool), budget(memory_budget), used(0), next_serial(0)
+        {
+        }
+
+        // Returns the document parsed from the specified source, parsing it
+        // if it isn't cached.  Throws the parser's exceptions (as do other
+        // calls for the same source that are waiting for it).
+        document_ptr get(const util::string_view& content)
+        {
+            key k = { tree::snapshot::checksum(content), content.size() };
+            return find(k, content, [&]() { return parse(content); });
+        }
+
+        // The same as above, for the contents of a file, which is mapped
+        // rather than read.  The checksum is computed on the mapped file,
+        // which also brings it into memory for the parser in the case of a
+        // miss.
+        document_ptr get_file(const std::string& path)
+        {
+            util::mapped_file file(path);
+            return get(util::string_view(file.data(), file.size()));
+        }
+
+        // Removes all of the documents.
+        void clear()
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            entries.clear();
+            lru.clear();
+            used = 0;
+        }
+
+        // Returns the number of cached documents (including those that are
+        // being parsed).
+        size_t size()
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            return entries.size();
+        }
+
+        // Returns the total memory_size() of the cached documents, plus the 
+        // sizes of their sources.
+        size_t memory_size()
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            return used;
+        }
+
+        name_table& names() const { return *_names; }
+        const std::shared_ptr<name_table>& shared_names() const { return _names; }
+        const std::shared_ptr<string_pool>& pool() const { return _pool; }
+    };
+}
\ No newline at end of file
@@ -0,0 +1,277 @@
+#pragma once
+
+#include <string.h>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <streambuf>
+#include <string>
+#include <thread>
+#include <vector>
+#include "scan.h"
+#include "tree.h"
+
+namespace xml
+{
+    // This class splits a stream of complete XML documents, written back to
+    // back (each with its own optional prolog), into separate documents.
+    // The boundaries are found by scanning the raw bytes with xml::scan,
+    // without parsing, so the data must be in an encoding where ASCII
+    // characters are single bytes (i.e., UTF-8 or ISO-8859-1).  Only the
+    // current document (and what has been read after it) is buffered; the
+    // bytes of earlier documents are released as the stream moves on.
+    //
+    // The documents built by next_document() (or parse_parallel()) share a
+    // thread-safe name_table, so names have the same IDs in all of them.
+    class document_stream
+    {
+        std::streambuf& source;
+        std::string buffer;
+
+        // The offset of the next document in the buffer.
+        size_t start;
+
+        size_t chunk_size;
+        std::shared_ptr<name_table> _names;
+
+        document_stream(const document_stream&);
+        document_stream& operator= (const document_stream&);
+
+        // Reads up to 'n' more bytes into the buffer, and returns false if
+        // there aren't any.
+        bool fill(size_t n)
+        {
+            size_t size = buffer.size();
+            buffer.resize(size + n);
+            std::streamsize count = source.sgetn(&buffer[size], static_cast<std::streamsize>(n));
+            buffer.resize(size + static_cast<size_t>(count));
+            return count > 0;
+        }
+
+        static bool is_space(char c)
+        {
+            return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+        }
+
+        enum scan_result { found_document, incomplete, no_document };
+
+        // Looks for the next document after 'first', and sets 'begin' and 
+        // 'end' to its offsets.  The document ends at the end of the root 
+        // element's close tag.  It normally begins at 'first', so comments 
+        // and PIs that follow the previous document become part of its 
+        // prolog, but a BOM or an XML declaration must be at the start of a 
+        // document, so if there is one, the document begins there (e.g., 
+        // for files that were concatenated, where the BOM of each one 
+        // follows the newline at the end of the previous one).  Returns 
+        // no_document if there's nothing but whitespace, comments and PIs 
+        // before 'last'.
+        static scan_result find_document(const char* first, const char* last, size_t& begin, size_t& end)
+        {
+            const char* p = first;
+            const char* doc = first;
+
+            // Where the document's content starts (i.e., after its BOM).
+            const char* content = first;
+            bool markup = false;
+            bool declaration = false;
+
+            while (true)
+            {
+                while (p != last && is_space(*p)) ++p;
+                if (p == last) return no_document;
+
+                if (*p == '\xEF' && !markup && content == first)
+                {
+                    if (last - p < 3) return incomplete;
+                    if (memcmp(p, "\xEF\xBB\xBF", 3) == 0)
+                    {
+                        doc = p;
+                        p += 3;
+                        content = p;
+                        continue;
+                    }
+                }
+
+                if (*p != '<') throw std::exception("Unexpected data between XML documents");
+                if (last - p < 2) return incomplete;
+
+                if (p[1] == '?')
+                {
+                    if (last - p >= 6 && memcmp(p, "<?xml", 5) == 0 && is_space(p[5]) && !declaration)
+                    {
+                        declaration = true;
+                        if (p != content) doc = p;
+                    }
+
+                    markup = true;
+                    p += 2;
+                    if (!scan::skip_past(p, last, "?>")) return incomplete;
+                }
+                else if (p[1] == '!')
+                {
+                    markup = true;
+                    p += 2;
+                    if (last - p < 2) return incomplete;
+                    if (!scan::skip_past(p, last, p[0] == '-' && p[1] == '-' ? "-->" : ">")) return incomplete;
+                }
+                else
+                {
+                    ++p;
+                    if (!scan::skip_element(p, last)) return incomplete;
+
+                    begin = doc - first;
+                    end = p - first;
+                    return found_document;
+                }
+            }
+        }
+
+    public:
+        explicit document_stream(std::streambuf& s, size_t chunk = 64 * 1024)
+            : source(s), start(0), chunk_size(chunk), _names(std::make_shared<name_table>(true))
+        {
+        }
+
+        // Copies the bytes of the next document into 'data', and returns
+        // false if there are no more documents.
+        bool next(std::string& data)
+        {
+            // Releasing consumed documents moves the rest of the buffer, so
+            // it's only done once they make up at least half of it.
+            if (start > 0 && start >= buffer.size() / 2)
+            {
+                buffer.erase(0, start);
+                start = 0;
+            }
+
+            while (true)
+            {
+                const char* first = buffer.data() + start;
+                size_t begin, end;
+                scan_result result = find_document(first, buffer.data() + buffer.size(), begin, end);
+
+                if (result == found_document)
+                {
+                    data.assign(first + begin, end - begin);
+                    start += end;
+                    return true;
+                }
+
+                // The document is scanned again from its start after more
+                // data is read, so at least as much as is already buffered
+                // is read each time, to keep the total linear.
+                size_t pending = buffer.size() - start;
+                if (!fill(pending > chunk_size ? pending : chunk_size))
+                {
+                    if (result == incomplete) throw std::exception("Incomplete XML document at the end of the stream");
+
+                    // Only whitespace, comments and PIs are left.
+                    buffer.clear();
+                    start = 0;
+                    return false;
+                }
+            }
+        }
+
+        // Parses the next document, and returns null if there are no more.
+        std::shared_ptr<tree::document> next_document()
+        {
+            std::string data;
+            if (!next(data)) return nullptr;
+            return std::make_shared<tree::document>(data, _names);
+        }
+
+        name_table& names() const { return *_names; }
+        const std::shared_ptr<name_table>& shared_names() const { return _names; }
+    };
+
+    // Reads the documents of a stream on the calling thread, and parses
+    // them on 'threads' worker threads, which pass each document to 'f' as
+    // it's built.  The documents are passed in no particular order, and 'f'
+    // may be called from several threads at once.  At most two documents
+    // per thread are waiting to be parsed at any time, so memory use doesn't
+    // depend on the length of the stream.  If reading, parsing or 'f' throws,
+    // the workers stop and the first exception is rethrown.
+    inline void parse_parallel(document_stream& stream, size_t threads, const std::function<void(const std::shared_ptr<tree::document>&)>& f)
+    {
+        assert(threads > 0);
+
+        std::mutex mutex;
+        std::condition_variable ready, space;
+        std::deque<std::string> queue;
+        bool done = false;
+        std::exception_ptr error;
+        std::shared_ptr<name_table> names = stream.shared_names();
+
+        auto fail = [&]()
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (!error) error = std::current_exception();
+            done = true;
+            queue.clear();
+            ready.notify_all();
+            space.notify_all();
+        };
+
+        auto worker = [&]()
+        {
+            while (true)
+            {
+                std::string data;
+                {
+                    std::unique_lock<std::mutex> lock(mutex);
+                    ready.wait(lock, [&]() { return !queue.empty() || done; });
+                    if (queue.empty()) return;
+
+                    data.swap(queue.front());
+                    queue.pop_front();
+                    space.notify_one();
+                }
+
+                try
+                {
+                    f(std::make_shared<tree::document>(data, names));
+                }
+                catch (...)
+                {
+                    fail();
+                    return;
+                }
+            }
+        };
+
+        std::vector<std::thread> workers;
+        for (size_t i = 0; i < threads; i++) workers.push_back(std::thread(worker));
+
+        try
+        {
+            std::string data;
+            while (stream.next(data))
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                space.wait(lock, [&]() { return queue.size() < threads * 2 || done; });
+                if (done) break;
+
+                queue.push_back(std::string());
+                queue.back().swap(data);
+                ready.notify_one();
+            }
+        }
+        catch (...)
+        {
+            fail();
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            done = true;
+            ready.notify_all();
+        }
+
+        for (auto& t : workers) t.join();
+        if (error) std::rethrow_exception(error);
+    }
+}
\ No newline at end of file
@@ -0,0 +1,110 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdexcept>
+#include <string>
+
+#if defined(_WIN32)
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace util
+{
+    // This class maps a whole file into memory, read-only, for as long as
+    // it exists (with MapViewOfFile on Windows, and mmap elsewhere).  Pages
+    // are only read from the file when they're first accessed, so opening a
+    // file takes the same time regardless of its size.
+    class mapped_file
+    {
+#if defined(_WIN32)
+        HANDLE file;
+        HANDLE mapping;
+#else
+        int fd;
+#endif
+        const char* ptr;
+        size_t len;
+
+        mapped_file(const mapped_file&);
+        mapped_file& operator= (const mapped_file&);
+
+        void close()
+        {
+#if defined(_WIN32)
+            if (ptr) UnmapViewOfFile(ptr);
+            if (mapping) CloseHandle(mapping);
+            if (file != INVALID_HANDLE_VALUE) CloseHandle(file);
+#else
+            if (ptr) munmap(const_cast<char*>(ptr), len);
+            if (fd != -1) ::close(fd);
+#endif
+        }
+
+    public:
+        // Throws std::runtime_error if the file can't be opened or mapped.
+        explicit mapped_file(const std::string& path)
+            : ptr(nullptr), len(0)
+        {
+#if defined(_WIN32)
+            mapping = NULL;
+            file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+            if (file == INVALID_HANDLE_VALUE) throw std::runtime_error("Can't open the file");
+
+            LARGE_INTEGER size;
+            if (!GetFileSizeEx(file, &size))
+            {
+                close();
+                throw std::runtime_error("Can't get the size of the file");
+            }
+            len = static_cast<size_t>(size.QuadPart);
+
+            // Empty files can't be mapped.
+            if (len == 0) return;
+
+            mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+            if (mapping) ptr = static_cast<const char*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+#else
+            fd = ::open(path.c_str(), O_RDONLY);
+            if (fd == -1) throw std::runtime_error("Can't open the file");
+
+            struct stat st;
+            if (fstat(fd, &st) != 0)
+            {
+                close();
+                throw std::runtime_error("Can't get the size of the file");
+            }
+            len = static_cast<size_t>(st.st_size);
+
+            // Empty files can't be mapped.
+            if (len == 0) return;
+
+            void* p = mmap(nullptr, len, PROT_READ, MAP_SHARED, fd, 0);
+            if (p != MAP_FAILED) ptr = static_cast<const char*>(p);
+#endif
+            if (!ptr)
+            {
+                close();
+                throw std::runtime_error("Can't map the file");
+            }
+        }
+
+        ~mapped_file()
+        {
+            close();
+        }
+
+        const char* data() const { return ptr; }
+        size_t size() const { return len; }
+    };
+}
\ No newline at end of file
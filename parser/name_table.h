@@ -0,0 +1,93 @@
+#pragma once
+
+#include <assert.h>
+#include <stdint.h>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include "string_view.h"
+
+namespace xml
+{
+    // Small integer that identifies a name within a name_table.
+    typedef uint32_t name_id;
+
+    // Returned by name_table::find() for names that haven't been interned.
+    const name_id no_name = 0xFFFFFFFF;
+
+    // This class maps element and attribute names to name_id's, so that each
+    // distinct name is stored once per table, no matter how many times it
+    // appears in a document, and names can be compared as integers.  IDs are
+    // assigned in order, starting at 0, and are never reused.  The views
+    // returned by name() remain valid for the lifetime of the table.
+    //
+    // A table can be shared by several documents (e.g., through a
+    // std::shared_ptr), in which case equal names have equal IDs across all
+    // of them.  Tables that are used from several threads at once must be
+    // created as thread-safe, which makes every call take a lock.
+    class name_table
+    {
+        // A deque never moves its elements, so the views used as keys (and
+        // returned by name()) stay valid as names are added.
+        std::deque<std::string> names;
+        std::unordered_map<util::string_view, name_id> ids;
+        mutable std::mutex mutex;
+        bool thread_safe;
+
+        name_table(const name_table&);
+        name_table& operator= (const name_table&);
+
+        // Locks the table's mutex, if it is thread-safe.
+        class guard
+        {
+            std::mutex* m;
+
+        public:
+            guard(const name_table& t) : m(t.thread_safe ? &t.mutex : nullptr) { if (m) m->lock(); }
+            ~guard() { if (m) m->unlock(); }
+        };
+
+    public:
+        explicit name_table(bool locked = false) : thread_safe(locked) {}
+
+        // Returns the ID of a name, adding it to the table if necessary.
+        name_id intern(const util::string_view& name)
+        {
+            guard lock(*this);
+
+            auto it = ids.find(name);
+            if (it != ids.end()) return it->second;
+
+            name_id id = static_cast<name_id>(names.size());
+            names.push_back(name.str());
+            ids.insert(std::make_pair(util::string_view(names.back()), id));
+            return id;
+        }
+
+        // Returns the ID of a name, or no_name if it isn't in the table.
+        // This is used for lookups, which shouldn't grow the table.
+        name_id find(const util::string_view& name) const
+        {
+            guard lock(*this);
+
+            auto it = ids.find(name);
+            return it == ids.end() ? no_name : it->second;
+        }
+
+        // Returns the name with the specified ID.
+        util::string_view name(name_id id) const
+        {
+            guard lock(*this);
+
+            assert(id < names.size());
+            return util::string_view(names[id]);
+        }
+
+        size_t size() const
+        {
+            guard lock(*this);
+            return names.size();
+        }
+    };
+}
\ No newline at end of file
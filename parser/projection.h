@@ -0,0 +1,307 @@
+#pragma once
+
+#include <stdint.h>
+#include <algorithm>
+#include <exception>
+#include <memory>
+#include <vector>
+#include "unicode\unicode.h"
+#include "grammar.h"
+#include "name_table.h"
+#include "reader.h"
+#include "scan.h"
+#include "tree.h"
+#include "xpath.h"
+
+namespace xml
+{
+    // This namespace contains a streaming parser that extracts the parts of
+    // a document selected by a set of paths, without building the rest.
+    // The paths are compiled into an automaton, which is run on each start
+    // tag as the document is parsed, and subtrees that none of the paths can
+    // reach are skipped with xml::scan instead of being parsed.
+    namespace projection
+    {
+        // A set of absolute paths, in the syntax of xml::xpath, without
+        // predicates (which would require reading an element's attributes
+        // before deciding whether its content can be skipped), e.g.:
+        //
+        //   /apiconfig/sndeventlist/event/@msgtype
+        //   //event/*
+        //
+        // The automaton is immutable once the paths have been added, and can
+        // be shared by any number of parses (on any number of threads, if
+        // its name_table is thread-safe).
+        class automaton
+        {
+        public:
+            // A position within a path, i.e., the index of the next step
+            // to be matched.
+            struct state
+            {
+                uint32_t path;
+                uint32_t step;
+            };
+
+        private:
+            typedef xpath::query::step step;
+
+            std::shared_ptr<name_table> _names;
+            std::vector<std::vector<step>> paths;
+
+            static void add_state(std::vector<state>& states, size_t first, uint32_t path, uint32_t step)
+            {
+                for (size_t i = first; i < states.size(); i++)
+                {
+                    if (states[i].path == path && states[i].step == step) return;
+                }
+
+                state s = { path, step };
+                states.push_back(s);
+            }
+
+            static void add_match(std::vector<size_t>& matched, size_t path)
+            {
+                if (std::find(matched.begin(), matched.end(), path) == matched.end()) matched.push_back(path);
+            }
+
+        public:
+            explicit automaton(const std::shared_ptr<name_table>& names = std::make_shared<name_table>())
+                : _names(names)
+            {
+            }
+
+            // Adds a path, and returns its index, which identifies it in the
+            // results of parse().  Throws xpath::syntax_error for invalid
+            // paths.
+            size_t add(const util::string_view& path)
+            {
+                xpath::query q(path, *_names);
+                if (!q.is_absolute()) throw std::exception("Projection paths must be absolute");
+
+                for (auto& s : q.get_steps())
+                {
+                    if (!s.predicates.empty()) throw std::exception("Projection paths can't have predicates");
+                }
+
+                paths.push_back(q.get_steps());
+                return paths.size() - 1;
+            }
+
+            size_t size() const { return paths.size(); }
+
+            name_table& names() const { return *_names; }
+            const std::shared_ptr<name_table>& shared_names() const { return _names; }
+
+            // Appends the states for the document as a whole (i.e., the
+            // parent of the root element).
+            void start(std::vector<state>& states) const
+            {
+                for (size_t i = 0; i < paths.size(); i++)
+                {
+                    state s = { static_cast<uint32_t>(i), 0 };
+                    states.push_back(s);
+                }
+            }
+
+            // Applies the states in [first, last), which are those of an
+            // element's parent, to the element, and appends the element's
+            // own states (i.e., those that apply to its attributes and
+            // children).  The paths that select the element are appended to
+            // 'matched'.  'descend' is set if any of the new states can match
+            // a descendant, and 'attributes' if any can match an attribute.
+            void advance(std::vector<state>& states, size_t first, size_t last, name_id id,
+                std::vector<size_t>& matched, bool& descend, bool& attributes) const
+            {
+                size_t next = states.size();
+                for (size_t i = first; i < last; i++)
+                {
+                    state s = states[i];
+                    const std::vector<step>& path = paths[s.path];
+                    const step& current = path[s.step];
+
+                    // A '//' step can also match further down.
+                    if (current.descendant) add_state(states, next, s.path, s.step);
+
+                    if (current.attribute || (!current.any && current.name != id)) continue;
+
+                    if (s.step + 1 == path.size())
+                        add_match(matched, s.path);
+                    else
+                        add_state(states, next, s.path, s.step + 1);
+                }
+
+                descend = attributes = false;
+                for (size_t i = next; i < states.size(); i++)
+                {
+                    const step& current = paths[states[i].path][states[i].step];
+                    if (current.attribute) attributes = true;
+                    if (!current.attribute || current.descendant) descend = true;
+                }
+            }
+
+            // Appends the paths that select an attribute with the specified
+            // name, given the states in [first, last) of its element.
+            void match_attribute(const std::vector<state>& states, size_t first, size_t last, name_id id, std::vector<size_t>& matched) const
+            {
+                for (size_t i = first; i < last; i++)
+                {
+                    const step& current = paths[states[i].path][states[i].step];
+                    if (current.attribute && (current.any || current.name == id)) add_match(matched, states[i].path);
+                }
+            }
+        };
+
+        // Handlers can derive from this class, and only define the methods
+        // they need (see parse()).
+        struct handler
+        {
+            void element(size_t path, const tree::element& e) {}
+
+            template <typename string_t>
+            void attribute(size_t path, const string_t& name, const string_t& value) {}
+        };
+
+        template <typename string_t>
+        name_id find_name(const name_table& names, const string_t& s)
+        {
+            return s.has_bytes() ? names.find(s.bytes()) : names.find(s.str());
+        }
+
+        // Parses the document in [it, end), and reports the elements and
+        // attributes selected by the automaton's paths, in document order.
+        // Each selected element is built as a tree::document (sharing the
+        // automaton's name_table), which is passed to the handler's
+        // element(path, root) method and then discarded, and each selected
+        // attribute is passed to attribute(path, name, value).  Elements
+        // that can't contain anything selected are skipped without being
+        // parsed (or checked for well-formedness).
+        template <typename iterator_t, typename handler_t>
+        void parse(iterator_t it, iterator_t end, const automaton& a, handler_t& handler)
+        {
+            using namespace xml::grammar;
+            using namespace parse::operators;
+
+            typedef decltype(lt >> grammar::name[_0]) open_tag;
+            typedef decltype((!ws >> grammar::name[_0] >> eq >> qstring()[_1]) | (!ws >> !fslash[_2] >> gt)) attribute_or_end;
+            typedef decltype((lt >> fslash >> grammar::name[_0] >> gt) | ((lt >> grammar::name[_1]) | comment() | textnode()[_2])) content;
+
+            // The states of each open element (and of the document, at the
+            // bottom), as offsets of the first of each in 'states'.
+            std::vector<automaton::state> states;
+            std::vector<size_t> frames;
+            std::vector<size_t> matched;
+
+            a.start(states);
+            frames.push_back(0);
+
+            if (!grammar::prolog::parse_from(it, end)) throw parse_exception(it, end);
+
+            bool root = true;
+            while (frames.size() > 1 || root)
+            {
+                iterator_t start = it;
+                match_string<iterator_t> element_name;
+
+                if (root)
+                {
+                    typename ::parse::parser_ast<open_tag, iterator_t>::type t;
+                    if (!open_tag::parse_from(it, end, t)) throw parse_exception(it, end);
+                    element_name = get_string(t[_0]);
+                    root = false;
+                }
+                else
+                {
+                    typename ::parse::parser_ast<content, iterator_t>::type t;
+                    if (!content::parse_from(it, end, t)) throw parse_exception(it, end);
+
+                    // See xml::tree::document::build().
+                    if (it == start) throw parse_exception(it, end);
+
+                    if (t[_0].matched)
+                    {
+                        states.resize(frames.back());
+                        frames.pop_back();
+                        continue;
+                    }
+                    else if (!t[_1].matched)
+                    {
+                        // Text and comments are only needed within selected
+                        // elements, which are read separately.
+                        continue;
+                    }
+                    element_name = get_string(t[_1]);
+                }
+
+                size_t first = states.size();
+                bool descend, attributes;
+                matched.clear();
+                a.advance(states, frames.back(), first, find_name(a.names(), element_name), matched, descend, attributes);
+
+                if (!matched.empty())
+                {
+                    reader::element<iterator_t> e(start, end);
+                    tree::document selected(e, a.shared_names());
+                    for (auto path : matched) handler.element(path, selected.root());
+                }
+
+                if (!descend && !attributes)
+                {
+                    states.resize(first);
+                    if (!scan::skip_element(it, end)) throw parse_exception(it, end);
+                    continue;
+                }
+
+                bool empty = false;
+                if (attributes)
+                {
+                    while (true)
+                    {
+                        typename ::parse::parser_ast<attribute_or_end, iterator_t>::type t;
+                        if (!attribute_or_end::parse_from(it, end, t)) throw parse_exception(it, end);
+
+                        if (!t[_0].matched)
+                        {
+                            empty = t[_2].matched;
+                            break;
+                        }
+
+                        auto name = get_string(t[_0]);
+                        matched.clear();
+                        a.match_attribute(states, first, states.size(), find_name(a.names(), name), matched);
+                        if (matched.empty()) continue;
+
+                        auto value = qstring_value(t[_1]);
+                        for (auto path : matched) handler.attribute(path, name, value);
+                    }
+                }
+                else if (!scan::skip_tag(it, end, empty))
+                {
+                    throw parse_exception(it, end);
+                }
+
+                if (empty)
+                {
+                    states.resize(first);
+                }
+                else if (!descend)
+                {
+                    states.resize(first);
+                    if (!scan::skip_element_content(it, end)) throw parse_exception(it, end);
+                }
+                else
+                {
+                    frames.push_back(first);
+                }
+            }
+        }
+
+        // Parses a document held in a container (see unicode_container).
+        template <typename container_t, typename handler_t>
+        void parse(container_t& data, const automaton& a, handler_t& handler)
+        {
+            unicode::unicode_container<container_t> u(data);
+            parse(u.begin(), u.end(), a, handler);
+        }
+    }
+}
\ No newline at end of file
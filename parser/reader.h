@@ -1,334 +1,773 @@
-#pragma once
-
-#include "unicode\unicode.h"
-#include "grammar.h"
-
-#define WIN32_LEAN_AND_MEAN
-#include <Windows.h>
-
-namespace xml
-{
-    // This namespace contains classes that can be used to parse XML data in 
-    // a "pull" fashion.  The data is only parsed as needed as the user calls 
-    // the appropriate next_xyz() methods.
-    namespace reader
-    {
-        using namespace xml::grammar;
-        using namespace parse;
-        using namespace util;
-        using namespace parse::operators;
-
-        template <typename container_t>
-        class document;
-
-        template <typename iterator_t>
-        class element;
-
-        template <typename iterator_t>
-        class attribute;
-
-        enum node_type { text_node, element_node, invalid };
-
-        // This class is used to represent children of element nodes, which 
-        // can themselves be either an element or a text node.  An instance of
-        // this class may also represent the end of a node list.
-        template <typename iterator_t>
-        class node
-        {
-            enum parser_state_type { element_node, text_node, end_of_nodes } parser_state;
-
-            node(parser_state_type p, iterator_t it, iterator_t end)
-                : parser_state(p), it(it), end(end)
-            {
-            }
-
-        protected:
-            iterator_t it, end;
-            match_string<iterator_t> text_or_tag;
-
-        public:
-            typedef xml::reader::node<iterator_t> node_type;
-            typedef xml::reader::element<iterator_t> element_type;
-
-            node(iterator_t i, iterator_t e)
-                : it(i), end(e), text_or_tag(e, e)
-            {
-                typedef decltype( (lt >> fslash >> name[_0] >> gt) | ((lt >> name[_1]) | comment() | textnode()[_2]) ) parser;
-                typedef typename parse::parser_ast<parser, iterator_t>::type ast;
-
-                while (true)
-                {
-                    ast a;
-
-                    if (!parser::parse_from(it, end, a))
-                        throw parse_exception(it, end);
-
-                    if (a[_0].matched)
-                    {
-                        assert(a[_0].matched);
-                        parser_state = end_of_nodes;
-                        return;
-                    }
-                    else if (a[_1].matched)
-                    {
-                        parser_state = element_node;
-                        text_or_tag = get_string(a[_1]);
-                        return;
-                    }
-                    else if (a[_2].matched)
-                    {
-                        parser_state = text_node;
-                        text_or_tag = get_string(a[_2]);
-                        return;
-                    }
-                    // else must be a comment, so keep parsing
-                }
-            }
-
-            // Creates
-            static node_type end_node(iterator_t it, iterator_t end)
-            {
-                return node_type(end_of_nodes, it, end);
-            }
-
-            // Returns true only if the current node is an element
-            bool is_element() { return parser_state == element_node; }
-
-            // Returns true only if the current node is a text node
-            bool is_text() { return parser_state == text_node; }
-
-            // Returns true only if the object represents the end of the list 
-            // of nodes (i.e., it conceptually points to the close tag).  In 
-            // this case, the user should call next_parent() to get the next 
-            // node following the closing tag.
-            bool is_end() { return parser_state == end_of_nodes; }
-            
-            // Returns an element object representing the current node.  Only 
-            // valid if the current node is an element (i.e., is_element() 
-            // returns true).
-            element_type element()
-            {
-                assert(is_element());
-                return element_type(*this);
-            }
-
-            // Returns the content of a the current node.  Only valid if the 
-            // current node is a text node (i.e., is_text() returns true).
-            match_string<iterator_t> text()
-            {
-                assert(is_text());
-                return text_or_tag;
-            }
-
-            // Returns the node that follows the the current one.  Not valid 
-            // if is_end() would return true.
-            node_type next_sibling()
-            {
-                assert(is_element() || is_text());
-                
-                return is_element() ? 
-                    element().next_sibling() :
-                    node_type(it, end);
-            }
-
-            // Returns the next node following a the end of a list of 
-            // elements.  Only valid if is_end() would return true.
-            node_type next_parent()
-            {
-                assert(is_end());
-                return node_type(it, end);
-            }
-        };
-
-        template <typename iterator_t>
-        class element : public node<iterator_t>
-        {
-            typedef element<iterator_t> element_type;
-            typedef node<iterator_t> node_type;
-
-        public:
-            typedef xml::reader::attribute<iterator_t> attribute_type;
-
-            element(const node_type& n) : node_type(n)
-            {
-            }
-
-            element(iterator_t it, iterator_t end) : node_type(it, end)
-            {
-                if (!is_element()) throw parse_exception(it, end);
-            }
-
-            // Returns the tag name of the element.
-            match_string<iterator_t> name()
-            {
-                return text_or_tag;
-            }
-
-            // Returns the first attribute of the element, or an attribute 
-            // representing the end of the attribute list, if there are none.
-            // Only valid if is_end() would return false.
-            attribute_type next_attribute()
-            {
-                return attribute_type(it, end);
-            }
-
-            // Returns the first child of the element node, or a node 
-            // representing the end of the list of child nodes, if there 
-            // aren't any.  Only valid if is_end() would return false.
-            node_type next_child()
-            {
-                return attribute_type(it, end).next_child();
-            }
-
-            // Returns the node that immediately follows this one, or a node 
-            // representing the end of the list of child nodes, if there 
-            // aren't any.  Only valid if is_end() would return false.
-            node_type next_sibling()
-            {
-                return attribute_type(it, end).next_sibling();
-            }
-        };
-
-        template <typename iterator_t>
-        class attribute
-        {
-            match_string<iterator_t> _name;
-            match_string<iterator_t> _value;
-            iterator_t it, end;
-            enum { attribute_node, end_of_attributes, end_of_element } parser_state;
-
-        public:
-            typedef node<iterator_t> node_type;
-            typedef attribute<iterator_t> attribute_type;
-
-            attribute(iterator_t i, iterator_t e)
-                : it(i), end(e), _name(e, e), _value(e, e)
-            {
-                typedef decltype( (!ws >> grammar::name[_0] >> eq >> qstring()[_1]) | (!ws >> !fslash[_2] >> gt) ) parser;
-                typedef typename parse::parser_ast<parser, iterator_t>::type ast;
-
-                ast a;
-                
-                if (!parser::parse_from(it, end, a))
-                    throw parse_exception(a, end);
-                
-                if (a[_0].matched)
-                {
-                    _name = get_string(a[_0]);
-                    auto& qstr = a[_1];
-                    _value = qstring_value(qstr);
-                    parser_state = attribute_node;
-                }
-                else
-                {
-                    parser_state = a[_2].matched ?
-                        end_of_element : end_of_attributes;
-                }
-            }
-
-            // Returns the name of the attribute, i.e., "name='value'".  Only 
-            // valid if is_end() would return false.
-            match_string<iterator_t> name()
-            {
-                assert(parser_state == attribute_node);
-                return _name;
-            }
-            
-            // Returns the value of the attribute, i.e., "name='value'".  Only 
-            // valid if is_end() would return false.
-            match_string<iterator_t> value()
-            {
-                assert(parser_state == attribute_node);
-                return _value;
-            }
-
-            // Returns the attribute immediately following this one, or an 
-            // attribute object representing the end of the attribute list, 
-            // if there are no more.  Only valid if is_end() would return 
-            // false.
-            attribute_type next_attribute()
-            {
-                assert(parser_state == attribute_node);
-                return attribute(it, end);
-            }
-
-            // Returns the first child of the element this attribute is 
-            // associated with, or a node object representing the end of the 
-            // list of nodes if there aren't any.
-            node_type next_child()
-            {
-                if (parser_state == attribute_node)
-                {
-                    auto a = attribute(it, end);
-                    while (!a.is_end()) a = a.next_attribute();
-                    return a.next_child();
-                }
-                else if (parser_state == end_of_attributes)
-                {
-                    return node_type(it, end);
-                }
-                else //if (parser_state == end_of_element)
-                {
-                    assert(parser_state == end_of_element);
-                    return node_type::end_node(it, end);
-                }
-            }
-
-            // Returns the node immediately following the node this attribute 
-            // is associated with, or a node object representing the end of 
-            // the list of nodes if there isn't one.
-            node_type next_sibling()
-            {
-                if (parser_state == attribute_node)
-                {
-                    auto a = attribute(it, end);
-                    while (!a.is_end()) a = a.next_attribute();
-                    return a.next_sibling();
-                }
-                else if (parser_state == end_of_attributes)
-                {
-                    auto child = node_type(it, end);
-                    while (!child.is_end()) child = child.next_sibling();
-                    return child.next_parent();
-                }
-                else //if (parser_state == end_of_element)
-                {
-                    assert(parser_state == end_of_element);
-                    return node_type(it, end);
-                }
-            }
-
-            // Returns true only if there are no more attributes in the 
-            // list.  Conceptually, the current object is associated with the 
-            // end of the open tag of an element.
-            bool is_end() { return parser_state == end_of_attributes || parser_state == end_of_element; }
-        };
-
-        template <typename container_t>
-        class document
-        {
-            typedef typename unicode::unicode_container<container_t> unicode_container;
-	        typedef typename unicode_container::iterator iterator_t;
-            
-            unicode_container data;
-            iterator_t it, end;
-
-        public:
-            typedef element<iterator_t> element_type;
-
-            document(container_t& c)
-                : data(c), it(data.begin()), end(data.end())
-            {
-                if (!grammar::prolog::parse_from(it, end)) 
-                    throw parse_exception(it, end);
-            }
-
-            // Returns the element object representing the root of the 
-            // document.
-            element_type root()
-            {
-                return element_type(it, end);
-            }
-        };
-    }
+#pragma once
+
+#include "unicode\unicode.h"
+#include "grammar.h"
+#include "scan.h"
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+#define WIN32_LEAN_AND_MEAN
+#include <Windows.h>
+
+namespace xml
+{
+    // This namespace contains classes that can be used to parse XML data in 
+    // a "pull" fashion.  The data is only parsed as needed as the user calls 
+    // the appropriate next_xyz() methods.
+    namespace reader
+    {
+        using namespace xml::grammar;
+        using namespace parse;
+        using namespace util;
+        using namespace parse::operators;
+
+        template <typename container_t>
+        class document;
+
+        template <typename iterator_t>
+        class element;
+
+        template <typename iterator_t>
+        class attribute;
+
+        enum node_type { text_node, element_node, invalid };
+
+        // The positions of an element that are found by parsing past its 
+        // attributes or its content.  They are recorded the first time 
+        // they're found, so that moving past an element again (e.g., to its 
+        // next sibling, after reading its children) doesn't reparse it.
+        template <typename iterator_t>
+        struct element_positions
+        {
+            bool has_content;
+            bool has_next;
+
+            // True if the element is an empty-element tag ("/>").
+            bool empty;
+
+            // The position just after the open tag.
+            iterator_t content;
+
+            // The position just after the close tag.
+            iterator_t next;
+
+            element_positions() : has_content(false), has_next(false), empty(false)
+            {
+            }
+        };
+
+        // This class maps each element of a document (identified by the 
+        // position just after its name) to its element_positions.  There's 
+        // one per document, shared by all the node, element and attribute 
+        // objects read from it.  Entries are only added for the elements 
+        // that are actually visited.
+        template <typename iterator_t>
+        class position_table
+        {
+            iterator_t first;
+            std::unordered_map<size_t, element_positions<iterator_t>> entries;
+
+            position_table(const position_table&);
+            position_table& operator= (const position_table&);
+
+        public:
+            typedef element_positions<iterator_t> positions_type;
+
+            position_table(const iterator_t& first) : first(first)
+            {
+            }
+
+            // Returns the entry for the element whose name ends at 'it'. 
+            // The reference remains valid as entries are added.
+            positions_type& get(const iterator_t& it)
+            {
+                return entries[static_cast<size_t>(it.base() - first.base())];
+            }
+
+            size_t size() const { return entries.size(); }
+        };
+
+        // This class is used to represent children of element nodes, which 
+        // can themselves be either an element or a text node.  An instance of
+        // this class may also represent the end of a node list.
+        template <typename iterator_t>
+        class node
+        {
+            friend class attribute<iterator_t>;
+
+            enum parser_state_type { element_node, text_node, end_of_nodes } parser_state;
+
+            node(parser_state_type p, iterator_t it, iterator_t end, position_table<iterator_t>* t, element_positions<iterator_t>* parent)
+                : parser_state(p), it(it), end(end), text_or_tag(end, end), table(t), parent(parent)
+            {
+            }
+
+        protected:
+            iterator_t it, end;
+            match_string<iterator_t> text_or_tag;
+
+            // The document's position table (may be null, in which case 
+            // nothing is recorded), and the entry of the element that 
+            // contains this node, if it's known.
+            position_table<iterator_t>* table;
+            element_positions<iterator_t>* parent;
+
+        public:
+            typedef xml::reader::node<iterator_t> node_type;
+            typedef xml::reader::element<iterator_t> element_type;
+
+            node(iterator_t i, iterator_t e, position_table<iterator_t>* t = nullptr, element_positions<iterator_t>* p = nullptr)
+                : it(i), end(e), text_or_tag(e, e), table(t), parent(p)
+            {
+                typedef decltype( (lt >> fslash >> name[_0] >> gt) | ((lt >> name[_1]) | comment() | textnode()[_2]) ) parser;
+                typedef typename parse::parser_ast<parser, iterator_t>::type ast;
+
+                while (true)
+                {
+                    ast a;
+                    iterator_t start = it;
+
+                    if (!parser::parse_from(it, end, a))
+                        throw parse_exception(it, end);
+
+                    // Content the grammar doesn't handle (e.g., a PI) can 
+                    // produce an empty match, which would loop forever.
+                    if (it == start)
+                        throw parse_exception(it, end);
+
+                    if (a[_0].matched)
+                    {
+                        parser_state = end_of_nodes;
+
+                        // This is the close tag of the parent, so the node 
+                        // following the parent is now known.
+                        if (parent && !parent->has_next)
+                        {
+                            parent->next = it;
+                            parent->has_next = true;
+                        }
+                        return;
+                    }
+                    else if (a[_1].matched)
+                    {
+                        parser_state = element_node;
+                        text_or_tag = get_string(a[_1]);
+                        return;
+                    }
+                    else if (a[_2].matched)
+                    {
+                        parser_state = text_node;
+                        text_or_tag = get_string(a[_2]);
+                        return;
+                    }
+                    // else must be a comment, so keep parsing
+                }
+            }
+
+            // Creates a node representing the end of a list of nodes, whose 
+            // close tag has already been parsed (i.e., 'it' points past it).
+            static node_type end_node(iterator_t it, iterator_t end, position_table<iterator_t>* t = nullptr)
+            {
+                return node_type(end_of_nodes, it, end, t, nullptr);
+            }
+
+            // Returns true only if the current node is an element
+            bool is_element() { return parser_state == element_node; }
+
+            // Returns true only if the current node is a text node
+            bool is_text() { return parser_state == text_node; }
+
+            // Returns true only if the object represents the end of the list 
+            // of nodes (i.e., it conceptually points to the close tag).  In 
+            // this case, the user should call next_parent() to get the next 
+            // node following the closing tag.
+            bool is_end() { return parser_state == end_of_nodes; }
+            
+            // Returns an element object representing the current node.  Only 
+            // valid if the current node is an element (i.e., is_element() 
+            // returns true).
+            element_type element()
+            {
+                assert(is_element());
+                return element_type(*this);
+            }
+
+            // Returns the content of a the current node.  Only valid if the 
+            // current node is a text node (i.e., is_text() returns true).
+            match_string<iterator_t> text()
+            {
+                assert(is_text());
+                return text_or_tag;
+            }
+
+            // Returns the node that follows the the current one.  Not valid 
+            // if is_end() would return true.
+            node_type next_sibling()
+            {
+                assert(is_element() || is_text());
+                
+                return is_element() ? 
+                    element().next_sibling() :
+                    node_type(it, end, table, parent);
+            }
+
+            // Returns the node that follows the current one, like 
+            // next_sibling(), but without parsing the content of an element 
+            // (see element::skip()).  Not valid if is_end() would return 
+            // true.
+            node_type skip()
+            {
+                assert(is_element() || is_text());
+
+                return is_element() ?
+                    element().skip() :
+                    node_type(it, end, table, parent);
+            }
+
+            // Returns the next node following a the end of a list of 
+            // elements.  Only valid if is_end() would return true.
+            node_type next_parent()
+            {
+                assert(is_end());
+                return node_type(it, end, table);
+            }
+        };
+
+        template <typename iterator_t>
+        class element : public node<iterator_t>
+        {
+            typedef element<iterator_t> element_type;
+            typedef node<iterator_t> node_type;
+
+        public:
+            typedef xml::reader::attribute<iterator_t> attribute_type;
+
+            element(const node_type& n) : node_type(n)
+            {
+            }
+
+            element(iterator_t it, iterator_t end, position_table<iterator_t>* t = nullptr) : node_type(it, end, t)
+            {
+                if (!this->is_element()) throw parse_exception(it, end);
+            }
+
+            // Returns the tag name of the element.
+            match_string<iterator_t> name()
+            {
+                return this->text_or_tag;
+            }
+
+            // Returns the first attribute of the element, or an attribute 
+            // representing the end of the attribute list, if there are none.
+            // Only valid if is_end() would return false.
+            attribute_type next_attribute()
+            {
+                return attribute_type(this->it, this->end, this->table, positions(), this->parent);
+            }
+
+            // Returns the first child of the element node, or a node 
+            // representing the end of the list of child nodes, if there 
+            // aren't any.  Only valid if is_end() would return false.
+            node_type next_child()
+            {
+                auto p = positions();
+                if (p && p->has_content)
+                {
+                    return p->empty ?
+                        node_type::end_node(p->content, this->end, this->table) :
+                        node_type(p->content, this->end, this->table, p);
+                }
+                return next_attribute().next_child();
+            }
+
+            // Returns the node that immediately follows this one, or a node 
+            // representing the end of the list of child nodes, if there 
+            // aren't any.  Only valid if is_end() would return false.
+            node_type next_sibling()
+            {
+                auto p = positions();
+                if (p && p->has_next) return node_type(p->next, this->end, this->table, this->parent);
+                return next_attribute().next_sibling();
+            }
+
+            // Returns the node that immediately follows this one, like 
+            // next_sibling(), but finds the element's close tag by scanning 
+            // for markup instead of parsing its attributes and content, 
+            // which is much faster for elements that aren't needed.  The 
+            // skipped data isn't checked for well-formedness.  Only valid if 
+            // is_end() would return false.
+            node_type skip()
+            {
+                auto p = positions();
+                if (p && p->has_next) return node_type(p->next, this->end, this->table, this->parent);
+
+                iterator_t next = this->it;
+                bool found;
+                if (p && p->has_content)
+                {
+                    next = p->content;
+                    found = p->empty || scan::skip_element_content(next, this->end);
+                }
+                else
+                {
+                    found = scan::skip_element(next, this->end);
+                }
+                if (!found) throw parse_exception(next, this->end);
+
+                if (p)
+                {
+                    p->next = next;
+                    p->has_next = true;
+                }
+                return node_type(next, this->end, this->table, this->parent);
+            }
+
+        private:
+            // Returns the element's entry in the position table, or null if 
+            // there isn't a table.
+            element_positions<iterator_t>* positions()
+            {
+                return this->table ? &this->table->get(this->it) : nullptr;
+            }
+        };
+
+        template <typename iterator_t>
+        class attribute
+        {
+        public:
+            typedef node<iterator_t> node_type;
+            typedef attribute<iterator_t> attribute_type;
+
+        private:
+            typedef element_positions<iterator_t> positions_type;
+
+            match_string<iterator_t> _name;
+            match_string<iterator_t> _value;
+            iterator_t it, end;
+            enum { attribute_node, end_of_attributes, end_of_element } parser_state;
+
+            // The document's position table, the entry of the element the 
+            // attribute belongs to, and the entry of that element's parent 
+            // (any of which may be null).
+            position_table<iterator_t>* table;
+            positions_type* owner;
+            positions_type* parent;
+
+            // Returns the first child of the element, given the position 
+            // just after its open tag.
+            node_type first_child(const iterator_t& content, bool empty)
+            {
+                return empty ?
+                    node_type::end_node(content, end, table) :
+                    node_type(content, end, table, owner);
+            }
+
+            // Returns the node following the element, given the position 
+            // just after its open tag, skipping its content if the position 
+            // of its close tag isn't known yet.
+            node_type following(const iterator_t& content, bool empty)
+            {
+                if (!owner || !owner->has_next)
+                {
+                    iterator_t next = content;
+                    if (!empty)
+                    {
+                        auto child = node_type(content, end, table, owner);
+                        while (!child.is_end()) child = child.next_sibling();
+                        next = child.it;
+                    }
+                    if (!owner) return node_type(next, end, table, parent);
+
+                    owner->next = next;
+                    owner->has_next = true;
+                }
+                return node_type(owner->next, end, table, parent);
+            }
+
+        public:
+            attribute(iterator_t i, iterator_t e, position_table<iterator_t>* t = nullptr, positions_type* o = nullptr, positions_type* p = nullptr)
+                : _name(e, e), _value(e, e), it(i), end(e), table(t), owner(o), parent(p)
+            {
+                typedef decltype( (!ws >> grammar::name[_0] >> eq >> qstring()[_1]) | (!ws >> !fslash[_2] >> gt) ) parser;
+                typedef typename parse::parser_ast<parser, iterator_t>::type ast;
+
+                ast a;
+                
+                if (!parser::parse_from(it, end, a))
+                    throw parse_exception(it, end);
+                
+                if (a[_0].matched)
+                {
+                    _name = get_string(a[_0]);
+                    auto& qstr = a[_1];
+                    _value = qstring_value(qstr);
+                    parser_state = attribute_node;
+                }
+                else
+                {
+                    parser_state = a[_2].matched ?
+                        end_of_element : end_of_attributes;
+
+                    if (owner && !owner->has_content)
+                    {
+                        owner->content = it;
+                        owner->empty = parser_state == end_of_element;
+                        owner->has_content = true;
+                    }
+                }
+            }
+
+            // Returns the name of the attribute, i.e., "name='value'".  Only 
+            // valid if is_end() would return false.
+            match_string<iterator_t> name()
+            {
+                assert(parser_state == attribute_node);
+                return _name;
+            }
+            
+            // Returns the value of the attribute, i.e., "name='value'".  Only 
+            // valid if is_end() would return false.
+            match_string<iterator_t> value()
+            {
+                assert(parser_state == attribute_node);
+                return _value;
+            }
+
+            // Returns the attribute immediately following this one, or an 
+            // attribute object representing the end of the attribute list, 
+            // if there are no more.  Only valid if is_end() would return 
+            // false.
+            attribute_type next_attribute()
+            {
+                assert(parser_state == attribute_node);
+                return attribute(it, end, table, owner, parent);
+            }
+
+            // Returns the first child of the element this attribute is 
+            // associated with, or a node object representing the end of the 
+            // list of nodes if there aren't any.
+            node_type next_child()
+            {
+                if (parser_state == attribute_node)
+                {
+                    if (owner && owner->has_content)
+                        return first_child(owner->content, owner->empty);
+
+                    auto a = next_attribute();
+                    while (!a.is_end()) a = a.next_attribute();
+                    return a.next_child();
+                }
+                else
+                {
+                    return first_child(it, parser_state == end_of_element);
+                }
+            }
+
+            // Returns the node immediately following the node this attribute 
+            // is associated with, or a node object representing the end of 
+            // the list of nodes if there isn't one.
+            node_type next_sibling()
+            {
+                if (parser_state == attribute_node)
+                {
+                    if (owner && (owner->has_next || owner->has_content))
+                        return following(owner->content, owner->empty);
+
+                    auto a = next_attribute();
+                    while (!a.is_end()) a = a.next_attribute();
+                    return a.next_sibling();
+                }
+                else
+                {
+                    return following(it, parser_state == end_of_element);
+                }
+            }
+
+            // Returns true only if there are no more attributes in the 
+            // list.  Conceptually, the current object is associated with the 
+            // end of the open tag of an element.
+            bool is_end() { return parser_state == end_of_attributes || parser_state == end_of_element; }
+        };
+
+        template <typename container_t>
+        class document
+        {
+            typedef typename unicode::unicode_container<container_t> unicode_container;
+	        typedef typename unicode_container::iterator iterator_t;
+            
+            unicode_container data;
+            iterator_t it, end;
+            position_table<iterator_t> positions;
+
+            // The elements read from the document point into its position 
+            // table.
+            document(const document&);
+            document& operator= (const document&);
+
+        public:
+            typedef element<iterator_t> element_type;
+
+            document(container_t& c)
+                : data(c), it(data.begin()), end(data.end()), positions(it)
+            {
+                if (!grammar::prolog::parse_from(it, end)) 
+                    throw parse_exception(it, end);
+            }
+
+            // Returns the element object representing the root of the 
+            // document.
+            element_type root()
+            {
+                return element_type(it, end, &positions);
+            }
+        };
+
+        // This class reads a document one node at a time through a single 
+        // object, which holds the parse state, so that (unlike the classes 
+        // above) nothing is copied or parsed more than once as it moves 
+        // through the document.  Each call to read() moves to the next node 
+        // in document order: an element_node for each start tag, followed 
+        // by an attribute_node for each of its attributes, then the nodes 
+        // of its content, and then an end_element_node (which is also 
+        // reported for empty-element tags).  Comments are skipped.
+        template <typename container_t>
+        class cursor
+        {
+            typedef typename unicode::unicode_container<container_t> unicode_container;
+            typedef typename unicode_container::iterator iterator_t;
+
+            typedef decltype(lt >> grammar::name[_0]) open_tag;
+            typedef decltype((!ws >> grammar::name[_0] >> eq >> qstring()[_1]) | (!ws >> !fslash[_2] >> gt)) attribute_or_end;
+            typedef decltype((lt >> fslash >> grammar::name[_0] >> gt) | ((lt >> grammar::name[_1]) | comment() | textnode()[_2])) content;
+
+        public:
+            typedef iterator_t iterator;
+
+            enum node_kind { start_node, element_node, attribute_node, text_node, end_element_node, end_node };
+
+        private:
+            unicode_container data;
+            iterator_t it, end;
+            enum { before_root, in_tag, in_content, after_root } state;
+            node_kind kind;
+            match_string<iterator_t> _name;
+            match_string<iterator_t> _value;
+
+            // The names of the open elements, innermost last.
+            std::vector<match_string<iterator_t>> open;
+
+            cursor(const cursor&);
+            cursor& operator= (const cursor&);
+
+            bool start_element(const match_string<iterator_t>& n)
+            {
+                open.push_back(n);
+                kind = element_node;
+                _name = n;
+                _value = match_string<iterator_t>(end, end);
+                state = in_tag;
+                return true;
+            }
+
+            bool end_element()
+            {
+                kind = end_element_node;
+                _name = open.back();
+                _value = match_string<iterator_t>(end, end);
+                open.pop_back();
+                state = open.empty() ? after_root : in_content;
+                return true;
+            }
+
+        public:
+            cursor(container_t& c)
+                : data(c), it(data.begin()), end(data.end()), state(before_root), kind(start_node), _name(end, end), _value(end, end)
+            {
+                if (!grammar::prolog::parse_from(it, end))
+                    throw parse_exception(it, end);
+            }
+
+            // Moves to the next node, and returns false if there are no 
+            // more (i.e., the root element has ended).
+            bool read()
+            {
+                while (true)
+                {
+                    if (state == before_root)
+                    {
+                        typename parse::parser_ast<open_tag, iterator_t>::type a;
+                        if (!open_tag::parse_from(it, end, a)) throw parse_exception(it, end);
+
+                        return start_element(get_string(a[_0]));
+                    }
+                    else if (state == in_tag)
+                    {
+                        typename parse::parser_ast<attribute_or_end, iterator_t>::type a;
+                        if (!attribute_or_end::parse_from(it, end, a)) throw parse_exception(it, end);
+
+                        if (a[_0].matched)
+                        {
+                            kind = attribute_node;
+                            _name = get_string(a[_0]);
+                            _value = qstring_value(a[_1]);
+                            return true;
+                        }
+
+                        if (a[_2].matched) return end_element();
+                        state = in_content;
+                    }
+                    else if (state == in_content)
+                    {
+                        iterator_t start = it;
+                        typename parse::parser_ast<content, iterator_t>::type a;
+                        if (!content::parse_from(it, end, a)) throw parse_exception(it, end);
+
+                        // See node::node().
+                        if (it == start) throw parse_exception(it, end);
+
+                        if (a[_0].matched)
+                        {
+                            return end_element();
+                        }
+                        else if (a[_1].matched)
+                        {
+                            return start_element(get_string(a[_1]));
+                        }
+                        else if (a[_2].matched)
+                        {
+                            kind = text_node;
+                            _name = match_string<iterator_t>(end, end);
+                            _value = get_string(a[_2]);
+                            return true;
+                        }
+                        // else it's a comment, which is skipped
+                    }
+                    else
+                    {
+                        kind = end_node;
+                        return false;
+                    }
+                }
+            }
+
+            // Skips the rest of the innermost open element (i.e., the 
+            // element itself, if the cursor is on its start tag or one of 
+            // its attributes, or else the element that contains the current 
+            // node), and moves to its end_element_node.  Like 
+            // element::skip(), this scans for the close tag without parsing 
+            // the skipped data.
+            void skip()
+            {
+                assert(state == in_tag || state == in_content);
+
+                bool found = state == in_tag ?
+                    scan::skip_element(it, end) :
+                    scan::skip_element_content(it, end);
+                if (!found) throw parse_exception(it, end);
+
+                end_element();
+            }
+
+            node_kind get_kind() const { return kind; }
+
+            // Returns the name of the current element, end element or 
+            // attribute.
+            match_string<iterator_t> name() const { return _name; }
+
+            // Returns the value of the current attribute, or the content of 
+            // the current text node.
+            match_string<iterator_t> value() const { return _value; }
+
+            // Returns the number of elements that contain the current node 
+            // (so the root element and its end are at depth 0, and its 
+            // attributes and children are at depth 1).
+            size_t depth() const
+            {
+                return kind == element_node ? open.size() - 1 : open.size();
+            }
+        };
+
+        // A node read by a cursor, as produced by iterating over the range 
+        // returned by events().  The name and value refer to the document's 
+        // data, so nothing is copied.
+        template <typename container_t>
+        struct event
+        {
+            typedef typename cursor<container_t>::node_kind node_kind;
+            typedef typename cursor<container_t>::iterator iterator;
+
+            node_kind kind;
+            match_string<iterator> name;
+            match_string<iterator> value;
+            size_t depth;
+        };
+
+        // This class is the range returned by events().  It owns a cursor, 
+        // which is allocated once, when the range is created, and which is 
+        // advanced as the range is iterated, so a document can be consumed 
+        // one event at a time in a plain loop, and the consumer can stop 
+        // (or skip elements) at any point.  It's an input range: all of its 
+        // iterators share the cursor, and begin() may only be called once.
+        template <typename container_t>
+        class event_range
+        {
+        public:
+            typedef xml::reader::cursor<container_t> cursor_type;
+            typedef xml::reader::event<container_t> event_type;
+
+            class iterator : public std::iterator<std::input_iterator_tag, event_type>
+            {
+                // Null at the end of the range.
+                cursor_type* c;
+
+            public:
+                iterator() : c(nullptr)
+                {
+                }
+
+                explicit iterator(cursor_type* cur) : c(cur)
+                {
+                    if (!c->read()) c = nullptr;
+                }
+
+                event_type operator*() const
+                {
+                    event_type e = { c->get_kind(), c->name(), c->value(), c->depth() };
+                    return e;
+                }
+
+                iterator& operator++()
+                {
+                    if (!c->read()) c = nullptr;
+                    return *this;
+                }
+
+                bool operator==(const iterator& other) const { return c == other.c; }
+                bool operator!=(const iterator& other) const { return c != other.c; }
+            };
+
+            event_range(container_t& data) : c(std::make_shared<cursor_type>(data))
+            {
+            }
+
+            iterator begin() { return iterator(c.get()); }
+            iterator end() { return iterator(); }
+
+            // Returns the cursor the range reads from, e.g., to skip() the 
+            // rest of the current element.
+            cursor_type& get_cursor() { return *c; }
+
+        private:
+            std::shared_ptr<cursor_type> c;
+        };
+
+        // Returns a range of events (i.e., start tags, attributes, text 
+        // and end tags) read from a document, in document order.
+        template <typename container_t>
+        event_range<container_t> events(container_t& data)
+        {
+            return event_range<container_t>(data);
+        }
+    }
 }
\ No newline at end of file
@@ -0,0 +1,199 @@
+#pragma once
+
+#include "unicode\unicode.h"
+#include "grammar.h"
+#include <vector>
+
+namespace xml
+{
+    // This namespace contains a "push" interface, which parses a whole
+    // document in one pass and reports what it finds to a handler object,
+    // without building anything.  The handler's type is a template
+    // parameter, so its methods are resolved (and can be inlined) at
+    // compile time, rather than called through virtual functions.
+    namespace sax
+    {
+        // Handlers can derive from this class, and only define the methods
+        // they need; the others do nothing.  The strings passed to the
+        // methods are match_strings, which refer to the document's data.
+        struct handler
+        {
+            template <typename string_t>
+            void start_element(const string_t& name) {}
+
+            template <typename string_t>
+            void attribute(const string_t& name, const string_t& value) {}
+
+            template <typename string_t>
+            void text(const string_t& value) {}
+
+            template <typename string_t>
+            void comment(const string_t& value) {}
+
+            template <typename string_t>
+            void end_element(const string_t& name) {}
+        };
+
+        // Parses the document in [it, end), which is positioned at the start
+        // of the data (i.e., before the prolog), calling the handler's
+        // methods in document order.  The end of an empty-element tag is
+        // reported with end_element(), like a close tag.  Comments before
+        // the root element are part of the prolog, and aren't reported.
+        template <typename iterator_t, typename handler_t>
+        void parse(iterator_t it, iterator_t end, handler_t& handler)
+        {
+            using namespace xml::grammar;
+            using namespace parse::operators;
+
+            typedef decltype(lt >> grammar::name[_0]) open_tag;
+            typedef decltype((!ws >> grammar::name[_0] >> eq >> qstring()[_1]) | (!ws >> !fslash[_2] >> gt)) attribute_or_end;
+            typedef decltype(lt >> bang >> dash >> dash >> (*(~dash | (dash >> ~dash)))[_3] >> dash >> dash >> gt) comment_text;
+            typedef decltype((lt >> fslash >> grammar::name[_0] >> gt) | ((lt >> grammar::name[_1]) | comment_text() | textnode()[_2])) content;
+
+            std::vector<match_string<iterator_t>> open;
+            enum { in_tag, in_content } state = in_tag;
+
+            if (!grammar::prolog::parse_from(it, end)) throw parse_exception(it, end);
+
+            typename ::parse::parser_ast<open_tag, iterator_t>::type root_ast;
+            if (!open_tag::parse_from(it, end, root_ast)) throw parse_exception(it, end);
+
+            open.push_back(get_string(root_ast[_0]));
+            handler.start_element(open.back());
+
+            while (!open.empty())
+            {
+                if (state == in_tag)
+                {
+                    typename ::parse::parser_ast<attribute_or_end, iterator_t>::type a;
+                    if (!attribute_or_end::parse_from(it, end, a)) throw parse_exception(it, end);
+
+                    if (a[_0].matched)
+                    {
+                        handler.attribute(get_string(a[_0]), qstring_value(a[_1]));
+                        continue;
+                    }
+
+                    if (a[_2].matched)
+                    {
+                        handler.end_element(open.back());
+                        open.pop_back();
+                    }
+                    state = in_content;
+                }
+                else
+                {
+                    iterator_t start = it;
+                    typename ::parse::parser_ast<content, iterator_t>::type a;
+                    if (!content::parse_from(it, end, a)) throw parse_exception(it, end);
+
+                    // See xml::tree::document::build().
+                    if (it == start) throw parse_exception(it, end);
+
+                    if (a[_0].matched)
+                    {
+                        handler.end_element(open.back());
+                        open.pop_back();
+                    }
+                    else if (a[_1].matched)
+                    {
+                        open.push_back(get_string(a[_1]));
+                        handler.start_element(open.back());
+                        state = in_tag;
+                    }
+                    else if (a[_2].matched)
+                    {
+                        handler.text(get_string(a[_2]));
+                    }
+                    else
+                    {
+                        handler.comment(get_string(a[_3]));
+                    }
+                }
+            }
+        }
+
+        // Parses a document held in a container (see unicode_container).
+        template <typename container_t, typename handler_t>
+        void parse(container_t& data, handler_t& handler)
+        {
+            unicode::unicode_container<container_t> u(data);
+            parse(u.begin(), u.end(), handler);
+        }
+
+        enum event_kind { start_element_event, attribute_event, text_event, comment_event, end_element_event };
+
+        // The events reported by parse_batched().  The name is empty for
+        // text and comments, and the value is empty for elements.
+        template <typename iterator_t>
+        struct event
+        {
+            event_kind kind;
+            match_string<iterator_t> name;
+            match_string<iterator_t> value;
+        };
+
+        // This handler stores events in a fixed-size array, and passes them
+        // to a consumer (i.e., consumer(events, count)) whenever the array
+        // is full, and once more at the end (see parse_batched()).
+        template <typename iterator_t, typename consumer_t, size_t batch_size>
+        class batch_handler
+        {
+            typedef event<iterator_t> event_type;
+            typedef match_string<iterator_t> string_type;
+
+            consumer_t& consumer;
+            event_type events[batch_size];
+            size_t count;
+
+            // The missing names and values are empty matches at the end of 
+            // the data (like the cursor's), so that they can be used like 
+            // any other match.
+            string_type empty;
+
+            void add(event_kind kind, const string_type& name, const string_type& value)
+            {
+                event_type& e = events[count++];
+                e.kind = kind;
+                e.name = name;
+                e.value = value;
+                if (count == batch_size) flush();
+            }
+
+        public:
+            batch_handler(consumer_t& c, const iterator_t& end) : consumer(c), count(0), empty(end, end)
+            {
+            }
+
+            void start_element(const string_type& name) { add(start_element_event, name, empty); }
+            void attribute(const string_type& name, const string_type& value) { add(attribute_event, name, value); }
+            void text(const string_type& value) { add(text_event, empty, value); }
+            void comment(const string_type& value) { add(comment_event, empty, value); }
+            void end_element(const string_type& name) { add(end_element_event, name, empty); }
+
+            // Passes the stored events to the consumer, if there are any.
+            void flush()
+            {
+                if (count == 0) return;
+                consumer(static_cast<const event_type*>(events), count);
+                count = 0;
+            }
+        };
+
+        // Parses a document like parse(), but passes the events to the
+        // consumer in batches of up to batch_size, as an array of
+        // event<iterator> (i.e., consumer(const event<iterator>*, size_t)),
+        // so the consumer's loop over a batch doesn't alternate with the
+        // parser's.
+        template <size_t batch_size, typename container_t, typename consumer_t>
+        void parse_batched(container_t& data, consumer_t& consumer)
+        {
+            typedef typename unicode::unicode_container<container_t>::iterator iterator_t;
+
+            unicode::unicode_container<container_t> u(data);
+            batch_handler<iterator_t, consumer_t, batch_size> handler(consumer, u.end());
+            parse(u.begin(), u.end(), handler);
+            handler.flush();
+        }
+    }
+}
\ No newline at end of file
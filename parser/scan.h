@@ -0,0 +1,242 @@
+#pragma once
+
+#include "simd.h"
+#include "unicode\unicode.h"
+
+namespace xml
+{
+    // This namespace contains functions that skip over markup without
+    // running the grammar, for callers that only need to know where
+    // something ends (e.g., to skip an element whose content isn't needed).
+    // They only look at the characters that delimit markup ('<', '>', '/',
+    // quotes, and the ends of comments, PIs and CDATA sections), and don't
+    // check that the data they skip is well-formed.  They work with any
+    // iterator whose values can be compared with ASCII characters (e.g.,
+    // unicode_iterator, or the bytes of UTF-8 data).  The overloads for
+    // const char* use SIMD to jump between delimiters, and skip_element()
+    // uses them for unicode_iterators over UTF-8 or ISO-8859-1 data in
+    // contiguous memory.
+    namespace scan
+    {
+        // Advances past the first occurrence of the specified string, and
+        // returns false if there isn't one.
+        template <typename iterator_t>
+        bool skip_past(iterator_t& it, const iterator_t& end, const char* s)
+        {
+            while (it != end)
+            {
+                if (*it++ != s[0]) continue;
+
+                iterator_t next = it;
+                const char* p = s + 1;
+                while (*p != 0 && next != end && *next == *p) { ++next; ++p; }
+                if (*p == 0) { it = next; return true; }
+            }
+            return false;
+        }
+
+        // Advances past the rest of a start tag (i.e., from anywhere after
+        // the '<' up to and including the '>'), skipping quoted attribute
+        // values.  Returns false if the end of the data is reached first.
+        // The 'empty' argument is set to true for an empty-element tag
+        // ("/>").
+        template <typename iterator_t>
+        bool skip_tag(iterator_t& it, const iterator_t& end, bool& empty)
+        {
+            bool slash = false;
+            while (it != end)
+            {
+                auto c = *it++;
+                if (c == '>')
+                {
+                    empty = slash;
+                    return true;
+                }
+                else if (c == '"' || c == '\'')
+                {
+                    while (it != end && *it != c) ++it;
+                    if (it == end) return false;
+                    ++it;
+                }
+                slash = (c == '/');
+            }
+            return false;
+        }
+
+        // Advances past the content and the close tag of an element whose
+        // start tag has already been skipped, by counting the start and end
+        // tags of nested elements.  Returns false if the end of the data is
+        // reached first.
+        template <typename iterator_t>
+        bool skip_content(iterator_t& it, const iterator_t& end)
+        {
+            size_t depth = 1;
+            while (it != end)
+            {
+                if (*it++ != '<') continue;
+                if (it == end) return false;
+
+                auto c = *it;
+                if (c == '/')
+                {
+                    if (!skip_past(it, end, ">")) return false;
+                    if (--depth == 0) return true;
+                }
+                else if (c == '?')
+                {
+                    if (!skip_past(it, end, "?>")) return false;
+                }
+                else if (c == '!')
+                {
+                    ++it;
+                    if (it != end && *it == '-')
+                    {
+                        if (!skip_past(it, end, "-->")) return false;
+                    }
+                    else if (it != end && *it == '[')
+                    {
+                        if (!skip_past(it, end, "]]>")) return false;
+                    }
+                    else if (!skip_past(it, end, ">")) return false;
+                }
+                else
+                {
+                    bool empty;
+                    if (!skip_tag(it, end, empty)) return false;
+                    if (!empty) depth++;
+                }
+            }
+            return false;
+        }
+
+        // The same as above, for bytes.
+        inline bool skip_past(const char*& it, const char* end, const char* s)
+        {
+            while (it != end)
+            {
+                it = util::simd::find(it, end, s[0]);
+                if (it == end) return false;
+                ++it;
+
+                const char* next = it;
+                const char* p = s + 1;
+                while (*p != 0 && next != end && *next == *p) { ++next; ++p; }
+                if (*p == 0) { it = next; return true; }
+            }
+            return false;
+        }
+
+        // The same as above, for bytes.
+        inline bool skip_tag(const char*& it, const char* end, bool& empty)
+        {
+            const char* start = it;
+            while (it != end)
+            {
+                it = util::simd::find_any(it, end, '>', '"', '\'');
+                if (it == end) return false;
+
+                char c = *it++;
+                if (c == '>')
+                {
+                    empty = it - 1 != start && it[-2] == '/';
+                    return true;
+                }
+
+                it = util::simd::find(it, end, c);
+                if (it == end) return false;
+                ++it;
+            }
+            return false;
+        }
+
+        // The same as above, for bytes.
+        inline bool skip_content(const char*& it, const char* end)
+        {
+            size_t depth = 1;
+            while (it != end)
+            {
+                it = util::simd::find(it, end, '<');
+                if (it == end) return false;
+                if (++it == end) return false;
+
+                char c = *it;
+                if (c == '/')
+                {
+                    if (!skip_past(it, end, ">")) return false;
+                    if (--depth == 0) return true;
+                }
+                else if (c == '?')
+                {
+                    if (!skip_past(it, end, "?>")) return false;
+                }
+                else if (c == '!')
+                {
+                    ++it;
+                    if (it != end && *it == '-')
+                    {
+                        if (!skip_past(it, end, "-->")) return false;
+                    }
+                    else if (it != end && *it == '[')
+                    {
+                        if (!skip_past(it, end, "]]>")) return false;
+                    }
+                    else if (!skip_past(it, end, ">")) return false;
+                }
+                else
+                {
+                    bool empty;
+                    if (!skip_tag(it, end, empty)) return false;
+                    if (!empty) depth++;
+                }
+            }
+            return false;
+        }
+
+        // Advances past the end of an element, from anywhere after the '<' 
+        // of its start tag (i.e., past the start tag, and then past the 
+        // content and close tag unless it's an empty-element tag).  Returns 
+        // false if the end of the data is reached first.
+        template <typename iterator_t>
+        bool skip_element(iterator_t& it, const iterator_t& end)
+        {
+            bool empty;
+            return skip_tag(it, end, empty) && (empty || skip_content(it, end));
+        }
+
+        // The same as above, but scans the underlying bytes when possible.
+        template <typename octet_iterator, typename enable>
+        bool skip_element(unicode::unicode_iterator<octet_iterator, enable>& it, const unicode::unicode_iterator<octet_iterator, enable>& end)
+        {
+            bool empty;
+            if (!it.has_ascii_bytes() || it == end)
+                return skip_tag(it, end, empty) && (empty || skip_content(it, end));
+
+            util::string_view bytes = it.ascii_bytes_to(end);
+            const char* p = bytes.data();
+            bool found = skip_tag(p, bytes.end(), empty) && (empty || skip_content(p, bytes.end()));
+            it = it.skip_bytes(p - bytes.data());
+            return found;
+        }
+
+        // Advances past the content and close tag of an element, like 
+        // skip_content(), but scans the underlying bytes when possible.
+        template <typename iterator_t>
+        bool skip_element_content(iterator_t& it, const iterator_t& end)
+        {
+            return skip_content(it, end);
+        }
+
+        // The same as above, for unicode_iterators.
+        template <typename octet_iterator, typename enable>
+        bool skip_element_content(unicode::unicode_iterator<octet_iterator, enable>& it, const unicode::unicode_iterator<octet_iterator, enable>& end)
+        {
+            if (!it.has_ascii_bytes() || it == end) return skip_content(it, end);
+
+            util::string_view bytes = it.ascii_bytes_to(end);
+            const char* p = bytes.data();
+            bool found = skip_content(p, bytes.end());
+            it = it.skip_bytes(p - bytes.data());
+            return found;
+        }
+    }
+}
\ No newline at end of file
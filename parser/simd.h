@@ -0,0 +1,190 @@
+#pragma once
+
+#include <assert.h>
+#include <stddef.h>
+#include <iterator>
+#include <string>
+#include <vector>
+#include <type_traits>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__)
+#define UTIL_SIMD_SSE2
+#include <emmintrin.h>
+#endif
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+namespace util
+{
+    // This namespace contains byte-scanning primitives used wherever the
+    // library needs to look at large runs of raw input (e.g., counting
+    // newlines).  Each function has an SSE2 implementation, which is used
+    // when the target supports it, and a plain loop that handles the tail
+    // of the input (and everything else when SSE2 isn't available).
+    namespace simd
+    {
+        // Returns the index of the lowest set bit in a non-zero mask.
+        inline unsigned first_bit(unsigned mask)
+        {
+#if defined(_MSC_VER)
+            unsigned long i;
+            _BitScanForward(&i, mask);
+            return i;
+#else
+            return __builtin_ctz(mask);
+#endif
+        }
+
+        // Returns a pointer to the first occurrence of 'c' in [first, last),
+        // or last if there isn't one.
+        inline const char* find(const char* first, const char* last, char c)
+        {
+#if defined(UTIL_SIMD_SSE2)
+            const __m128i needle = _mm_set1_epi8(c);
+            for (; last - first >= 16; first += 16)
+            {
+                __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(first));
+                unsigned mask = _mm_movemask_epi8(_mm_cmpeq_epi8(block, needle));
+                if (mask != 0) return first + first_bit(mask);
+            }
+#endif
+            for (; first != last; ++first)
+            {
+                if (*first == c) return first;
+            }
+            return last;
+        }
+
+        // Returns a pointer to the first occurrence of any of 'a', 'b' or 
+        // 'c' in [first, last), or last if there isn't one.
+        inline const char* find_any(const char* first, const char* last, char a, char b, char c)
+        {
+#if defined(UTIL_SIMD_SSE2)
+            const __m128i na = _mm_set1_epi8(a);
+            const __m128i nb = _mm_set1_epi8(b);
+            const __m128i nc = _mm_set1_epi8(c);
+            for (; last - first >= 16; first += 16)
+            {
+                __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(first));
+                __m128i matches = _mm_or_si128(
+                    _mm_or_si128(_mm_cmpeq_epi8(block, na), _mm_cmpeq_epi8(block, nb)),
+                    _mm_cmpeq_epi8(block, nc));
+                unsigned mask = _mm_movemask_epi8(matches);
+                if (mask != 0) return first + first_bit(mask);
+            }
+#endif
+            for (; first != last; ++first)
+            {
+                if (*first == a || *first == b || *first == c) return first;
+            }
+            return last;
+        }
+
+        // The same as above, for five characters (e.g., those that have to 
+        // be escaped in XML).
+        inline const char* find_any(const char* first, const char* last, char a, char b, char c, char d, char e)
+        {
+#if defined(UTIL_SIMD_SSE2)
+            const __m128i na = _mm_set1_epi8(a);
+            const __m128i nb = _mm_set1_epi8(b);
+            const __m128i nc = _mm_set1_epi8(c);
+            const __m128i nd = _mm_set1_epi8(d);
+            const __m128i ne = _mm_set1_epi8(e);
+            for (; last - first >= 16; first += 16)
+            {
+                __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(first));
+                __m128i matches = _mm_or_si128(
+                    _mm_or_si128(_mm_cmpeq_epi8(block, na), _mm_cmpeq_epi8(block, nb)),
+                    _mm_or_si128(_mm_cmpeq_epi8(block, nc), _mm_cmpeq_epi8(block, nd)));
+                matches = _mm_or_si128(matches, _mm_cmpeq_epi8(block, ne));
+                unsigned mask = _mm_movemask_epi8(matches);
+                if (mask != 0) return first + first_bit(mask);
+            }
+#endif
+            for (; first != last; ++first)
+            {
+                if (*first == a || *first == b || *first == c || *first == d || *first == e) return first;
+            }
+            return last;
+        }
+
+        // Returns true if [first, last) only holds ASCII characters (i.e., 
+        // no byte has its high bit set).
+        inline bool is_ascii(const char* first, const char* last)
+        {
+#if defined(UTIL_SIMD_SSE2)
+            for (; last - first >= 16; first += 16)
+            {
+                __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(first));
+                if (_mm_movemask_epi8(block) != 0) return false;
+            }
+#endif
+            for (; first != last; ++first)
+            {
+                if (static_cast<unsigned char>(*first) >= 0x80) return false;
+            }
+            return true;
+        }
+
+        // Returns the number of occurrences of 'c' in [first, last).
+        inline size_t count(const char* first, const char* last, char c)
+        {
+            size_t n = 0;
+#if defined(UTIL_SIMD_SSE2)
+            const __m128i needle = _mm_set1_epi8(c);
+            const __m128i zero = _mm_setzero_si128();
+            while (last - first >= 16)
+            {
+                // Matches are accumulated in 8-bit lanes, so at most 255
+                // blocks can be processed before the lanes are summed.
+                size_t blocks = (last - first) / 16;
+                if (blocks > 255) blocks = 255;
+
+                __m128i acc = zero;
+                for (size_t i = 0; i < blocks; i++, first += 16)
+                {
+                    __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(first));
+                    acc = _mm_sub_epi8(acc, _mm_cmpeq_epi8(block, needle));
+                }
+
+                __m128i sums = _mm_sad_epu8(acc, zero);
+                n += _mm_cvtsi128_si32(sums) + _mm_extract_epi16(sums, 4);
+            }
+#endif
+            for (; first != last; ++first)
+            {
+                if (*first == c) n++;
+            }
+            return n;
+        }
+    }
+
+    // This meta-function returns true if the iterator type is known to refer
+    // to contiguous storage, in which case the scanning functions above can
+    // be used on the underlying memory directly.
+    template <typename iterator_t>
+    struct is_contiguous
+    {
+        typedef typename std::iterator_traits<iterator_t>::value_type value_type;
+
+        static const bool value =
+            std::is_pointer<iterator_t>::value ||
+            std::is_same<iterator_t, typename std::basic_string<value_type>::iterator>::value ||
+            std::is_same<iterator_t, typename std::basic_string<value_type>::const_iterator>::value ||
+            std::is_same<iterator_t, typename std::vector<value_type>::iterator>::value ||
+            std::is_same<iterator_t, typename std::vector<value_type>::const_iterator>::value;
+    };
+
+    // Returns a pointer to the memory referred to by a contiguous iterator.
+    // The range [first, last) must not be empty, since dereferencing an end
+    // iterator isn't allowed (and is checked in debug builds).
+    template <typename iterator_t>
+    const typename std::iterator_traits<iterator_t>::value_type* to_pointer(const iterator_t& first, const iterator_t& last)
+    {
+        static_assert(is_contiguous<iterator_t>::value, "to_pointer requires a contiguous iterator");
+        assert(first != last);
+        return &*first;
+    }
+}
\ No newline at end of file
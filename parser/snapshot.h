@@ -0,0 +1,424 @@
+#pragma once
+
+#include <stdint.h>
+#include <string.h>
+#include <exception>
+#include <fstream>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
+#include "mapped_file.h"
+#include "name_table.h"
+#include "string_view.h"
+#include "tree.h"
+
+namespace xml
+{
+    namespace tree
+    {
+        // This class saves documents as snapshots, i.e., files that hold a
+        // document's arrays (nodes, attributes and text, which refer to each
+        // other by index rather than by pointer) exactly as they are in
+        // memory, along with its names.  load() maps a snapshot and uses the
+        // arrays in place, so that loading a document doesn't parse or copy
+        // anything.  It only checks that the indices in the arrays are within
+        // bounds (in one pass over the nodes and attributes, which is much
+        // faster than parsing), so that a corrupt snapshot is rejected rather
+        // than read out of bounds.  The arrays are only copied if the
+        // document is edited.  The hashes of the nodes (see
+        // document::compute_hashes()) are saved too, if the document has
+        // them, and a document loaded with load_shared is still shared (and
+        // can't be edited) when it is loaded.
+        //
+        // Each snapshot records a checksum of the XML it was built from, and
+        // load() doesn't accept a snapshot of a different source (or of a
+        // different version of the format), in which case the source should
+        // be parsed again, and a new snapshot saved.  Snapshots are meant to
+        // be read on the kind of machine that wrote them (they record its
+        // byte order, and aren't accepted elsewhere).
+        class snapshot
+        {
+            struct section
+            {
+                uint64_t offset;
+                uint64_t count;
+            };
+
+            struct header
+            {
+                char magic[8];
+                uint32_t version;
+                uint32_t byte_order;
+                uint64_t checksum;
+                uint64_t file_size;
+                uint64_t flags;
+                section nodes;
+                section attributes;
+                section strings;
+
+                // Either empty, or one for each node.
+                section hashes;
+
+                // The names, as spans of name_text, in order of name_id.
+                section names;
+                section name_text;
+            };
+
+            static_assert(sizeof(node_data) == 24, "The snapshot format requires 24-byte nodes");
+            static_assert(sizeof(attribute_data) == 12, "The snapshot format requires 12-byte attributes");
+            static_assert(sizeof(string_span) == 8, "The snapshot format requires 8-byte spans");
+
+            static const char* magic() { return "XMLSNAP"; }
+            static uint32_t byte_order() { return 0x01020304; }
+
+            // The flags of the header.
+            static const uint64_t shared_flag = 1;
+
+            // Reserves a section at 'offset', and moves 'offset' past it
+            // (keeping sections 8-byte aligned).
+            static section place(uint64_t& offset, size_t count, size_t size)
+            {
+                section s = { offset, count };
+                offset += (count * size + 7) & ~static_cast<uint64_t>(7);
+                return s;
+            }
+
+            static void write(std::ostream& out, const void* data, size_t size)
+            {
+                static const char padding[8] = {};
+                if (size != 0) out.write(static_cast<const char*>(data), size);
+                out.write(padding, (8 - size % 8) % 8);
+            }
+
+            static bool is_valid(const section& s, size_t size, uint64_t file_size)
+            {
+                return s.offset % 8 == 0 && s.offset <= file_size && s.count <= (file_size - s.offset) / size;
+            }
+
+            template <typename T>
+            static const T* at(const util::mapped_file& file, const section& s)
+            {
+                return reinterpret_cast<const T*>(file.data() + s.offset);
+            }
+
+            // Copies the strings of a document that are in its string pool into
+            // its text (once for each distinct string), since the handles are
+            // only meaningful in that pool.
+            struct unpooled
+            {
+                std::vector<node_data> nodes;
+                std::vector<attribute_data> attributes;
+                std::string strings;
+                std::unordered_map<string_handle, string_span> copies;
+
+                explicit unpooled(const document& doc)
+                    : nodes(doc.nodes.data(), doc.nodes.data() + doc.nodes.size()),
+                      attributes(doc.attributes.data(), doc.attributes.data() + doc.attributes.size()),
+                      strings(doc.strings.data(), doc.strings.size())
+                {
+                    for (auto& n : nodes)
+                    {
+                        if (n.kind != text_node) continue;
+
+                        string_span s = { n.first, n.count };
+                        copy(doc, s);
+                        n.first = s.offset;
+                        n.count = s.length;
+                    }
+
+                    for (auto& a : attributes) copy(doc, a.value);
+                }
+
+                void copy(const document& doc, string_span& s)
+                {
+                    if (!(s.length & pooled_string)) return;
+
+                    auto it = copies.find(s.offset);
+                    if (it == copies.end())
+                    {
+                        util::string_view text = doc.view(s);
+                        string_span copied = { static_cast<uint32_t>(strings.size()), static_cast<uint32_t>(text.size()) };
+                        strings.append(text.data(), text.size());
+                        if (strings.size() > 0xFFFFFFFF) throw std::exception("Document too large");
+                        it = copies.insert(std::make_pair(s.offset, copied)).first;
+                    }
+                    s = it->second;
+                }
+            };
+
+            static bool in_bounds(const string_span& s, uint64_t size)
+            {
+                return !(s.length & pooled_string) && static_cast<uint64_t>(s.offset) + s.length <= size;
+            }
+
+            static bool is_link(node_index i, uint64_t count)
+            {
+                return i == no_node || i < count;
+            }
+
+            // Returns true if the arrays of a snapshot are consistent: every 
+            // index, name ID, string and name is within bounds, and the links 
+            // between the nodes can't form a cycle (so following them always 
+            // ends).  A sibling always comes after the previous one, and 
+            // unless the document is shared (see load_shared), a first child 
+            // comes after its parent, which rules out cycles.  Shared elements 
+            // refer to earlier children, so shared documents are searched for 
+            // cycles.
+            static bool is_consistent(const header& h, const node_data* nodes, const attribute_data* attributes,
+                const string_span* names)
+            {
+                for (uint64_t i = 0; i < h.names.count; i++)
+                {
+                    if (!in_bounds(names[i], h.name_text.count)) return false;
+                }
+
+                bool shared = (h.flags & shared_flag) != 0;
+                for (uint64_t i = 0; i < h.nodes.count; i++)
+                {
+                    const node_data& n = nodes[i];
+                    if (!is_link(n.first_child, h.nodes.count) || !is_link(n.next_sibling, h.nodes.count)) return false;
+                    if (n.next_sibling != no_node && n.next_sibling <= i) return false;
+
+                    // The kind is read as an integer, since a corrupt value 
+                    // isn't a valid node_kind.
+                    std::underlying_type<node_kind>::type kind;
+                    memcpy(&kind, &n.kind, sizeof(kind));
+
+                    if (kind == text_node)
+                    {
+                        string_span s = { n.first, n.count };
+                        if (n.first_child != no_node || !in_bounds(s, h.strings.count)) return false;
+                    }
+                    else if (kind == element_node)
+                    {
+                        if (n.name >= h.names.count || static_cast<uint64_t>(n.first) + n.count > h.attributes.count) return false;
+                        if (!shared && n.first_child != no_node && n.first_child <= i) return false;
+                    }
+                    else
+                    {
+                        return false;
+                    }
+                }
+
+                for (uint64_t i = 0; i < h.attributes.count; i++)
+                {
+                    if (attributes[i].name >= h.names.count || !in_bounds(attributes[i].value, h.strings.count)) return false;
+                }
+                return !shared || is_acyclic(nodes, static_cast<size_t>(h.nodes.count));
+            }
+
+            // Searches the links from the root depth first, keeping track of 
+            // the nodes on the current path (a link to one of them is a 
+            // cycle).  Each node is only searched from once.
+            static bool is_acyclic(const node_data* nodes, size_t count)
+            {
+                enum { unvisited, on_path, done };
+                std::vector<unsigned char> state(count, unvisited);
+                std::vector<node_index> stack;
+                if (count != 0) stack.push_back(0);
+
+                while (!stack.empty())
+                {
+                    node_index i = stack.back();
+                    if (state[i] != unvisited)
+                    {
+                        state[i] = done;
+                        stack.pop_back();
+                        continue;
+                    }
+
+                    state[i] = on_path;
+                    node_index links[] = { nodes[i].first_child, nodes[i].next_sibling };
+                    for (auto next : links)
+                    {
+                        if (next == no_node) continue;
+                        if (state[next] == on_path) return false;
+                        if (state[next] == unvisited) stack.push_back(next);
+                    }
+                }
+                return true;
+            }
+
+            // Makes sure that all of the elements of a lazily loaded document
+            // have been parsed.
+            static void expand(const element& e)
+            {
+                for (auto child : e.elements()) expand(child);
+            }
+
+        public:
+            // Incremented whenever the format changes.
+            static const uint32_t version = 2;
+
+            // Returns the checksum of a document's source, which is stored in
+            // its snapshot.  It reads eight bytes at a time, so it is much
+            // faster than parsing the source.
+            static uint64_t checksum(const char* data, size_t size)
+            {
+                return util::hash_bytes64(data, size);
+            }
+
+            static uint64_t checksum(const util::string_view& source)
+            {
+                return checksum(source.data(), source.size());
+            }
+
+            // Writes a snapshot of a document (which is fully parsed first,
+            // if it was loaded lazily), given the checksum of its source.
+            // The document's name table is saved as a whole, so documents
+            // that share a table with many others make larger snapshots.  The
+            // strings of a document that has a string pool are saved with it
+            // (and aren't pooled when it is loaded).
+            static void save(const document& doc, uint64_t source_checksum, std::ostream& out)
+            {
+                if (doc.load) expand(doc.root());
+
+                const node_data* nodes = doc.nodes.data();
+                const attribute_data* attributes = doc.attributes.data();
+                util::string_view strings(doc.strings.data(), doc.strings.size());
+
+                std::unique_ptr<unpooled> copy;
+                if (doc.pool())
+                {
+                    copy.reset(new unpooled(doc));
+                    nodes = copy->nodes.data();
+                    attributes = copy->attributes.data();
+                    strings = util::string_view(copy->strings);
+                }
+
+                const name_table& names = doc.names();
+                std::vector<string_span> name_spans;
+                std::string name_text;
+                for (size_t i = 0; i < names.size(); i++)
+                {
+                    util::string_view name = names.name(static_cast<name_id>(i));
+                    string_span s = { static_cast<uint32_t>(name_text.size()), static_cast<uint32_t>(name.size()) };
+                    name_spans.push_back(s);
+                    name_text.append(name.data(), name.size());
+                }
+
+                header h;
+                memset(&h, 0, sizeof(h));
+                memcpy(h.magic, magic(), 8);
+                h.version = version;
+                h.byte_order = byte_order();
+                h.checksum = source_checksum;
+                h.flags = doc.shared ? shared_flag : 0;
+                size_t hash_count = doc.has_hashes() ? doc.hashes.size() : 0;
+
+                uint64_t offset = sizeof(header);
+                h.nodes = place(offset, doc.nodes.size(), sizeof(node_data));
+                h.attributes = place(offset, doc.attributes.size(), sizeof(attribute_data));
+                h.strings = place(offset, strings.size(), 1);
+                h.hashes = place(offset, hash_count, sizeof(uint64_t));
+                h.names = place(offset, name_spans.size(), sizeof(string_span));
+                h.name_text = place(offset, name_text.size(), 1);
+                h.file_size = offset;
+
+                write(out, &h, sizeof(h));
+                write(out, nodes, doc.nodes.size() * sizeof(node_data));
+                write(out, attributes, doc.attributes.size() * sizeof(attribute_data));
+                write(out, strings.data(), strings.size());
+                write(out, doc.hashes.data(), hash_count * sizeof(uint64_t));
+                write(out, name_spans.data(), name_spans.size() * sizeof(string_span));
+                write(out, name_text.data(), name_text.size());
+
+                if (!out) throw std::exception("Can't write the snapshot");
+            }
+
+            static void save(const document& doc, uint64_t source_checksum, const std::string& path)
+            {
+                std::ofstream out(path.c_str(), std::ios::binary | std::ios::trunc);
+                if (!out) throw std::exception("Can't create the snapshot");
+                save(doc, source_checksum, out);
+            }
+
+            // Maps a snapshot, and returns a document that uses it in place.
+            // Returns an empty pointer if the file isn't a snapshot of the
+            // source with the specified checksum, in this version of the
+            // format (e.g., if the source changed, or the file was only
+            // partially written), or if it is corrupt (see is_consistent()).
+            // Throws std::exception if the file can't be opened.
+            //
+            // The names are interned in the specified table.  If it isn't
+            // empty, the IDs of the names may differ from those in the
+            // snapshot, in which case the nodes and attributes are copied,
+            // to renumber them.
+            static std::shared_ptr<document> load(const std::string& path, uint64_t source_checksum,
+                const std::shared_ptr<name_table>& names = std::make_shared<name_table>())
+            {
+                std::shared_ptr<util::mapped_file> file = std::make_shared<util::mapped_file>(path);
+                if (file->size() < sizeof(header)) return nullptr;
+
+                header h;
+                memcpy(&h, file->data(), sizeof(h));
+                if (memcmp(h.magic, magic(), 8) != 0 || h.version != version || h.byte_order != byte_order() ||
+                    h.checksum != source_checksum || h.file_size != file->size())
+                {
+                    return nullptr;
+                }
+
+                if (!is_valid(h.nodes, sizeof(node_data), h.file_size) ||
+                    !is_valid(h.attributes, sizeof(attribute_data), h.file_size) ||
+                    !is_valid(h.strings, 1, h.file_size) ||
+                    !is_valid(h.hashes, sizeof(uint64_t), h.file_size) ||
+                    !is_valid(h.names, sizeof(string_span), h.file_size) ||
+                    !is_valid(h.name_text, 1, h.file_size))
+                {
+                    return nullptr;
+                }
+
+                // The nodes of a shared document can't be hashed again, since
+                // they aren't in the order that compute_hashes() requires.
+                if ((h.hashes.count != 0 && h.hashes.count != h.nodes.count) ||
+                    ((h.flags & shared_flag) && h.hashes.count == 0))
+                {
+                    return nullptr;
+                }
+
+                // Everything is checked before the names are interned, so 
+                // that a corrupt snapshot doesn't add names to the table 
+                // (which may be shared with other documents).
+                const string_span* name_spans = at<string_span>(*file, h.names);
+                if (!is_consistent(h, at<node_data>(*file, h.nodes), at<attribute_data>(*file, h.attributes), name_spans)) return nullptr;
+
+                std::shared_ptr<document> doc(new document(names));
+                doc->mapping = file;
+                doc->nodes.map(at<node_data>(*file, h.nodes), static_cast<size_t>(h.nodes.count));
+                doc->attributes.map(at<attribute_data>(*file, h.attributes), static_cast<size_t>(h.attributes.count));
+                doc->strings.map(at<char>(*file, h.strings), static_cast<size_t>(h.strings.count));
+                doc->hashes.map(at<uint64_t>(*file, h.hashes), static_cast<size_t>(h.hashes.count));
+                doc->shared = (h.flags & shared_flag) != 0;
+
+                const char* name_text = at<char>(*file, h.name_text);
+                std::vector<name_id> ids(static_cast<size_t>(h.names.count));
+                bool renumber = false;
+                for (size_t i = 0; i < ids.size(); i++)
+                {
+                    string_span s = name_spans[i];
+                    ids[i] = names->intern(util::string_view(name_text + s.offset, s.length));
+                    if (ids[i] != i) renumber = true;
+                }
+
+                if (renumber)
+                {
+                    for (size_t i = 0; i < doc->nodes.size(); i++)
+                    {
+                        name_id id = doc->nodes[i].name;
+                        if (id < ids.size()) doc->nodes[i].name = ids[id];
+                    }
+
+                    for (size_t i = 0; i < doc->attributes.size(); i++)
+                    {
+                        name_id id = doc->attributes[i].name;
+                        if (id < ids.size()) doc->attributes[i].name = ids[id];
+                    }
+                }
+                return doc;
+            }
+        };
+    }
+}
\ No newline at end of file
@@ -0,0 +1,118 @@
+#pragma once
+
+#include <assert.h>
+#include <stdint.h>
+#include <string.h>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include "string_view.h"
+
+namespace xml
+{
+    // Identifies a string within a string_pool.
+    typedef uint32_t string_handle;
+
+    // This class stores each distinct string (e.g., an attribute value such
+    // as "AA_INT" or "0x0") once, no matter how many times it occurs, so
+    // that the memory taken by many similar documents depends on the number
+    // of distinct values rather than the number of values (see
+    // tree::document, which can keep its attribute values and short text
+    // nodes in a pool).  Strings are never removed, and their handles and
+    // views remain valid for the lifetime of the pool.
+    //
+    // A pool can be shared by any number of documents, and used by several
+    // threads at once.  Adding a string takes a lock, but reading one
+    // doesn't: the strings are stored in blocks that never move, along with
+    // their lengths, and a handle is a string's position in the blocks, so
+    // view() only reads the pool's memory.
+    class string_pool
+    {
+        static const size_t block_size = 1 << 20;
+
+        // The handles are 32-bit positions, which limits a pool to 4GB.
+        static const size_t max_blocks = 4096;
+
+        // Each string is preceded by its length, in two bytes.
+        static const size_t prefix_size = 2;
+
+        std::unique_ptr<char[]> blocks[max_blocks];
+        size_t block_count;
+
+        // The number of bytes used in the last block.
+        size_t used;
+
+        size_t limit;
+        std::unordered_map<util::string_view, string_handle> handles;
+        mutable std::mutex mutex;
+
+        string_pool(const string_pool&);
+        string_pool& operator= (const string_pool&);
+
+    public:
+        // Strings longer than 'max_length' bytes aren't pooled.  The default 
+        // covers attribute values and short text nodes, which is where the 
+        // repetition is.  Longer text is seldom repeated, and pooling it 
+        // would only grow a pool that is never freed.  A caller whose 
+        // documents repeat long text (e.g., descriptions) can raise the 
+        // limit, up to 65535 bytes.
+        explicit string_pool(size_t max_length = 64)
+            : block_count(0), used(block_size), limit(max_length)
+        {
+            if (max_length > 0xFFFF) throw std::exception("Pooled strings can't be longer than 65535 bytes");
+        }
+
+        size_t max_length() const { return limit; }
+
+        // Returns the handle of a string, adding it to the pool if necessary.
+        // The string can't be longer than max_length().
+        string_handle intern(const util::string_view& s)
+        {
+            assert(s.size() <= limit);
+            std::lock_guard<std::mutex> lock(mutex);
+
+            auto it = handles.find(s);
+            if (it != handles.end()) return it->second;
+
+            if (used + prefix_size + s.size() > block_size)
+            {
+                if (block_count == max_blocks) throw std::exception("String pool too large");
+                blocks[block_count++].reset(new char[block_size]);
+                used = 0;
+            }
+
+            char* p = blocks[block_count - 1].get() + used;
+            p[0] = static_cast<char>(s.size() & 0xFF);
+            p[1] = static_cast<char>(s.size() >> 8);
+            if (!s.empty()) memcpy(p + prefix_size, s.data(), s.size());
+
+            string_handle h = static_cast<string_handle>((block_count - 1) * block_size + used);
+            used += prefix_size + s.size();
+            handles.insert(std::make_pair(util::string_view(p + prefix_size, s.size()), h));
+            return h;
+        }
+
+        // Returns the string with the specified handle.
+        util::string_view view(string_handle h) const
+        {
+            const char* p = blocks[h / block_size].get() + h % block_size;
+            size_t length = static_cast<unsigned char>(p[0]) | (static_cast<unsigned char>(p[1]) << 8);
+            return util::string_view(p + prefix_size, length);
+        }
+
+        // Returns the number of distinct strings.
+        size_t size() const
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            return handles.size();
+        }
+
+        // Returns the number of bytes taken by the strings' blocks.
+        size_t memory_size() const
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            return block_count * block_size;
+        }
+    };
+}
\ No newline at end of file
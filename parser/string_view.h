@@ -0,0 +1,114 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <algorithm>
+#include <functional>
+#include <ostream>
+#include <string>
+
+namespace util
+{
+    // Returns the 64-bit FNV-1a hash of a buffer (truncated to size_t on
+    // 32-bit targets).  It is cheap to compute on short strings, such as
+    // element and attribute names.
+    inline size_t hash_bytes(const char* data, size_t size)
+    {
+        unsigned long long h = 14695981039346656037ULL;
+        for (size_t i = 0; i < size; i++)
+        {
+            h ^= static_cast<unsigned char>(data[i]);
+            h *= 1099511628211ULL;
+        }
+        return static_cast<size_t>(h);
+    }
+
+    // Returns a 64-bit hash of a buffer, reading eight bytes at a time, so 
+    // that it is cheap to compute on large buffers (e.g., whole documents).
+    inline uint64_t hash_bytes64(const char* data, size_t size)
+    {
+        const uint64_t k = 0x9E3779B97F4A7C15ULL;
+        uint64_t h = k ^ size;
+
+        size_t i = 0;
+        for (; i + 8 <= size; i += 8)
+        {
+            uint64_t w;
+            memcpy(&w, data + i, 8);
+            h = ((h << 5 | h >> 59) ^ w) * k;
+        }
+
+        uint64_t w = 0;
+        if (i != size) memcpy(&w, data + i, size - i);
+        h = ((h << 5 | h >> 59) ^ w) * k;
+        return h ^ (h >> 32);
+    }
+
+    // This class refers to a range of characters that is owned by someone
+    // else (e.g., the buffer being parsed), so that it can be compared,
+    // hashed and copied without any decoding or allocation.  It is a subset
+    // of C++17's std::string_view, which isn't available in all of the
+    // compilers we support.
+    class string_view
+    {
+        const char* ptr;
+        size_t len;
+
+    public:
+        typedef char value_type;
+        typedef const char* iterator;
+        typedef const char* const_iterator;
+
+        string_view() : ptr(nullptr), len(0) {}
+
+        string_view(const char* data, size_t size) : ptr(data), len(size) {}
+
+        string_view(const char* s) : ptr(s), len(strlen(s)) {}
+
+        string_view(const std::string& s) : ptr(s.data()), len(s.size()) {}
+
+        const char* data() const { return ptr; }
+        size_t size() const { return len; }
+        bool empty() const { return len == 0; }
+
+        iterator begin() const { return ptr; }
+        iterator end() const { return ptr + len; }
+
+        char operator[] (size_t i) const { return ptr[i]; }
+
+        std::string str() const { return std::string(ptr, len); }
+
+        operator std::string() const { return str(); }
+
+        int compare(const string_view& rhs) const
+        {
+            int result = len == 0 || rhs.len == 0 ? 0 : memcmp(ptr, rhs.ptr, std::min(len, rhs.len));
+            if (result != 0) return result;
+            return len < rhs.len ? -1 : (len > rhs.len ? 1 : 0);
+        }
+
+        bool operator== (const string_view& rhs) const
+        {
+            return len == rhs.len && (len == 0 || memcmp(ptr, rhs.ptr, len) == 0);
+        }
+
+        bool operator!= (const string_view& rhs) const { return !(*this == rhs); }
+        bool operator< (const string_view& rhs) const { return compare(rhs) < 0; }
+
+        size_t hash() const { return hash_bytes(ptr, len); }
+    };
+
+    inline std::ostream& operator<< (std::ostream& lhs, const string_view& rhs)
+    {
+        return lhs.write(rhs.data(), rhs.size());
+    }
+}
+
+namespace std
+{
+    template <> struct hash<util::string_view>
+    {
+        size_t operator() (const util::string_view& s) const { return s.hash(); }
+    };
+}
\ No newline at end of file
@@ -1,441 +1,2367 @@
-// test.cpp : Defines the entry point for the console application.
-//
-
-#include "stdafx.h"
-
-// The extensive use of templates causes this "decorated name length too 
-// long" warning all over the place.  Since we aren't exporting any of these 
-// template instanciations in a library, it is safe to ignore.
-#pragma warning( disable : 4503 )
-
-#include <string>
-#include <fstream>
-#include <sstream>
-#include <iostream>
-#include <algorithm>
-#include <iterator>
-
-#include "stream_container.h"
-#include "parse\parse.h"
-#include "tree.h"
-#include "reader.h"
-
-// This demonstrates using a custom AST type to have more type-safe access to 
-// elements.  Instead of using the operator[] overloads directly, these AST 
-// classes add named accessor methods to retrieve the various parts of the 
-// underlying AST.  Note that the get accessor's themselves are using the
-// "unsafe" operator[]'s, but once they are written, any code that uses those
-// AST types can use the custom methods, which won't compile if the grammar is
-// modified.  The operator[]'s on the other hand, will generally just silently
-// start grabbing the wrong part of the AST.
-// A downside to this method is that we seem to get some strange errors in 
-// xlocnum.h, associated with bringing the parse::operators namespace in to 
-// scope alongside the accessors.
-#if 0
-namespace custom_ast_test
-{
-    using namespace parse::terminals;
-    using namespace parse::operators;
-
-    static u<'1'> uone;
-    static u<'2'> utwo;
-    static u<'3'> uthree;
-
-    typedef decltype(uone >> utwo >> uthree) base_t;
-
-    struct parser_t : public base_t
-    {
-        template <typename iterator_t>
-        struct ast : public parse::ast_type<base_t, iterator_t>::type
-        {
-            typedef ast type;
-            
-            typename parse::ast_type<decltype(uone), iterator_t>::type& get_one()
-            {
-                return (*this)[util::_0];
-            }
-
-            typename parse::ast_type<decltype(utwo), iterator_t>::type& get_two()
-            {
-                return (*this)[util::_1];
-            }
-
-            typename parse::ast_type<decltype(uthree), iterator_t>::type& get_three()
-            {
-                return (*this)[util::_2];
-            }
-        };
-    };
-
-    typedef decltype(utwo >> uthree >> parser_t()) base2_t;
-
-    struct parser2_t : public base2_t
-    {
-        template <typename iterator_t>
-        struct ast : public base2_t::ast<iterator_t>::type
-        {
-            typedef ast type;
-            
-            typename parse::ast_type<parser_t, iterator_t>::type& get_one()
-            {
-                return (*this)[util::_2];
-            }
-
-            typename parse::ast_type<decltype(utwo), iterator_t>::type& get_two()
-            {
-                return (*this)[util::_0];
-            }
-
-            typename parse::ast_type<decltype(uthree), iterator_t>::type& get_three()
-            {
-                return (*this)[util::_1];
-            }
-        };
-    };
-
-    void foo()
-    {
-        parser2_t p;
-        std::string data("23123");
-        parse::ast_type<parser2_t, std::string::iterator>::type ast;
-        p.parse(data, ast);
-
-        auto& c1 = ast.get_one();
-        auto& c2 = ast.get_two();
-        auto& c3 = ast.get_three();
-
-        auto& c1c1 = c1.get_one();
-        auto& c1c2 = c1.get_two();
-        auto& c1c3 = c1.get_three();
-    }
-}
-#endif
-
-#if 1
-namespace ast_tag_test
-{
-    using namespace parse;
-    using namespace parse::operators;
-    using namespace parse::terminals;
-
-    auto one = u<'1'>();
-    auto num = +digit();
-    auto lparen = u<'('>();
-    auto rparen = u<')'>();
-    auto ws = +space();
-
-    struct s_expr;
-
-    typedef decltype(num[_0] | reference<s_expr>()[_1]) elem_t;
-
-    typedef decltype(lparen >> *space() >> elem_t()[_0] >> (*(+space() >> elem_t()))[_1] >> *space() >> rparen) s_expr_t;
-
-    struct s_expr : s_expr_t {};
-
-    typedef decltype(num[_0] >> ws >> s_expr()[_1]) parser;
-
-    void test()
-    {
-        typedef std::string::iterator it_t;
-        std::string data("((1) 2 3 (2 33 345) ((((1234)))))");
-        typedef parse::parser_ast<parser, std::string::iterator>::type ast_t;
-        ast_t ast;
-        typedef parser p_type;
-
-        bool valid = parser::parse_from(data.begin(), data.end(), ast);
-    }
-}
-#endif
-
-template <typename container_t>
-void read_dump(container_t& c)
-{
-    xml::reader::document<container_t> doc(c);
-    auto root = doc.root();
-    dump_element(root, 0);
-}
-
-template <typename iterator_t>
-void dump_element(xml::reader::element<iterator_t>& e, int indent)
-{
-    //std::cout << indent << "element: " << e.name() << std::endl;
-    //std::cout << indent << "attributes: ";
-
-    xml::reader::attribute<iterator_t> a = e.next_attribute();
-    if (a.is_end())
-    {
-        //std::cout << "(none)" << std::endl;
-    }
-    else
-    {
-        //std::cout << std::endl;
-
-        for (; !a.is_end(); a = a.next_attribute())
-        {
-            //std::cout << indent << "  " << a.name() << "=" << a.value() << std::endl;
-        }
-    }
-
-    auto nextIndent = indent + 2;
-    //std::cout << indent << "childnodes: ";
-    xml::reader::node<iterator_t> child = a.next_child();
-    if (child.is_end())
-    {
-        //std::cout << "(none)" << std::endl;
-    }
-    else
-    {
-        //std::cout << std::endl;
-        for (; !child.is_end(); child = child.next_sibling())
-        {
-            if (child.is_text())
-            {
-                //std::cout << nextIndex << "textnode: " << child.text() << std::endl;
-            }
-            else
-                dump_element(child.element(), nextIndent);
-        }
-    }
-}
-
-#include <Windows.h>
-long long time()
-{
-    /* Windows */
-    FILETIME ft;
-    LARGE_INTEGER li;
-
-    /* Get the amount of 100 nano seconds intervals elapsed since January 1, 1601 (UTC) and copy it
-    * to a LARGE_INTEGER structure. */
-    GetSystemTimeAsFileTime(&ft);
-    li.LowPart = ft.dwLowDateTime;
-    li.HighPart = ft.dwHighDateTime;
-
-    return li.QuadPart;
-}
-
-int _tmain(int argc, _TCHAR* argv[])
-{
-    ast_tag_test::test();
-
-#if 0
-    /* Pruned AST test */
-    {
-        using namespace placeholders;
-        using namespace parse;
-        using namespace parse::operators;
-        using namespace parse::terminals;
-
-        auto a = u<'a'>();
-        auto b = u<'b'>();
-
-        auto p = (a | b) >> a[_0] >> b[_1] >> (a | b)[_3];
-
-        typedef decltype(p) p_type;
-
-        typedef parse::parser_ast<p_type, std::string::iterator>::type ast_type;
-        ast_type ast;
-
-        std::string data("baba");
-
-        bool valid = p.parse_from(data.begin(), data.end(), ast);
-
-        auto& m0 = ast[_0];
-        auto& m1 = ast[_1];
-        auto& m3 = ast[_3];
-
-        std::cout << std::endl;
-    }
-#endif
-
-  /* Unicode tests
-  //std::string v = "\xEF\xBB\xBFthis is a UTF8-encoded string with a BOM.";
-  //std::string v = "this is a UTF8-encoded string without a BOM.";
-  std::wstring wv(L"\uFEFFthis is a UTF16-encoded string with a BOM.");
-  std::string v((const char*)wv.c_str(), wv.size() * 2);
-
-  unicode::unicode_container<std::string> ustring(v);
-
-  auto i = ustring.begin();
-  auto end = ustring.end();
-
-  for (; i != end; i++)
-  {
-      std::cout << "char: " << (char)*i << std::endl;
-  }
-  */
-
-    /* XML parser test
-    using namespace parse;
-    using namespace parse::operators;
-
-    std::string test_data("<?xml encoding='UTF-8'?><nspre:root attribute1=\"value1\">");
-    auto p = xml::parser::prolog() >> xml::parser::element_open();
-    parse::ast_type<decltype(p), std::string::iterator>::type p_ast;
-    bool valid = p.parse(test_data, p_ast);
-    */
-
-    // XML reader test
-
-    // UTF-8 encoding
-    //std::string xml_data("\xEF\xBB\xBF<?xml encoding='UTF-8'?><nspre:root attribute1=\"value1\">root content part 1<ns:child1>child1 content<grandchild11></grandchild11></ns:child1><child2>child2 content</child2></nspre:root>");
-    
-    // UTF-16 encoding
-    //std::wstring wxml_data(L"\uFFFE<?xml encoding='UTF-8'?><nspre:root attribute1=\"value1\">root content part 1<ns:child1>child1 content<grandchild11></grandchild11></ns:child1><child2>child2 content</child2></nspre:root>");
-    //std::string xml_data((const char*)wxml_data.c_str(), wxml_data.size() * 2);
-
-    // UTF-16 native string (with and without BOM)
-    //std::wstring xml_data(L"<?xml encoding='UTF-8'?><nspre:root attribute1=\"value1\">root content part 1<ns:child1>child1 content<grandchild11/></ns:child1><child2>child2 content</child2></nspre:root>");
-    //std::wstring xml_data(L"\uFFFE<?xml encoding='UTF-8'?><nspre:root attribute1=\"value1\">root content part 1<ns:child1>child1 content<grandchild11></grandchild11></ns:child1><child2>child2 content</child2></nspre:root>");
-
-    // String stream parsing
-    //std::stringstream stream_data("<?xml encoding='UTF-8'?><nspre:root attribute1=\"value1\"  attribute2='value2'>root content part 1<ns:child1>child1 content<grandchild11 a='123' /></ns:child1><child2>child2 content</child2></nspre:root>");
-    //util::streambuf_container<std::streambuf> xml_data(stream_data.rdbuf());
-
-    // File parsing
-    std::ifstream ifs;
-    ifs.open("test\\cfg_test.cfg", std::ios::in | std::ios::binary);
-    std::string xml_data(std::istreambuf_iterator<char>(ifs.rdbuf()), std::istreambuf_iterator<char>());
-    //util::streambuf_container<std::streambuf> xml_data(ifs.rdbuf());
-
-    typedef decltype(xml_data) data_type;
-
-    long long t1, t2;
-
-    /* stream performance test */
-#if 1
-    for (int i = 0; i < 2; i++)
-    {
-        unicode::unicode_container<std::string> uc(xml_data);
-        t1 = time();
-        auto begin = uc.begin();
-        auto end = uc.end();
-        for (auto i = begin; i != end; i++);
-        t2 = time();
-        std::cout << "stream iterate time: " << double(t2 - t1)/10000 << std::endl;
-
-        std::string copy;
-        copy.resize(xml_data.size());
-        t1 = time();
-        utf8::utf32to8(uc.begin(), uc.end(), std::back_inserter(copy));
-        t2 = time();
-        std::cout << "stream copy time: " << double(t2 - t1)/10000 << std::endl;
-    }
-#endif
-
-    /* XML Tree Test */
-#if 1
-    t1 = time();
-    xml::tree::document doc(xml_data);
-    t2 = time();
-    std::cout << "tree parse elapsed time: " << double(t2 - t1)/10000 << std::endl;
-#endif
-
-    /* XML Reader Test */
-#if 1
-    std::cout.setstate(std::ios_base::badbit);
-    t1 = time();
-    read_dump(xml_data);
-    t2 = time();
-    std::cout.clear();
-    std::cout << "reader parse time: " << double(t2 - t1)/10000 << std::endl;
-#endif
-
-#if 1
-    /* XML parse-only test */
-    {
-        t1 = time();
-        auto start = xml_data.begin();
-        bool valid = xml::grammar::document::parse_from(start, xml_data.end());
-        t2 = time();
-        std::cout << "parse-only time: " << double(t2 - t1)/10000 << ", valid=" << std::boolalpha << valid << std::endl;
-    }
-#endif
-
-#if 1
-    {
-        t1 = time();
-        auto start = xml_data.begin();
-        parse::parser_ast<xml::grammar::document, data_type::iterator>::type ast;
-        bool valid = xml::grammar::document::parse_from(start, xml_data.end(), ast);
-        t2 = time();
-        std::cout << "parse-only with AST time: " << double(t2 - t1)/10000 << ", valid=" << std::boolalpha << valid << std::endl;
-        auto l = parse::tree::last_match(ast);
-        std::cout << "last match: " << (int)xml_data.begin()._Ptr << ", " << (int)l._Ptr << std::endl;
-
-        auto& root = ast[_0][_3].matches[23][_0].get()[_3].matches[165][_0].get()[_1].matches[0][_1][_1];
-        std::cout << "root element: " << xml::get_string(root) << std::endl;
-
-        auto& tmp = ast[_0][_1];
-    }
-#endif
-
-    /* XML Tree Test */
-    /*
-    // Some typedefs for convenience
-    typedef xml::document<decltype(xml_data)> document;
-    typedef document::element_type element;
-    typedef element::attribute_type attribute;
-
-    try
-    {
-        auto start = GetTimeMs64();
-        document doc(xml_data);
-        auto end = GetTimeMs64();
-
-        std::cout << "Parse time: " << (end - start) << std::endl;
-
-        typedef unicode::unicode_container<decltype(xml_data)>::iterator iterator_t;
-
-        std::cout << "document AST (string iterator) size: " << sizeof(parse::ast_type<xml::parser::element, std::string::iterator>::type) << std::endl;
-        std::cout << "document AST (unicode_iterator) size: " << sizeof(parse::ast_type<xml::parser::document, iterator_t>::type) << std::endl;
-        std::cout << "document parser size: " << sizeof(xml::parser::document) << std::endl;
-        std::cout << "element AST size: " << sizeof(parse::ast_type<xml::parser::element, iterator_t>::type) << std::endl;
-        std::cout << "unicode iterator size: " << sizeof(iterator_t) << std::endl;
-        std::cout << "string iterator size: " << sizeof(std::string::iterator) << std::endl;
-
-        auto root = doc.root();
-
-        auto name = root.name();
-        auto localname = root.local_name();
-        auto prefix = root.prefix();
-
-        auto& attributes = root.attributes;
-    
-        std::for_each(attributes.begin(), attributes.end(), [](attribute& a)
-        {
-            std::cout << "root attribute: " << a.name() << "=" << a.value() << std::endl;
-        });
-
-        auto attribute1 = root.attributes["attribute1"];
-
-        std::for_each(root.elements.begin(), root.elements.end(), [](element& e)
-        {
-            std::cout << "child element: " << e.name() << std::endl;
-        });
-
-        auto text = root.text();
-
-        auto child = *std::find_if(root.elements.begin(), root.elements.end(), [](element& e)
-        {
-            return e.local_name() == "child1";
-        });
-
-        auto gchild = *std::find_if(child.elements.begin(), child.elements.end(), [](element& e)
-        {
-            return e.name() == "grandchild11";
-        });
-
-        auto gchild_text = gchild.text();
-        auto gchild_name = gchild.name();
-
-        auto hasAttribs = gchild.attributes.begin() != gchild.attributes.end();
-    }
-    catch (xml::parse_exception& e)
-    {
-        std::cout << e.what() << std::endl;
-    }
-    */
-
-    return 0;
-}
+// test.cpp : Defines the entry point for the console application.
+//
+
+#include "stdafx.h"
+
+// The extensive use of templates causes this "decorated name length too 
+// long" warning all over the place.  Since we aren't exporting any of these 
+// template instanciations in a library, it is safe to ignore.
+#pragma warning( disable : 4503 )
+
+#include <assert.h>
+#include <string>
+#include <deque>
+#include <fstream>
+#include <sstream>
+#include <iostream>
+#include <algorithm>
+#include <iterator>
+#include <thread>
+#include <mutex>
+#include <memory>
+
+#include "stream_container.h"
+#include "parse\parse.h"
+#include "unicode\transcode.h"
+#include "tree.h"
+#include "reader.h"
+#include "sax.h"
+#include "document_stream.h"
+#include "xpath.h"
+#include "projection.h"
+#include "writer.h"
+#include "snapshot.h"
+#include "document_cache.h"
+#include "diff.h"
+
+// This demonstrates using a custom AST type to have more type-safe access to 
+// elements.  Instead of using the operator[] overloads directly, these AST 
+// classes add named accessor methods to retrieve the various parts of the 
+// underlying AST.  Note that the get accessor's themselves are using the
+// "unsafe" operator[]'s, but once they are written, any code that uses those
+// AST types can use the custom methods, which won't compile if the grammar is
+// modified.  The operator[]'s on the other hand, will generally just silently
+// start grabbing the wrong part of the AST.
+// A downside to this method is that we seem to get some strange errors in 
+// xlocnum.h, associated with bringing the parse::operators namespace in to 
+// scope alongside the accessors.
+#if 0
+namespace custom_ast_test
+{
+    using namespace parse::terminals;
+    using namespace parse::operators;
+
+    static u<'1'> uone;
+    static u<'2'> utwo;
+    static u<'3'> uthree;
+
+    typedef decltype(uone >> utwo >> uthree) base_t;
+
+    struct parser_t : public base_t
+    {
+        template <typename iterator_t>
+        struct ast : public parse::ast_type<base_t, iterator_t>::type
+        {
+            typedef ast type;
+            
+            typename parse::ast_type<decltype(uone), iterator_t>::type& get_one()
+            {
+                return (*this)[util::_0];
+            }
+
+            typename parse::ast_type<decltype(utwo), iterator_t>::type& get_two()
+            {
+                return (*this)[util::_1];
+            }
+
+            typename parse::ast_type<decltype(uthree), iterator_t>::type& get_three()
+            {
+                return (*this)[util::_2];
+            }
+        };
+    };
+
+    typedef decltype(utwo >> uthree >> parser_t()) base2_t;
+
+    struct parser2_t : public base2_t
+    {
+        template <typename iterator_t>
+        struct ast : public base2_t::ast<iterator_t>::type
+        {
+            typedef ast type;
+            
+            typename parse::ast_type<parser_t, iterator_t>::type& get_one()
+            {
+                return (*this)[util::_2];
+            }
+
+            typename parse::ast_type<decltype(utwo), iterator_t>::type& get_two()
+            {
+                return (*this)[util::_0];
+            }
+
+            typename parse::ast_type<decltype(uthree), iterator_t>::type& get_three()
+            {
+                return (*this)[util::_1];
+            }
+        };
+    };
+
+    void foo()
+    {
+        parser2_t p;
+        std::string data("23123");
+        parse::ast_type<parser2_t, std::string::iterator>::type ast;
+        p.parse(data, ast);
+
+        auto& c1 = ast.get_one();
+        auto& c2 = ast.get_two();
+        auto& c3 = ast.get_three();
+
+        auto& c1c1 = c1.get_one();
+        auto& c1c2 = c1.get_two();
+        auto& c1c3 = c1.get_three();
+    }
+}
+#endif
+
+#if 1
+namespace ast_tag_test
+{
+    using namespace parse;
+    using namespace parse::operators;
+    using namespace parse::terminals;
+
+    auto one = u<'1'>();
+    auto num = +digit();
+    auto lparen = u<'('>();
+    auto rparen = u<')'>();
+    auto ws = +space();
+
+    struct s_expr;
+
+    typedef decltype(num[_0] | reference<s_expr>()[_1]) elem_t;
+
+    typedef decltype(lparen >> *space() >> elem_t()[_0] >> (*(+space() >> elem_t()))[_1] >> *space() >> rparen) s_expr_t;
+
+    struct s_expr : s_expr_t {};
+
+    typedef decltype(num[_0] >> ws >> s_expr()[_1]) parser;
+
+    void test()
+    {
+        typedef std::string::iterator it_t;
+        std::string data("((1) 2 3 (2 33 345) ((((1234)))))");
+        typedef parse::parser_ast<parser, std::string::iterator>::type ast_t;
+        ast_t ast;
+        typedef parser p_type;
+
+        bool valid = parser::parse_from(data.begin(), data.end(), ast);
+    }
+}
+#endif
+
+#if 1
+namespace line_index_test
+{
+    // Returns the message of the exception thrown by parsing a document.
+    template <typename container_t>
+    std::string error(container_t& data)
+    {
+        try
+        {
+            xml::tree::document doc(data);
+        }
+        catch (const xml::parse_exception& e)
+        {
+            return e.what();
+        }
+        return std::string();
+    }
+
+    template <typename container_t>
+    void check_lines(container_t& c)
+    {
+        typedef typename container_t::iterator iterator_t;
+
+        // The newline itself is the end of its line.
+        unicode::line_index<iterator_t> lines(c.begin(), c.end(), '\n', 1, 0);
+        assert(lines.line(0) == 1 && lines.line(1) == 1);
+        assert(lines.line(2) == 2 && lines.line(4) == 2);
+        assert(lines.line(5) == 3 && lines.line(6) == 4);
+        assert(lines.line_start(4) - c.begin() == 6);
+    }
+
+    void test()
+    {
+        // Contiguous bytes are searched with SIMD, and other containers one 
+        // unit at a time.
+        std::string bytes("a\nbc\n\nd");
+        std::deque<char> units(bytes.begin(), bytes.end());
+        check_lines(bytes);
+        check_lines(units);
+
+        // In UTF-16LE, only a '\n' in the low byte of a character is a 
+        // newline (not the high byte of U+0A00).
+        const char utf16[] = { 'a', 0, 0, '\n', '\n', 0, 'b', 0 };
+        std::string wide(utf16, sizeof(utf16));
+        unicode::line_index<std::string::iterator> lines(wide.begin(), wide.end(), '\n', 2, 0);
+        assert(lines.line(2) == 1 && lines.line(4) == 1 && lines.line(6) == 2);
+
+        // Errors report the line and column of the first unexpected 
+        // character, in characters rather than bytes.
+        std::string data("<r>\n  <a>\xC3\xA9<</a>\n</r>");
+        assert(error(data).find("line 2, column 7: ") == 0);
+
+        // The same document in UTF-16LE (with a BOM).
+        std::string latin1("<r>\n  <a>\xE9<</a>\n</r>");
+        std::string wdata("\xFF\xFE");
+        for (auto c : latin1)
+        {
+            wdata.push_back(c);
+            wdata.push_back(0);
+        }
+        assert(error(wdata).find("line 2, column 7: ") == 0);
+    }
+}
+#endif
+
+#if 1
+namespace validate_test
+{
+    // Checks that the validators agree on the offset of the first invalid 
+    // sequence in some data.
+    size_t check(const std::string& data)
+    {
+        size_t size = data.size();
+        size_t expected = unicode::validate::scalar(reinterpret_cast<const unsigned char*>(data.data()), 0, size);
+        assert(unicode::validate_utf8(data.data(), size) == expected);
+#if defined(UNICODE_VALIDATE_SSSE3)
+        if (unicode::validate::has_ssse3()) assert(unicode::validate::ssse3(data.data(), size) == expected);
+#endif
+        return expected;
+    }
+
+    void test()
+    {
+        struct { const char* bytes; size_t invalid; } cases[] =
+        {
+            { "a\xC3\xA9\xE2\x82\xAC\xF0\x9F\x98\x80", 10 },
+            { "a\xC0\x80", 1 },          // overlong
+            { "a\xE0\x80\x80", 1 },      // overlong
+            { "a\xED\xA0\x80", 1 },      // surrogate
+            { "a\xF4\x90\x80\x80", 1 },  // above U+10FFFF
+            { "a\xF5\x80\x80\x80", 1 },
+            { "a\x80", 1 },              // unexpected continuation byte
+            { "a\xC3\xA9\xE2\x82", 3 },  // cut off by the end
+            { "a\xE2\x82" "a", 1 },
+        };
+
+        // Each case is checked at every position within and across the 
+        // 16-byte blocks of the SSSE3 validator (including in the tail).
+        for (auto& c : cases)
+        {
+            for (size_t prefix = 0; prefix < 40; prefix++)
+            {
+                std::string data = std::string(prefix, 'x') + c.bytes;
+                assert(check(data) == prefix + c.invalid);
+                assert(check(data + std::string(40, 'y')) == (c.invalid == 10 ? data.size() + 40 : prefix + c.invalid));
+            }
+        }
+
+        // Random mixes of ASCII and valid sequences, with the occasional 
+        // piece that makes them invalid.
+        const char* pieces[] = { "a", "\xC3\xA9", "\xE2\x82\xAC", "\xF0\x9F\x98\x80", "\x80", "\xC2", "\xED\xA0", "\xF4\x90" };
+        unsigned int seed = 1;
+        for (int i = 0; i < 2000; i++)
+        {
+            std::string data;
+            size_t length = (seed = seed * 1103515245 + 12345) >> 16 & 63;
+            for (size_t k = 0; k < length; k++)
+            {
+                seed = seed * 1103515245 + 12345;
+                size_t piece = (seed >> 16) % 32;
+                data += pieces[piece < 28 ? piece % 4 : piece - 24];
+            }
+            check(data);
+        }
+
+        // Documents are validated when they're loaded, and the offset 
+        // includes the BOM.
+        std::string document("\xEF\xBB\xBF<r>\xC0\x80</r>");
+        try
+        {
+            xml::tree::document doc(document);
+            assert(false);
+        }
+        catch (const unicode::invalid_utf8_sequence& e)
+        {
+            assert(e.offset() == 6);
+        }
+    }
+}
+#endif
+
+#if 1
+namespace transcode_test
+{
+    // Encodes code points as UTF-16 or UTF-32 (given the size of a unit), 
+    // in either byte order.
+    std::string encode(const std::vector<utf8::uint32_t>& code_points, size_t size, bool little_endian)
+    {
+        std::string result;
+        for (auto cp : code_points)
+        {
+            std::vector<utf8::uint32_t> units;
+            if (size == 2 && cp > 0xFFFF)
+            {
+                units.push_back(0xD800 + ((cp - 0x10000) >> 10));
+                units.push_back(0xDC00 + ((cp - 0x10000) & 0x3FF));
+            }
+            else
+                units.push_back(cp);
+
+            for (auto unit : units)
+            {
+                for (size_t i = 0; i < size; i++) result.push_back(static_cast<char>(unit >> (8 * (little_endian ? i : size - 1 - i))));
+            }
+        }
+        return result;
+    }
+
+    std::string to_utf8(const std::string& data, unicode::encoding enc)
+    {
+        std::string output;
+        unicode::transcode::to_utf8(data.data(), data.size(), enc, output);
+        return output;
+    }
+
+    // Returns the offset reported for invalid data.
+    size_t invalid_offset(const std::string& data, unicode::encoding enc)
+    {
+        try
+        {
+            to_utf8(data, enc);
+        }
+        catch (const unicode::invalid_encoding& e)
+        {
+            return e.offset();
+        }
+        return -1;
+    }
+
+    void test()
+    {
+        // Runs of ASCII are converted in blocks, and the rest one character 
+        // at a time, so the characters are moved across the blocks (e.g., 
+        // so that a surrogate pair straddles two of them).
+        for (size_t prefix = 0; prefix < 16; prefix++)
+        {
+            std::vector<utf8::uint32_t> code_points(prefix, 'x');
+            utf8::uint32_t rest[] = { 0x1F600, 'a', 'b', 'c', 'd', 'e', 'f', 'g', 'h', 'i', 'j', 'k', 'l', 'm', 'n', 'o', 'p', 
+                0xE9, 0x20AC, 0x10FFFF, 0x1F600, 'z' };
+            code_points.insert(code_points.end(), rest, rest + sizeof(rest) / sizeof(rest[0]));
+
+            std::string expected;
+            for (auto cp : code_points) utf8::append(cp, std::back_inserter(expected));
+
+            assert(to_utf8(encode(code_points, 2, true), unicode::utf16le) == expected);
+            assert(to_utf8(encode(code_points, 2, false), unicode::utf16be) == expected);
+            assert(to_utf8(encode(code_points, 4, true), unicode::utf32le) == expected);
+            assert(to_utf8(encode(code_points, 4, false), unicode::utf32be) == expected);
+
+            std::string latin1(prefix, 'x');
+            latin1 += "\xE9" "abcdefghijklmnopq\xFF";
+            assert(to_utf8(latin1, unicode::latin1) == std::string(prefix, 'x') + "\xC3\xA9" "abcdefghijklmnopq\xC3\xBF");
+        }
+
+        // Unpaired surrogates and invalid code points are reported by their 
+        // offsets in the data.
+        std::vector<utf8::uint32_t> code_points(16, 'x');
+        code_points[9] = 0xDC00;
+        assert(invalid_offset(encode(code_points, 2, true), unicode::utf16le) == 18);
+        code_points[9] = 0xD800;
+        assert(invalid_offset(encode(code_points, 2, false), unicode::utf16be) == 18);
+        code_points[9] = 'x';
+        code_points[15] = 0xD800;
+        assert(invalid_offset(encode(code_points, 2, true), unicode::utf16le) == 30);
+        assert(invalid_offset(encode(code_points, 2, true) + "x", unicode::utf16le) == 32);
+        code_points[15] = 0x110000;
+        assert(invalid_offset(encode(code_points, 4, true), unicode::utf32le) == 60);
+        code_points[15] = 'x';
+        code_points[5] = 0xDFFF;
+        assert(invalid_offset(encode(code_points, 4, false), unicode::utf32be) == 20);
+
+        // utf8_container converts the data after the BOM, either all at 
+        // once, or one character at a time for containers that aren't 
+        // contiguous, and reports errors from the start of the container.
+        std::string document("<r a='\xC3\xA9'>\xF0\x9F\x98\x80 text</r>");
+        std::vector<utf8::uint32_t> document_code_points;
+        for (auto it = document.begin(); it != document.end(); ) document_code_points.push_back(utf8::next(it, document.end()));
+
+        std::string utf16("\xFF\xFE");
+        utf16 += encode(document_code_points, 2, true);
+        unicode::utf8_container<std::string> converted(utf16);
+        assert(converted.str() == document);
+
+        std::deque<char> units(utf16.begin(), utf16.end());
+        unicode::utf8_container<std::deque<char>> generic(units);
+        assert(generic.str() == document);
+
+        xml::tree::document doc(converted);
+        assert(doc.root().attribute("a") == "\xC3\xA9" && doc.root().text() == "\xF0\x9F\x98\x80 text");
+
+        utf16 += encode(std::vector<utf8::uint32_t>(1, 0xDC00), 2, true);
+        try
+        {
+            unicode::utf8_container<std::string> invalid(utf16);
+            assert(false);
+        }
+        catch (const unicode::invalid_encoding& e)
+        {
+            assert(e.offset() == utf16.size() - 2);
+        }
+    }
+}
+#endif
+
+#if 1
+namespace latin1_test
+{
+    void test()
+    {
+        // Each byte of a document declared as ISO-8859-1 is a character, 
+        // and the names of the encoding are case-insensitive.
+        std::string data("<?xml version='1.0' encoding='ISO-8859-1'?><r a='\xE9'>\xFF</r>");
+        xml::tree::document doc(data);
+        assert(doc.root().attribute("a") == "\xC3\xA9" && doc.root().text() == "\xC3\xBF");
+
+        std::string alias("<?xml version=\"1.0\" encoding=\"Latin1\"?><r>\xE9</r>");
+        xml::tree::document aliased(alias);
+        assert(aliased.root().text() == "\xC3\xA9");
+
+        // Without the declaration, the same bytes aren't valid UTF-8.
+        std::string undeclared("<r>\xE9</r>");
+        try
+        {
+            xml::tree::document invalid(undeclared);
+            assert(false);
+        }
+        catch (const unicode::invalid_utf8_sequence&)
+        {
+        }
+
+        // A utf8_container has already decoded an ISO-8859-1 document to 
+        // UTF-8, so the parser must not decode it again because of its 
+        // declaration.
+        unicode::utf8_container<std::string> utf8(data);
+        xml::tree::document converted(utf8);
+        assert(converted.root().attribute("a") == "\xC3\xA9" && converted.root().text() == "\xC3\xBF");
+    }
+}
+#endif
+
+#if 1
+namespace match_string_test
+{
+    // Returns the match of characters [first, last) of a container.
+    template <typename container_t>
+    xml::match_string<typename container_t::iterator> match(container_t& c, size_t first, size_t last)
+    {
+        auto start = c.begin();
+        std::advance(start, first);
+        auto end = start;
+        std::advance(end, last - first);
+        return xml::match_string<typename container_t::iterator>(start, end);
+    }
+
+    template <typename match_t>
+    void check(const match_t& m, const std::string& expected)
+    {
+        assert(m == expected && m == expected.c_str() && m == util::string_view(expected));
+        assert(m != expected + "x");
+        assert(m.str() == expected && std::string(m) == expected);
+        assert(m.hash() == util::string_view(expected).hash());
+    }
+
+    void test()
+    {
+        // UTF-8 matches are spans of the source.
+        std::string utf8_data("<r>caf\xC3\xA9</r>");
+        unicode::unicode_container<std::string> utf8(utf8_data);
+        auto word = match(utf8, 3, 7);
+        assert(word.has_bytes() && word.bytes().data() == utf8_data.data() + 3);
+        check(word, "caf\xC3\xA9");
+
+        // ISO-8859-1 matches are only spans of the source when they're all 
+        // ASCII, and are converted otherwise.
+        std::string latin1_data("<?xml version='1.0' encoding='latin1'?><r>caf\xE9</r>");
+        unicode::unicode_container<std::string> latin1(latin1_data);
+        auto ascii = match(latin1, 42, 45);
+        assert(ascii.has_bytes());
+        check(ascii, "caf");
+        auto accented = match(latin1, 42, 46);
+        assert(!accented.has_bytes());
+        check(accented, "caf\xC3\xA9");
+
+        // UTF-16 matches are always converted.
+        const char bytes[] = "\xFF\xFE" "c\0a\0f\0\xE9\0";
+        std::string utf16_data(bytes, sizeof(bytes) - 1);
+        unicode::unicode_container<std::string> utf16(utf16_data);
+        auto wide = match(utf16, 0, 4);
+        assert(!wide.has_bytes());
+        check(wide, "caf\xC3\xA9");
+
+        // Matches compare equal regardless of how they're stored.
+        assert(word == accented && accented == word && accented == wide);
+        assert(word != ascii && ascii != wide);
+        assert(std::hash<decltype(word)>()(word) == util::string_view("caf\xC3\xA9").hash());
+
+        // Empty matches
+        auto empty = match(utf8, 3, 3);
+        check(empty, "");
+        assert(xml::match_string<unicode::unicode_container<std::string>::iterator>() == "");
+    }
+}
+#endif
+
+#if 1
+namespace name_table_test
+{
+    void test()
+    {
+        // IDs are assigned in order, and the views of the names stay valid 
+        // as the table grows.
+        xml::name_table table;
+        xml::name_id a = table.intern("a");
+        util::string_view a_name = table.name(a);
+        assert(a == 0 && table.intern("b") == 1 && table.intern(std::string("a")) == a);
+        for (int i = 0; i < 1000; i++) table.intern(std::to_string(i));
+        assert(table.size() == 1002 && a_name.data() == table.name(a).data() && a_name == "a");
+
+        // Lookups don't add names.
+        assert(table.find("b") == 1 && table.find("c") == xml::no_name && table.size() == 1002);
+
+        // Documents that share a table have the same IDs for the same 
+        // names, and looking up a name that isn't in it doesn't add it.
+        auto names = std::make_shared<xml::name_table>();
+        std::string first("<r><item id='1'/></r>"), second("<item id='2'><r/></item>");
+        xml::tree::document one(first, names), two(second, names);
+        assert(names->size() == 3);
+        assert(one.root().id() == two.root().child("r").id());
+        assert(one.root().child("item").id() == two.root().id());
+        assert(!one.root().child("missing") && one.root().attribute("missing").empty() && names->size() == 3);
+
+        // A thread-safe table gives each name one ID, whichever thread 
+        // adds it first.
+        xml::name_table locked(true);
+        std::vector<xml::name_id> ids[4];
+        std::vector<std::thread> threads;
+        for (int t = 0; t < 4; t++)
+        {
+            threads.push_back(std::thread([&locked, &ids, t]() {
+                for (int i = 0; i < 500; i++) ids[t].push_back(locked.intern(std::to_string((i * (t + 1)) % 500)));
+            }));
+        }
+        for (auto& thread : threads) thread.join();
+
+        assert(locked.size() == 500);
+        for (int t = 0; t < 4; t++)
+        {
+            for (int i = 0; i < 500; i++) assert(locked.name(ids[t][i]) == std::to_string((i * (t + 1)) % 500));
+        }
+    }
+}
+#endif
+
+#if 1
+namespace reader_test
+{
+    // Writes the elements, attributes and text of a document, read with the 
+    // reader or loaded as a tree, in the same form, to compare them.
+    template <typename iterator_t>
+    void write(xml::reader::element<iterator_t> e, std::string& out)
+    {
+        out += "<" + e.name().str();
+        for (auto a = e.next_attribute(); !a.is_end(); a = a.next_attribute()) out += " " + a.name().str() + "='" + a.value().str() + "'";
+        out += ">";
+
+        for (auto n = e.next_child(); !n.is_end(); n = n.next_sibling())
+        {
+            if (n.is_text())
+                out += n.text().str();
+            else
+                write(n.element(), out);
+        }
+        out += "</" + e.name().str() + ">";
+    }
+
+    void write(xml::tree::element e, std::string& out)
+    {
+        out += "<" + e.name().str();
+        for (auto a : e.attributes()) out += " " + a.name().str() + "='" + a.value().str() + "'";
+        out += ">";
+
+        for (auto n : e.nodes())
+        {
+            if (n.is_text())
+                out += n.text().str();
+            else
+                write(n.element(), out);
+        }
+        out += "</" + e.name().str() + ">";
+    }
+
+    void test(std::string& data)
+    {
+        std::string expected, read;
+        xml::tree::document tree(data);
+        write(tree.root(), expected);
+        xml::reader::document<std::string> doc(data);
+        write(doc.root(), read);
+        assert(read == expected);
+
+        // Each element visited gets one entry in the position table, and 
+        // reading the document again uses the positions recorded the first 
+        // time, with the same result as reading without a table.
+        typedef unicode::unicode_container<std::string>::iterator iterator_t;
+        std::string small("<r a='1'><b><c/>text<c></c></b><!-- c --><d x='y'/>tail</r>");
+        unicode::unicode_container<std::string> units(small);
+        xml::reader::position_table<iterator_t> table(units.begin());
+        xml::reader::element<iterator_t> root(units.begin(), units.end(), &table);
+
+        std::string first, second, plain;
+        write(root, first);
+        size_t entries = table.size();
+        write(root, second);
+        write(xml::reader::element<iterator_t>(units.begin(), units.end()), plain);
+        assert(entries == 5 && table.size() == entries);
+        assert(first == "<r a='1'><b><c></c>text<c></c></b><d x='y'></d>tail</r>" && second == first && plain == first);
+    }
+}
+#endif
+
+#if 1
+namespace skip_test
+{
+    // Lists the children of an element (the names of elements, and text), 
+    // moving past each element with skip() or next_sibling().
+    template <typename iterator_t>
+    std::string children(xml::reader::element<iterator_t> e, bool skip)
+    {
+        std::string out;
+        for (auto n = e.next_child(); !n.is_end(); n = skip ? n.skip() : n.next_sibling())
+        {
+            out += n.is_text() ? n.text().str() : "<" + n.element().name().str() + ">";
+        }
+        return out;
+    }
+
+    template <typename container_t>
+    void check(container_t& data)
+    {
+        xml::reader::document<container_t> skipped(data), parsed(data);
+        assert(children(skipped.root(), true) == "<a><b>text<c>");
+        assert(children(parsed.root(), false) == "<a><b>text<c>");
+
+        // The children of a skipped element can still be read.
+        auto a = skipped.root().next_child().element();
+        assert(children(a, false) == "<a>");
+        assert(a.skip().element().name() == "b");
+    }
+
+    void test()
+    {
+        // The close tags in attribute values and comments, and nested 
+        // elements with the same name, don't end the skipped element.
+        std::string data("<r><a x='>' y=\"/></a>\"><!-- </a> --><a><a/></a></a><b/>text<c>z</c></r>");
+        check(data);
+
+        // Other containers are scanned one character at a time.
+        std::deque<char> units(data.begin(), data.end());
+        check(units);
+
+        std::string utf16("\xFF\xFE");
+        for (auto c : data)
+        {
+            utf16.push_back(c);
+            utf16.push_back(0);
+        }
+        check(utf16);
+
+        // The skipped data isn't checked.
+        std::string invalid("<r><bad a=1 b>text</bad><ok/></r>");
+        xml::reader::document<std::string> doc(invalid);
+        assert(doc.root().next_child().skip().element().name() == "ok");
+    }
+}
+#endif
+
+#if 1
+namespace cursor_test
+{
+    typedef xml::reader::cursor<std::string> cursor;
+
+    // Lists the nodes read by a cursor, with their depths.
+    std::string nodes(cursor& c)
+    {
+        static const char* kinds[] = { "start", "element", "attribute", "text", "end_element", "end" };
+
+        std::ostringstream out;
+        while (c.read()) out << kinds[c.get_kind()] << " " << c.name() << " " << c.value() << " " << c.depth() << "\n";
+        assert(c.get_kind() == cursor::end_node && !c.read());
+        return out.str();
+    }
+
+    // Writes the nodes read by a cursor in the same form as 
+    // reader_test::write().
+    std::string write(cursor& c)
+    {
+        std::string out;
+        bool in_tag = false;
+        while (c.read())
+        {
+            if (c.get_kind() == cursor::attribute_node)
+            {
+                out += " " + c.name().str() + "='" + c.value().str() + "'";
+                continue;
+            }
+
+            if (in_tag) out += ">";
+            in_tag = false;
+
+            switch (c.get_kind())
+            {
+            case cursor::element_node: out += "<" + c.name().str(); in_tag = true; break;
+            case cursor::text_node: out += c.value().str(); break;
+            default: out += "</" + c.name().str() + ">"; break;
+            }
+        }
+        return out;
+    }
+
+    void test(std::string& data)
+    {
+        std::string small("<?xml version='1.0'?><r a='1'>t<!-- c --><e/><f b=\"2\">u</f></r>");
+        cursor c(small);
+        assert(c.get_kind() == cursor::start_node);
+        assert(nodes(c) ==
+            "element r  0\n"
+            "attribute a 1 1\n"
+            "text  t 1\n"
+            "element e  1\n"
+            "end_element e  1\n"
+            "element f  1\n"
+            "attribute b 2 2\n"
+            "text  u 2\n"
+            "end_element f  1\n"
+            "end_element r  0\n");
+
+        // skip() moves to the end of the element whose start tag or 
+        // attribute the cursor is on, or else of the element that contains 
+        // the current node.
+        cursor skipping(small);
+        skipping.read();
+        skipping.read();
+        skipping.skip();
+        assert(skipping.get_kind() == cursor::end_element_node && skipping.name() == "r" && skipping.depth() == 0 && !skipping.read());
+
+        cursor inner(small);
+        while (inner.read() && inner.name() != "f");
+        inner.skip();
+        assert(inner.get_kind() == cursor::end_element_node && inner.name() == "f" && inner.depth() == 1);
+        inner.read();
+        assert(inner.get_kind() == cursor::end_element_node && inner.name() == "r");
+
+        cursor text(small);
+        while (text.read() && text.get_kind() != cursor::text_node);
+        text.skip();
+        assert(text.get_kind() == cursor::end_element_node && text.name() == "r");
+
+        // A whole document reads the same as with the reader.
+        std::string expected;
+        xml::tree::document tree(data);
+        reader_test::write(tree.root(), expected);
+        cursor all(data);
+        assert(write(all) == expected);
+    }
+}
+#endif
+
+#if 1
+namespace event_range_test
+{
+    size_t count_elements(xml::tree::element e)
+    {
+        size_t count = 1;
+        for (auto child : e.elements()) count += count_elements(child);
+        return count;
+    }
+
+    void test(std::string& data)
+    {
+        // The events are the nodes that a cursor reads.
+        std::string small("<r a='1'>t<e/><f b='2'>u<g/></f>v</r>");
+        std::ostringstream out;
+        for (auto e : xml::reader::events(small)) out << (int)e.kind << " " << e.name << " " << e.value << " " << e.depth << "\n";
+
+        std::ostringstream from_cursor;
+        cursor_test::cursor again(small);
+        while (again.read()) from_cursor << (int)again.get_kind() << " " << again.name() << " " << again.value() << " " << again.depth() << "\n";
+        assert(out.str() == from_cursor.str());
+
+        // The cursor can skip an element in the middle of the loop, and 
+        // the loop can stop early.
+        std::string names;
+        auto range = xml::reader::events(small);
+        for (auto it = range.begin(); it != range.end(); ++it)
+        {
+            auto e = *it;
+            if (e.kind == cursor_test::cursor::element_node) names += e.name.str();
+            if (e.kind == cursor_test::cursor::element_node && e.name == "f") range.get_cursor().skip();
+            if (e.kind == cursor_test::cursor::text_node && e.value == "v") break;
+        }
+        assert(names == "ref");
+
+        // Counting the events of a whole document.
+        size_t elements = 0, ends = 0;
+        for (auto e : xml::reader::events(data))
+        {
+            if (e.kind == cursor_test::cursor::element_node) elements++;
+            if (e.kind == cursor_test::cursor::end_element_node) ends++;
+        }
+        xml::tree::document tree(data);
+        assert(elements == ends && elements == count_elements(tree.root()));
+    }
+}
+#endif
+
+#if 1
+namespace sax_test
+{
+    // Writes the events in the same form as reader_test::write(), so the 
+    // output can be compared with the tree's.
+    struct writer : public xml::sax::handler
+    {
+        std::string out;
+        bool tag_open;
+
+        writer() : tag_open(false) {}
+
+        void close() { if (tag_open) out += ">"; tag_open = false; }
+
+        template <typename string_t>
+        void start_element(const string_t& name) { close(); out += "<" + name.str(); tag_open = true; }
+
+        template <typename string_t>
+        void attribute(const string_t& name, const string_t& value) { out += " " + name.str() + "='" + value.str() + "'"; }
+
+        template <typename string_t>
+        void text(const string_t& value) { close(); out += value.str(); }
+
+        template <typename string_t>
+        void end_element(const string_t& name) { close(); out += "</" + name.str() + ">"; }
+    };
+
+    // Records the events of each batch as one line per event, and the size 
+    // of each batch.
+    struct consumer
+    {
+        std::ostringstream out;
+        std::vector<size_t> sizes;
+
+        template <typename event_t>
+        void operator() (const event_t* events, size_t count)
+        {
+            sizes.push_back(count);
+            for (size_t i = 0; i < count; i++) out << (int)events[i].kind << " " << events[i].name << " " << events[i].value << "\n";
+        }
+    };
+
+    struct recorder : public xml::sax::handler
+    {
+        std::ostringstream out;
+        size_t count;
+
+        recorder() : count(0) {}
+
+        template <typename string_t>
+        void start_element(const string_t& name) { count++; out << (int)xml::sax::start_element_event << " " << name << " \n"; }
+
+        template <typename string_t>
+        void attribute(const string_t& name, const string_t& value) { count++; out << (int)xml::sax::attribute_event << " " << name << " " << value << "\n"; }
+
+        template <typename string_t>
+        void text(const string_t& value) { count++; out << (int)xml::sax::text_event << "  " << value << "\n"; }
+
+        template <typename string_t>
+        void comment(const string_t& value) { count++; out << (int)xml::sax::comment_event << "  " << value << "\n"; }
+
+        template <typename string_t>
+        void end_element(const string_t& name) { count++; out << (int)xml::sax::end_element_event << " " << name << " \n"; }
+    };
+
+    template <size_t batch_size>
+    void check_batches(std::string& data, const std::string& expected, size_t events)
+    {
+        consumer c;
+        xml::sax::parse_batched<batch_size>(data, c);
+        assert(c.out.str() == expected);
+
+        // Every batch but the last one is full.
+        size_t total = 0;
+        for (size_t i = 0; i < c.sizes.size(); i++)
+        {
+            assert(c.sizes[i] > 0 && c.sizes[i] <= batch_size);
+            assert(i + 1 == c.sizes.size() || c.sizes[i] == batch_size);
+            total += c.sizes[i];
+        }
+        assert(total == events);
+    }
+
+    void test(std::string& data)
+    {
+        // Empty-element tags are reported like close tags, and comments in 
+        // the prolog aren't reported.
+        std::string small("<?xml version='1.0'?><!-- p --><r a='1' b=\"2\">t<e/><!--c-->u</r>");
+        recorder events;
+        xml::sax::parse(small, events);
+        assert(events.out.str() == 
+            "0 r \n1 a 1\n1 b 2\n2  t\n0 e \n4 e \n3  c\n2  u\n4 r \n");
+
+        // The events build the same document as the tree.
+        writer w;
+        xml::sax::parse(data, w);
+        xml::tree::document tree(data);
+        std::string expected;
+        reader_test::write(tree.root(), expected);
+        assert(w.out == expected);
+
+        bool failed = false;
+        try
+        {
+            std::string bad("<r><e></r>");
+            xml::sax::handler h;
+            xml::sax::parse(bad, h);
+        }
+        catch (xml::parse_exception&)
+        {
+            failed = true;
+        }
+        assert(failed);
+
+        // The batched events are the same as the handler's, whatever the 
+        // batch size (including a size that divides the number of events 
+        // evenly, so the last batch is full).
+        recorder all;
+        xml::sax::parse(data, all);
+        check_batches<1>(data, all.out.str(), all.count);
+        check_batches<7>(data, all.out.str(), all.count);
+        check_batches<4096>(data, all.out.str(), all.count);
+
+        std::string nine("<r a='1' b=\"2\">t<e/><!--c-->u</r>");
+        recorder nine_events;
+        xml::sax::parse(nine, nine_events);
+        assert(nine_events.count == 9);
+        check_batches<3>(nine, nine_events.out.str(), 9);
+    }
+}
+#endif
+
+#if 1
+namespace document_stream_test
+{
+    std::vector<std::string> split(const std::string& data, size_t chunk)
+    {
+        std::stringbuf buf(data);
+        xml::document_stream stream(buf, chunk);
+        std::vector<std::string> documents;
+        std::string document;
+        while (stream.next(document)) documents.push_back(document);
+        return documents;
+    }
+
+    bool fails(const std::string& data)
+    {
+        try
+        {
+            split(data, 4);
+        }
+        catch (std::exception&)
+        {
+            return true;
+        }
+        return false;
+    }
+
+    void test(std::string& data)
+    {
+        // A document starts after the end of the previous one, unless it 
+        // has a BOM or an XML declaration, which may follow whitespace.
+        std::string concatenated(
+            "<a x='1'/>\n<?xml version='1.0'?><b>t</b> <!-- c --><c><d/></c>\n"
+            "\xEF\xBB\xBF<?xml version='1.0'?><e/>\n<!-- end -->\n");
+        size_t chunks[] = { 1, 3, 16, 64 * 1024 };
+        for (size_t chunk : chunks)
+        {
+            std::vector<std::string> documents = split(concatenated, chunk);
+            assert(documents.size() == 4);
+            assert(documents[0] == "<a x='1'/>");
+            assert(documents[1] == "<?xml version='1.0'?><b>t</b>");
+            assert(documents[2] == " <!-- c --><c><d/></c>");
+            assert(documents[3] == "\xEF\xBB\xBF<?xml version='1.0'?><e/>");
+        }
+
+        assert(split("", 16).empty());
+        assert(split(" <!-- c -->\n", 16).empty());
+        assert(fails("<a/>junk<b/>"));
+        assert(fails("<a/><b><c/>"));
+
+        // The parsed documents share their names.
+        std::string repeated;
+        const size_t count = 20;
+        for (size_t i = 0; i < count; i++) repeated += data + "\n";
+
+        std::stringbuf buf(repeated);
+        xml::document_stream stream(buf, 4096);
+        std::string expected;
+        xml::tree::document tree(data);
+        reader_test::write(tree.root(), expected);
+        xml::name_id root = xml::no_name;
+        size_t parsed = 0;
+        while (auto doc = stream.next_document())
+        {
+            std::string written;
+            reader_test::write(doc->root(), written);
+            assert(written == expected);
+            assert(&doc->names() == &stream.names());
+            if (root == xml::no_name) root = doc->root().id();
+            assert(doc->root().id() == root);
+            parsed++;
+        }
+        assert(parsed == count);
+
+        // Parsing on several threads builds the same documents.
+        std::stringbuf parallel_buf(repeated);
+        xml::document_stream parallel(parallel_buf, 4096);
+        std::mutex mutex;
+        size_t elements = 0, matches = 0;
+        xml::parse_parallel(parallel, 4, [&](const std::shared_ptr<xml::tree::document>& doc)
+        {
+            std::string written;
+            reader_test::write(doc->root(), written);
+            size_t n = event_range_test::count_elements(doc->root());
+
+            std::lock_guard<std::mutex> lock(mutex);
+            elements += n;
+            if (written == expected) matches++;
+        });
+        assert(matches == count);
+        assert(elements == count * event_range_test::count_elements(tree.root()));
+
+        // An exception from the function stops the workers, and is 
+        // rethrown.
+        std::stringbuf failing_buf(repeated);
+        xml::document_stream failing(failing_buf, 4096);
+        bool rethrown = false;
+        try
+        {
+            xml::parse_parallel(failing, 2, [&](const std::shared_ptr<xml::tree::document>&)
+            {
+                throw std::runtime_error("stop");
+            });
+        }
+        catch (std::runtime_error&)
+        {
+            rethrown = true;
+        }
+        assert(rethrown);
+    }
+}
+#endif
+
+#if 1
+namespace xpath_test
+{
+    typedef xml::xpath::query query;
+
+    std::string names(const std::vector<xml::tree::element>& elements)
+    {
+        std::string ret;
+        for (auto& e : elements) ret += e.name().str() + e.attribute("k").str() + " ";
+        return ret;
+    }
+
+    std::string values(const std::vector<xml::tree::attribute>& attributes)
+    {
+        std::string ret;
+        for (auto& a : attributes) ret += a.name().str() + "=" + a.value().str() + " ";
+        return ret;
+    }
+
+    bool is_invalid(const char* path, size_t offset)
+    {
+        xml::name_table names;
+        try
+        {
+            query q(path, names);
+        }
+        catch (xml::xpath::syntax_error& e)
+        {
+            return e.offset() == offset;
+        }
+        return false;
+    }
+
+    // Appends the elements in document order, for comparing with the 
+    // queries' results.
+    void all_elements(xml::tree::element e, std::vector<xml::tree::element>& elements)
+    {
+        elements.push_back(e);
+        for (auto child : e.elements()) all_elements(child, elements);
+    }
+
+    bool same(const std::vector<xml::tree::element>& lhs, const std::vector<xml::tree::element>& rhs)
+    {
+        if (lhs.size() != rhs.size()) return false;
+        for (size_t i = 0; i < lhs.size(); i++)
+        {
+            if (lhs[i].get_index() != rhs[i].get_index()) return false;
+        }
+        return true;
+    }
+
+    void test(std::string& data)
+    {
+        // The queries are compiled before the document is loaded, so their 
+        // names are added to the table first.
+        auto table = std::make_shared<xml::name_table>();
+        query children("/r/a", *table);
+        query descendants("//a", *table);
+        query nested("//a//b", *table);
+        query any("//*[@k='1']", *table);
+        query has("//b[@id]", *table);
+        query both("//a[@k][@j='3']", *table);
+        query attributes("//@k", *table);
+        query last("/r//b/@id", *table);
+        query relative("a/b", *table);
+        query relative_attribute("*/@k", *table);
+        query missing("//missing", *table);
+
+        std::string small("<r><a k='1'><b/><a k='2' j='3'><b id='x'/></a></a><c k='1'/></r>");
+        xml::tree::document doc(small, table);
+        assert(names(children.select(doc)) == "a1 ");
+        assert(names(descendants.select(doc)) == "a1 a2 ");
+        assert(names(nested.select(doc)) == "b b ");
+        assert(names(any.select(doc)) == "a1 c1 ");
+        assert(names(has.select(doc)) == "b ");
+        assert(names(both.select(doc)) == "a2 ");
+        assert(missing.select(doc).empty());
+        assert(attributes.selects_attributes());
+        assert(values(attributes.select_attributes(doc)) == "k=1 k=2 k=1 ");
+        assert(values(last.select_attributes(doc)) == "id=x ");
+
+        xml::tree::element outer = doc.root().child("a");
+        assert(!relative.is_absolute());
+        assert(names(relative.select(outer)) == "b ");
+        assert(values(relative_attribute.select_attributes(doc.root())) == "k=1 k=1 ");
+
+        assert(is_invalid("", 0));
+        assert(is_invalid("//a[", 4));
+        assert(is_invalid("/@k/a", 3));
+        assert(is_invalid("a[@k=1]", 5));
+
+        // The results for a whole document are the same as filtering its 
+        // elements.
+        xml::tree::document tree(data, table);
+        std::vector<xml::tree::element> elements, jobs, labeled;
+        all_elements(tree.root(), elements);
+        size_t msgtypes = 0;
+        for (auto& e : elements)
+        {
+            if (e.name() == "job") jobs.push_back(e);
+            if (e.has_attribute("label")) labeled.push_back(e);
+            if (e.name() == "event" && e.has_attribute("msgtype")) msgtypes++;
+        }
+
+        assert(same(query("//job", *table).select(tree), jobs));
+        assert(same(query("//*[@label]", *table).select(tree), labeled));
+        assert(query("//event/@msgtype", *table).select_attributes(tree).size() == msgtypes);
+        assert(same(query("/*", *table).select(tree), std::vector<xml::tree::element>(1, tree.root())));
+        assert(same(query("//*", *table).select(tree), elements));
+    }
+}
+#endif
+
+#if 1
+namespace projection_test
+{
+    // Records the selected elements and attributes of each path, written 
+    // like reader_test::write().
+    struct recorder : public xml::projection::handler
+    {
+        std::vector<std::string> selected;
+
+        explicit recorder(size_t paths) : selected(paths) {}
+
+        void element(size_t path, const xml::tree::element& e)
+        {
+            reader_test::write(e, selected[path]);
+        }
+
+        template <typename string_t>
+        void attribute(size_t path, const string_t& name, const string_t& value)
+        {
+            selected[path] += name.str() + "=" + value.str() + " ";
+        }
+    };
+
+    bool is_rejected(const char* path)
+    {
+        xml::projection::automaton a;
+        try
+        {
+            a.add(path);
+        }
+        catch (std::exception&)
+        {
+            return true;
+        }
+        return false;
+    }
+
+    void test(std::string& data)
+    {
+        xml::projection::automaton a;
+        const char* paths[] = {
+            "/apiconfig/sndeventlist/event/@msgtype",
+            "//job",
+            "//event/*",
+            "//@label",
+            "/apiconfig/rcvjoblist",
+            "/apiconfig/missing//job",
+        };
+        for (auto path : paths) a.add(path);
+        assert(a.size() == 6);
+
+        // The projection selects the same elements and attributes as the 
+        // queries on the whole document.
+        recorder r(a.size());
+        xml::projection::parse(data, a, r);
+
+        xml::tree::document tree(data, a.shared_names());
+        for (size_t i = 0; i < a.size(); i++)
+        {
+            xml::xpath::query q(paths[i], a.names());
+            std::string expected;
+            if (q.selects_attributes())
+            {
+                for (auto attribute : q.select_attributes(tree)) expected += attribute.name().str() + "=" + attribute.value().str() + " ";
+            }
+            else
+            {
+                for (auto e : q.select(tree)) reader_test::write(e, expected);
+            }
+            assert(r.selected[i] == expected);
+        }
+        assert(!r.selected[0].empty() && !r.selected[1].empty() && r.selected[5].empty());
+
+        // Elements that can't contain anything selected aren't parsed.
+        xml::projection::automaton small;
+        small.add("/r/a");
+        small.add("//b/@k");
+        std::string skipped("<r><skip><x></y></skip><a k='1'>t<b k='2'/></a><b k='3'/></r>");
+        recorder s(small.size());
+        xml::projection::parse(skipped, small, s);
+        assert(s.selected[0] == "<a k='1'>t<b k='2'></b></a>");
+        assert(s.selected[1] == "k=2 k=3 ");
+
+        assert(is_rejected("a/b"));
+        assert(is_rejected("//a[@k]"));
+        assert(is_rejected("//a["));
+    }
+}
+#endif
+
+#if 1
+namespace writer_test
+{
+    void write_sample(xml::writer& w)
+    {
+        w.start_element("r");
+        w.attribute("a", std::string("1 < 2 & \"3\""));
+        w.start_element("e");
+        w.end_element();
+        w.text("x > 'y'");
+        w.comment(" c ");
+        w.start_element("f");
+        w.raw("<g/>");
+        w.end_element();
+        w.end_element();
+    }
+
+    const char* sample = "<r a=\"1 &lt; 2 &amp; &quot;3&quot;\"><e/>x &gt; &apos;y&apos;<!-- c --><f><g/></f></r>";
+
+    void test(std::string& data)
+    {
+        // Escaping, and closing empty elements with "/>".
+        xml::writer w;
+        write_sample(w);
+        assert(w.str() == sample);
+
+        w.clear();
+        w.declaration();
+        xml::name_table names;
+        xml::name_id r = names.intern("r"), k = names.intern("k");
+        w.start_element(names, r);
+        w.attribute(names, k, "v");
+        w.end_element();
+        assert(w.str() == "<?xml version=\"1.0\" encoding=\"UTF-8\"?><r k=\"v\"/>");
+
+        // A caller's buffer that's large enough, and one that isn't.
+        char buffer[256];
+        xml::writer fixed(buffer, sizeof(buffer));
+        write_sample(fixed);
+        assert(fixed.str() == sample && fixed.data() == buffer);
+
+        bool full = false;
+        try
+        {
+            xml::writer small(buffer, 16);
+            write_sample(small);
+        }
+        catch (std::exception&)
+        {
+            full = true;
+        }
+        assert(full);
+
+        // With a sink, the output is the same whatever the buffer size, 
+        // including data that's larger than the whole buffer.
+        std::string long_text(1000, 'z');
+        std::string expected = std::string(sample) + "<l>" + long_text + "</l>";
+        size_t sizes[] = { 1, 7, 64, 4096 };
+        for (size_t size : sizes)
+        {
+            std::string out;
+            size_t calls = 0;
+            auto sink = [&](const char* p, size_t n) { out.append(p, n); calls++; };
+
+            xml::writer sunk(sink, size);
+            write_sample(sunk);
+            sunk.start_element("l");
+            sunk.text(long_text);
+            sunk.end_element();
+            sunk.flush();
+            assert(out == expected);
+            assert(size == 4096 ? calls == 1 : calls > 1);
+
+            std::vector<char> caller(size);
+            std::string out2;
+            xml::writer both(caller.data(), size, [&](const char* p, size_t n) { out2.append(p, n); });
+            write_sample(both);
+            both.start_element("l");
+            both.text(long_text);
+            both.end_element();
+            both.flush();
+            assert(out2 == expected);
+        }
+
+        // Writing a document and parsing the output builds the same 
+        // document.
+        xml::tree::document tree(data);
+        xml::writer whole;
+        whole.write(tree.root());
+        std::string written = whole.str();
+        xml::tree::document again(written);
+
+        std::string lhs, rhs;
+        reader_test::write(tree.root(), lhs);
+        reader_test::write(again.root(), rhs);
+        assert(lhs == rhs);
+
+        // Strings from a reader are copied as they are.
+        std::string small_data("<r a='1'>t</r>");
+        xml::reader::document<std::string> doc(small_data);
+        auto root = doc.root();
+        xml::writer from_reader;
+        from_reader.start_element(root.name());
+        from_reader.end_element();
+        assert(from_reader.str() == "<r/>");
+    }
+}
+#endif
+
+#if 1
+namespace spans_test
+{
+    std::string write(const xml::tree::document& doc, const std::string& source)
+    {
+        xml::writer w;
+        w.write(doc, source);
+        return w.str();
+    }
+
+    // Writing a load_spans document over its source copies what wasn't 
+    // edited, and regenerates only what was.
+    void test(std::string& data)
+    {
+        std::string small("<?xml version='1.0'?>\n<!-- c -->\n<r a = 'x'  b=\"y\">\n  <e k='1'/>\n  text\n</r>\n");
+
+        xml::tree::document doc(small, xml::tree::load_spans);
+        assert(doc.has_sources() && doc.dirty_nodes().empty());
+        assert(write(doc, small) == small);
+
+        doc.set_attribute(doc.root().child("e"), "k", "2");
+        for (auto n : doc.root().nodes())
+        {
+            if (n.is_text() && n.text() == "\n  text\n") doc.set_text(n, "\n  edited\n");
+        }
+        assert(doc.dirty_nodes().size() == 2);
+
+        std::string edited = write(doc, small);
+        assert(edited == "<?xml version='1.0'?>\n<!-- c -->\n<r a = 'x'  b=\"y\">\n  <e k=\"2\"/>\n  edited\n</r>\n");
+
+        // Parsing the output gives the edited document.
+        xml::tree::document reloaded(edited);
+        std::string lhs, rhs;
+        reader_test::write(reloaded.root(), lhs);
+        reader_test::write(doc.root(), rhs);
+        assert(lhs == rhs);
+
+        // An edited attribute is written after a single space, and the 
+        // others keep their formatting.  Removed attributes are dropped.
+        doc.set_attribute(doc.root(), "b", "z");
+        doc.set_attribute(doc.root(), "c", "new");
+        assert(write(doc, small) == "<?xml version='1.0'?>\n<!-- c -->\n<r a = 'x' b=\"z\" c=\"new\">\n  <e k=\"2\"/>\n  edited\n</r>\n");
+        assert(doc.remove_attribute(doc.root(), doc.names().find("a")));
+        assert(write(doc, small) == "<?xml version='1.0'?>\n<!-- c -->\n<r b=\"z\" c=\"new\">\n  <e k=\"2\"/>\n  edited\n</r>\n");
+
+        // Documents that weren't loaded with load_spans can't be written 
+        // over a source.
+        bool thrown = false;
+        try
+        {
+            xml::tree::document eager(small);
+            write(eager, small);
+        }
+        catch (std::exception&)
+        {
+            thrown = true;
+        }
+        assert(thrown);
+
+        // The test data is ISO-8859-1, so edits are written in that 
+        // encoding, with references for what it can't represent.
+        xml::tree::document config(data, xml::tree::load_spans);
+        assert(config.has_latin1_source());
+        assert(write(config, data) == data);
+
+        std::string sunk;
+        xml::writer to_sink([&](const char* p, size_t n) { sunk.append(p, n); }, 256);
+        to_sink.write(config, data);
+        to_sink.flush();
+        assert(sunk == data);
+
+        xml::tree::element event = config.root().child("sndeventlist").child("event");
+        config.set_attribute(event, "msgtype", "\xC3\xA9\xE2\x82\xAC");
+        std::string output = write(config, data);
+        size_t tag = data.find("<event");
+        size_t end = data.find('>', tag);
+        size_t tail = data.size() - end;
+        assert(output.compare(0, tag, data, 0, tag) == 0);
+        assert(output.compare(output.size() - tail, tail, data, end, tail) == 0);
+        assert(output.find("msgtype=\"\xE9&#x20AC;\"") != std::string::npos);
+
+        xml::tree::document written(output);
+        assert(written.root().child("sndeventlist").child("event").attribute("msgtype") == "\xC3\xA9&#x20AC;");
+    }
+}
+#endif
+
+#if 1
+namespace snapshot_test
+{
+    typedef xml::tree::snapshot snapshot;
+
+    std::string dump(const xml::tree::document& doc)
+    {
+        xml::writer w;
+        w.write(doc.root());
+        return w.str();
+    }
+
+    std::string read_file(const char* path)
+    {
+        std::ifstream in(path, std::ios::binary);
+        return std::string(std::istreambuf_iterator<char>(in.rdbuf()), std::istreambuf_iterator<char>());
+    }
+
+    void write_file(const char* path, const std::string& data)
+    {
+        std::ofstream out(path, std::ios::binary | std::ios::trunc);
+        out.write(data.data(), data.size());
+    }
+
+    // A snapshot loads as the document that was saved, but only for the 
+    // checksum it was saved with.
+    void test(std::string& data)
+    {
+        const char* path = "test\\snapshot_test.snap";
+        uint64_t checksum = snapshot::checksum(data);
+        assert(checksum != snapshot::checksum(data.data(), data.size() - 1));
+
+        xml::tree::document eager(data);
+        std::string expected = dump(eager);
+        snapshot::save(eager, checksum, path);
+        std::shared_ptr<xml::tree::document> loaded = snapshot::load(path, checksum);
+        assert(loaded && dump(*loaded) == expected && loaded->size() == eager.size());
+        assert(!snapshot::load(path, checksum + 1));
+
+        // (The file is mapped until the document is destroyed, and can't be 
+        // written over until then.)
+        loaded.reset();
+
+        // With a table that already has names, the IDs are renumbered.
+        auto names = std::make_shared<xml::name_table>();
+        names->intern("first");
+        loaded = snapshot::load(path, checksum, names);
+        assert(loaded && dump(*loaded) == expected);
+        assert(loaded->root().id() == names->find("apiconfig"));
+
+        // Editing a loaded document copies its arrays, rather than writing 
+        // to the file.
+        std::string file = read_file(path);
+        loaded->set_attribute(loaded->root(), "edited", "1");
+        assert(loaded->root().attribute("edited") == "1");
+        loaded.reset();
+        assert(read_file(path) == file);
+
+        // Shared documents stay shared, lazy documents are parsed first, 
+        // and pooled strings are saved with the document.
+        xml::tree::document shared(data, xml::tree::load_shared);
+        snapshot::save(shared, checksum, path);
+        loaded = snapshot::load(path, checksum);
+        assert(loaded && loaded->is_shared() && dump(*loaded) == expected);
+        loaded.reset();
+
+        xml::tree::document lazy(data, xml::tree::load_lazy);
+        snapshot::save(lazy, checksum, path);
+        loaded = snapshot::load(path, checksum);
+        assert(loaded && dump(*loaded) == expected);
+        loaded.reset();
+
+        xml::tree::document pooled(data, std::make_shared<xml::name_table>(), std::make_shared<xml::string_pool>());
+        snapshot::save(pooled, checksum, path);
+        loaded = snapshot::load(path, checksum);
+        assert(loaded && dump(*loaded) == expected);
+        loaded.reset();
+
+        // Truncated or corrupt snapshots are rejected, or at least load as 
+        // documents that can be read without going out of bounds.
+        snapshot::save(eager, checksum, path);
+        file = read_file(path);
+        write_file(path, file.substr(0, file.size() - 1));
+        assert(!snapshot::load(path, checksum));
+
+        size_t rejected = 0;
+        for (size_t i = 0; i < 500; i++)
+        {
+            std::string corrupt = file;
+            size_t offset = (i * 7919) % corrupt.size();
+            corrupt[offset] = static_cast<char>(corrupt[offset] ^ (1 + i % 255));
+            write_file(path, corrupt);
+
+            loaded = snapshot::load(path, checksum);
+            if (loaded)
+                dump(*loaded);
+            else
+                rejected++;
+            loaded.reset();
+        }
+        assert(rejected > 0);
+
+        remove(path);
+    }
+}
+#endif
+
+#if 1
+namespace document_cache_test
+{
+    typedef xml::document_cache::document_ptr document_ptr;
+
+    void test(std::string& data)
+    {
+        // Identical sources are parsed once, wherever they come from.
+        xml::document_cache cache;
+        std::string copy = data;
+        document_ptr first = cache.get(data);
+        document_ptr second = cache.get(copy);
+        assert(first == second && cache.size() == 1);
+        assert(cache.memory_size() == first->memory_size() + data.size());
+
+        std::string other("<r a='1'/>");
+        document_ptr small = cache.get(other);
+        assert(small != first && cache.size() == 2);
+        assert(&small->names() == &first->names() && &small->names() == &cache.names());
+
+        // Files are mapped, and cached by content like other sources.
+        const char* path = "document_cache_test.xml";
+        {
+            std::ofstream out(path, std::ios::binary | std::ios::trunc);
+            out.write(other.data(), other.size());
+        }
+        assert(cache.get_file(path) == small);
+        remove(path);
+
+        // Parse errors are passed on, and aren't cached.
+        std::string bad("<r><e></r>");
+        for (int i = 0; i < 2; i++)
+        {
+            bool thrown = false;
+            try
+            {
+                cache.get(bad);
+            }
+            catch (xml::parse_exception&)
+            {
+                thrown = true;
+            }
+            assert(thrown && cache.size() == 2);
+        }
+
+        // The least recently used documents are evicted to stay within the 
+        // budget, but remain valid.
+        // (The budget fits two of these documents, which are about the 
+        // same size.)
+        std::string a("<a>first</a>"), b("<b>second</b>"), c("<c>third</c>");
+        xml::document_cache sizes;
+        document_ptr doc_a = sizes.get(a);
+        size_t each = sizes.memory_size();
+        xml::document_cache tight(2 * each + each / 2);
+        doc_a = tight.get(a);
+        document_ptr doc_b = tight.get(b);
+        assert(tight.get(a) == doc_a);
+        document_ptr doc_c = tight.get(c);
+        assert(tight.size() == 2 && tight.memory_size() <= 2 * each + each / 2);
+        assert(tight.get(a) == doc_a && doc_b->root().text() == "second");
+        assert(tight.get(b) != doc_b);
+
+        tight.clear();
+        assert(tight.size() == 0 && tight.memory_size() == 0);
+        assert(tight.get(c) != doc_c);
+
+        // Concurrent requests for the same source share one document.
+        xml::document_cache shared(64 * 1024 * 1024, std::make_shared<xml::string_pool>());
+        std::vector<document_ptr> results(8);
+        std::vector<std::thread> threads;
+        for (size_t i = 0; i < results.size(); i++) threads.push_back(std::thread([&, i]() { results[i] = shared.get(data); }));
+        for (auto& t : threads) t.join();
+        for (auto& r : results) assert(r == results[0]);
+        assert(shared.size() == 1 && results[0]->pool() == shared.pool());
+
+        std::string lhs, rhs;
+        reader_test::write(results[0]->root(), lhs);
+        reader_test::write(first->root(), rhs);
+        assert(lhs == rhs);
+    }
+}
+#endif
+
+#if 1
+namespace reparse_test
+{
+    std::string dump(const xml::tree::document& doc)
+    {
+        xml::writer w;
+        w.write(doc.root());
+        return w.str();
+    }
+
+    std::string write(const xml::tree::document& doc, const std::string& source)
+    {
+        xml::writer w;
+        w.write(doc, source);
+        return w.str();
+    }
+
+    // Replaces 'removed' bytes at 'offset' with 'inserted', in both the 
+    // source and the document, and checks that the document is the same 
+    // as one loaded from the new source (or, if the new source isn't well 
+    // formed, that reparse() throws and the document doesn't change).  
+    // Returns false if the edit was rejected.
+    bool edit(xml::tree::document& doc, std::string& source, size_t offset, size_t removed, const std::string& inserted)
+    {
+        std::string next = source.substr(0, offset) + inserted + source.substr(offset + removed);
+        std::string before = dump(doc);
+
+        std::unique_ptr<xml::tree::document> fresh;
+        try
+        {
+            fresh.reset(new xml::tree::document(next, xml::tree::load_spans));
+        }
+        catch (xml::parse_exception&)
+        {
+        }
+
+        bool thrown = false;
+        try
+        {
+            doc.reparse(next, offset, removed, inserted.size());
+        }
+        catch (xml::parse_exception&)
+        {
+            thrown = true;
+        }
+
+        if (!fresh)
+        {
+            assert(thrown && dump(doc) == before && write(doc, source) == source);
+            return false;
+        }
+
+        assert(!thrown);
+        source = next;
+        assert(dump(doc) == dump(*fresh) && write(doc, source) == source);
+        assert(doc.size() == fresh->size() && doc.memory_size() == fresh->memory_size());
+        return true;
+    }
+
+    void test(std::string& data)
+    {
+        std::string source("<?xml version='1.0'?>\n<!-- c -->\n<r a = 'x'  b=\"y\">\n  <e k='1'/>\n  <t>text</t>\n</r>\n");
+        xml::tree::document doc(source, xml::tree::load_spans);
+
+        // Only the element that contains the edit is parsed again.
+        size_t offset = source.find("k='") + 3;
+        std::string next = source;
+        next.insert(offset, "9");
+        xml::tree::node_index e = doc.root().child("e").get_index();
+        assert(doc.reparse(next, offset, 0, 1) == e);
+        source = next;
+        assert(doc.root().child("e").attribute("k") == "91");
+        assert(write(doc, source) == source);
+
+        // Edits outside that element are kept, and are written over the new 
+        // source (an edited attribute is written again, after a single 
+        // space).
+        doc.set_attribute(doc.root(), "b", "z");
+        offset = source.find("text");
+        next = source.substr(0, offset) + "changed" + source.substr(offset + 4);
+        assert(doc.reparse(next, offset, 4, 7) == doc.root().child("t").get_index());
+        source = next;
+        assert(write(doc, source) == "<?xml version='1.0'?>\n<!-- c -->\n<r a = 'x' b=\"z\">\n  <e k='91'/>\n  <t>changed</t>\n</r>\n");
+
+        // Edits of the element itself are lost.
+        offset = source.find("b=\"y\"") + 3;
+        next = source.substr(0, offset) + "w" + source.substr(offset + 1);
+        assert(doc.reparse(next, offset, 1, 1) == 0);
+        source = next;
+        assert(doc.dirty_nodes().empty() && doc.root().attribute("b") == "w");
+
+        // An edit outside the root element parses the whole document, and 
+        // one that leaves it malformed throws.
+        assert(edit(doc, source, source.find("c -->"), 1, "comment"));
+        assert(!edit(doc, source, source.find("/>"), 1, ""));
+        assert(!edit(doc, source, source.find("</r>"), 4, ""));
+        assert(edit(doc, source, source.find("<e"), 0, "<n><m/>t</n>"));
+
+        // A series of edits anywhere in the test data, from a fixed seed, 
+        // whose results match loading the edited data.
+        std::string config = data;
+        xml::tree::document tree(config, xml::tree::load_spans);
+        const char* insertions[] = { "x", "<a/>", "<b q='1'>t<c/></b>", "</c>", "\"", "  ", "xyz", "<" };
+        uint32_t seed = 1;
+        size_t accepted = 0;
+        for (size_t i = 0; i < 100; i++)
+        {
+            seed = seed * 1103515245 + 12345;
+            size_t at = (seed >> 8) % config.size();
+            size_t removed = (seed & 3) == 0 ? (seed >> 4) % 12 : 0;
+            if (at + removed > config.size()) removed = 0;
+            if (edit(tree, config, at, removed, insertions[(seed >> 16) % 8])) accepted++;
+        }
+        assert(accepted > 0);
+
+        // The reparsed document can be edited, and saved, like any other.
+        tree.set_attribute(tree.root(), "edited", "1");
+        std::string output = write(tree, config);
+        xml::tree::document reloaded(output);
+        assert(dump(reloaded) == dump(tree));
+    }
+}
+#endif
+
+#if 1
+namespace diff_test
+{
+    // Compares two versions of a document (the changes refer to the 
+    // documents, which are kept with them).
+    struct comparison
+    {
+        std::string first, second;
+        xml::tree::document before, after;
+        std::vector<xml::diff::change> changes;
+
+        comparison(const std::string& a, const std::string& b)
+            : first(a), second(b), before(first), after(second)
+        {
+            before.compute_hashes();
+            after.compute_hashes();
+            changes = xml::diff::compare(before, after);
+        }
+    };
+
+    uint64_t hash(std::string data)
+    {
+        xml::tree::document doc(data);
+        doc.compute_hashes();
+        return doc.root().hash();
+    }
+
+    void test(std::string& data)
+    {
+        // The hashes ignore the order of attributes, and the name table.
+        assert(hash("<r a='1' b='2'>t<e/></r>") == hash("<r b='2' a='1'>t<e/></r>"));
+        assert(hash("<r a='1'/>") != hash("<r a='2'/>"));
+        assert(hash("<r>t</r>") != hash("<r>u</r>"));
+        assert(hash("<r><a/><b/></r>") != hash("<r><b/><a/></r>"));
+
+        // Changed, removed and added elements.
+        std::string first("<r><a x='1'/><b>t</b><c/></r>");
+        comparison edit(first, "<r><a x='2'/><b>t</b><d/></r>");
+        std::vector<xml::diff::change>& changes = edit.changes;
+        assert(changes.size() == 3);
+        assert(changes[0].kind == xml::diff::element_changed && changes[0].before.name() == "a" && changes[0].after.attribute("x") == "2");
+        assert(changes[1].kind == xml::diff::element_removed && changes[1].before.name() == "c" && !changes[1].after);
+        assert(changes[2].kind == xml::diff::element_added && changes[2].after.name() == "d" && !changes[2].before);
+        assert(comparison(first, first).changes.empty());
+
+        // Only the element whose own content changed is listed, moved 
+        // siblings aren't changes, and neither is the whitespace of added 
+        // children.
+        comparison nested("<r><a><b x='1'/></a></r>", "<r><a><b x='2'/></a></r>");
+        assert(nested.changes.size() == 1 && nested.changes[0].before.name() == "b");
+        assert(comparison("<r><a/><b/><c/></r>", "<r><c/><a/><b/></r>").changes.empty());
+        comparison added("<r>\n  <a/>\n</r>", "<r>\n  <a/>\n  <b/>\n</r>");
+        assert(added.changes.size() == 1 && added.changes[0].kind == xml::diff::element_added);
+
+        comparison renamed("<r/>", "<s/>");
+        assert(renamed.changes.size() == 2);
+        assert(renamed.changes[0].kind == xml::diff::element_removed && renamed.changes[1].kind == xml::diff::element_added);
+
+        // One edited attribute in the test data is one change.
+        std::string edited = data;
+        size_t offset = edited.find("msgtype=\"0x1261\"");
+        edited.replace(offset, 16, "msgtype=\"0x9999\"");
+        comparison config(data, edited);
+        assert(config.changes.size() == 1 && config.changes[0].kind == xml::diff::element_changed);
+        assert(config.changes[0].before.name() == "event" && config.changes[0].after.attribute("msgtype") == "0x9999");
+
+        // Editing a document discards its hashes, and documents without 
+        // hashes can't be compared.
+        xml::tree::document doc(first);
+        doc.compute_hashes();
+        assert(doc.has_hashes());
+        doc.set_attribute(doc.root(), "y", "1");
+        assert(!doc.has_hashes());
+
+        bool thrown = false;
+        try
+        {
+            xml::diff::compare(doc, doc);
+        }
+        catch (std::exception&)
+        {
+            thrown = true;
+        }
+        assert(thrown);
+    }
+}
+#endif
+
+#if 1
+namespace shared_test
+{
+    std::string dump(const xml::tree::document& doc)
+    {
+        xml::writer w;
+        w.write(doc.root());
+        return w.str();
+    }
+
+    std::string names(const std::vector<xml::tree::element>& elements)
+    {
+        std::string ret;
+        for (auto& e : elements) ret += e.name().str() + e.attribute("x").str() + " ";
+        return ret;
+    }
+
+    // A load_shared document has the same content as an eager one, with 
+    // fewer nodes when subtrees repeat.
+    void test(std::string& data)
+    {
+        xml::tree::document eager(data);
+        xml::tree::document shared(data, xml::tree::load_shared);
+        assert(shared.is_shared() && shared.has_hashes());
+        assert(dump(shared) == dump(eager));
+        assert(shared.size() <= eager.size());
+
+        eager.compute_hashes();
+        assert(shared.root().hash() == eager.root().hash());
+
+        std::string repeated("<r><a x='1'><b/>t</a><a x='1'><b/>t</a><c><a x='1'><b/>t</a></c><a x='2'/></r>");
+        xml::tree::document small_eager(repeated);
+        xml::tree::document small_shared(repeated, xml::tree::load_shared);
+        assert(dump(small_shared) == dump(small_eager));
+        assert(small_shared.size() < small_eager.size());
+
+        // The repeated elements share their descendants.
+        auto children = small_shared.root().elements().begin();
+        xml::tree::element first = *children++;
+        xml::tree::element second = *children;
+        xml::tree::element b = first.child("b");
+        assert(second.get_index() != first.get_index() && second.child("b").get_index() == b.get_index());
+
+        // Queries return each occurrence, in document order.
+        auto table = small_shared.shared_names();
+        xml::xpath::query all("//a", *table), nested("//a/b", *table), inner("/r/c/a", *table);
+        assert(names(all.select(small_shared)) == "a1 a1 a1 a2 ");
+        assert(nested.select(small_shared).size() == 3);
+        assert(nested.select(small_shared)[2].get_index() == b.get_index());
+        assert(names(inner.select(small_shared)) == "a1 ");
+
+        xml::tree::document table_eager(repeated, table);
+        assert(names(all.select(table_eager)) == names(all.select(small_shared)));
+
+        xml::xpath::query events("//event/@msgtype", shared.names());
+        assert(events.select_attributes(shared).size() == xml::xpath::query("//event/@msgtype", eager.names()).select_attributes(eager).size());
+
+        bool thrown = false;
+        try
+        {
+            small_shared.set_attribute(small_shared.root(), "y", "1");
+        }
+        catch (std::exception&)
+        {
+            thrown = true;
+        }
+        assert(thrown);
+    }
+}
+#endif
+
+#if 1
+namespace string_pool_test
+{
+    std::string dump(const xml::tree::document& doc)
+    {
+        xml::writer w;
+        w.write(doc.root());
+        return w.str();
+    }
+
+    bool is_rejected(size_t max_length)
+    {
+        try
+        {
+            xml::string_pool pool(max_length);
+        }
+        catch (std::exception&)
+        {
+            return true;
+        }
+        return false;
+    }
+
+    void test(std::string& data)
+    {
+        // Each distinct string is stored once, and its view doesn't move as 
+        // more strings are added.
+        xml::string_pool pool;
+        assert(pool.max_length() == 64 && pool.size() == 0);
+        xml::string_handle h = pool.intern("AA_INT");
+        assert(pool.intern(std::string("AA_INT")) == h && pool.intern("AA_UINT") != h);
+        assert(pool.view(h) == "AA_INT" && pool.view(pool.intern("")) == "");
+        assert(pool.size() == 3);
+
+        const char* p = pool.view(h).data();
+        std::vector<std::string> values;
+        for (size_t i = 0; i < 40000; i++)
+        {
+            std::ostringstream value;
+            value << "value " << i << std::string(i % 48, 'x');
+            values.push_back(value.str());
+        }
+        std::vector<xml::string_handle> handles;
+        for (auto& v : values) handles.push_back(pool.intern(v));
+        assert(pool.memory_size() > (1 << 20));
+        assert(pool.view(h).data() == p);
+        for (size_t i = 0; i < values.size(); i++) assert(pool.view(handles[i]) == values[i]);
+
+        assert(!is_rejected(0xFFFF) && is_rejected(0x10000));
+
+        // Threads that add the same strings at once get the same handles.
+        xml::string_pool concurrent;
+        std::vector<std::vector<xml::string_handle>> results(4);
+        std::vector<std::thread> threads;
+        for (size_t t = 0; t < results.size(); t++)
+        {
+            threads.push_back(std::thread([&, t]() {
+                for (size_t i = 0; i < 2000; i++) results[t].push_back(concurrent.intern(values[(i * (t + 1)) % 2000]));
+            }));
+        }
+        for (auto& t : threads) t.join();
+        assert(concurrent.size() == 2000);
+        for (size_t t = 0; t < results.size(); t++)
+        {
+            for (size_t i = 0; i < 2000; i++) assert(results[t][i] == concurrent.intern(values[(i * (t + 1)) % 2000]));
+        }
+
+        // Documents that share a pool store their common values once, and 
+        // have the same content as documents without one.  Text longer 
+        // than max_length() stays in the document.
+        xml::tree::document plain(data);
+        auto shared = std::make_shared<xml::string_pool>();
+        auto names = std::make_shared<xml::name_table>();
+        xml::tree::document first(data, names, shared);
+        size_t distinct = shared->size();
+        std::string copy = data;
+        xml::tree::document second(copy, names, shared);
+        assert(shared->size() == distinct);
+        assert(dump(first) == dump(plain) && dump(second) == dump(plain));
+        assert(first.memory_size() < plain.memory_size());
+
+        std::string long_text(100, 't');
+        std::string small("<r a='AA_INT'>" + long_text + "</r>");
+        xml::tree::document pooled(small, names, shared);
+        assert(pooled.root().attribute("a") == "AA_INT" && pooled.root().text() == long_text);
+        assert(shared->size() <= distinct + 1);
+
+        // Edited values are pooled too.
+        size_t before = shared->size();
+        pooled.set_attribute(pooled.root(), "a", "edited value");
+        assert(pooled.root().attribute("a") == "edited value" && shared->size() == before + 1);
+    }
+}
+#endif
+
+template <typename container_t>
+void read_dump(container_t& c)
+{
+    xml::reader::document<container_t> doc(c);
+    auto root = doc.root();
+    dump_element(root, 0);
+}
+
+template <typename iterator_t>
+void dump_element(xml::reader::element<iterator_t>& e, int indent)
+{
+    //std::cout << indent << "element: " << e.name() << std::endl;
+    //std::cout << indent << "attributes: ";
+
+    xml::reader::attribute<iterator_t> a = e.next_attribute();
+    if (a.is_end())
+    {
+        //std::cout << "(none)" << std::endl;
+    }
+    else
+    {
+        //std::cout << std::endl;
+
+        for (; !a.is_end(); a = a.next_attribute())
+        {
+            //std::cout << indent << "  " << a.name() << "=" << a.value() << std::endl;
+        }
+    }
+
+    auto nextIndent = indent + 2;
+    //std::cout << indent << "childnodes: ";
+    xml::reader::node<iterator_t> child = a.next_child();
+    if (child.is_end())
+    {
+        //std::cout << "(none)" << std::endl;
+    }
+    else
+    {
+        //std::cout << std::endl;
+        for (; !child.is_end(); child = child.next_sibling())
+        {
+            if (child.is_text())
+            {
+                //std::cout << nextIndex << "textnode: " << child.text() << std::endl;
+            }
+            else
+            {
+                auto e = child.element();
+                dump_element(e, nextIndent);
+            }
+        }
+    }
+}
+
+#include <Windows.h>
+long long time()
+{
+    /* Windows */
+    FILETIME ft;
+    LARGE_INTEGER li;
+
+    /* Get the amount of 100 nano seconds intervals elapsed since January 1, 1601 (UTC) and copy it
+    * to a LARGE_INTEGER structure. */
+    GetSystemTimeAsFileTime(&ft);
+    li.LowPart = ft.dwLowDateTime;
+    li.HighPart = ft.dwHighDateTime;
+
+    return li.QuadPart;
+}
+
+int _tmain(int argc, _TCHAR* argv[])
+{
+    ast_tag_test::test();
+    line_index_test::test();
+    validate_test::test();
+    transcode_test::test();
+    latin1_test::test();
+    match_string_test::test();
+    name_table_test::test();
+    skip_test::test();
+
+#if 0
+    /* Pruned AST test */
+    {
+        using namespace placeholders;
+        using namespace parse;
+        using namespace parse::operators;
+        using namespace parse::terminals;
+
+        auto a = u<'a'>();
+        auto b = u<'b'>();
+
+        auto p = (a | b) >> a[_0] >> b[_1] >> (a | b)[_3];
+
+        typedef decltype(p) p_type;
+
+        typedef parse::parser_ast<p_type, std::string::iterator>::type ast_type;
+        ast_type ast;
+
+        std::string data("baba");
+
+        bool valid = p.parse_from(data.begin(), data.end(), ast);
+
+        auto& m0 = ast[_0];
+        auto& m1 = ast[_1];
+        auto& m3 = ast[_3];
+
+        std::cout << std::endl;
+    }
+#endif
+
+  /* Unicode tests
+  //std::string v = "\xEF\xBB\xBFthis is a UTF8-encoded string with a BOM.";
+  //std::string v = "this is a UTF8-encoded string without a BOM.";
+  std::wstring wv(L"\uFEFFthis is a UTF16-encoded string with a BOM.");
+  std::string v((const char*)wv.c_str(), wv.size() * 2);
+
+  unicode::unicode_container<std::string> ustring(v);
+
+  auto i = ustring.begin();
+  auto end = ustring.end();
+
+  for (; i != end; i++)
+  {
+      std::cout << "char: " << (char)*i << std::endl;
+  }
+  */
+
+    /* XML parser test
+    using namespace parse;
+    using namespace parse::operators;
+
+    std::string test_data("<?xml encoding='UTF-8'?><nspre:root attribute1=\"value1\">");
+    auto p = xml::parser::prolog() >> xml::parser::element_open();
+    parse::ast_type<decltype(p), std::string::iterator>::type p_ast;
+    bool valid = p.parse(test_data, p_ast);
+    */
+
+    // XML reader test
+
+    // UTF-8 encoding
+    //std::string xml_data("\xEF\xBB\xBF<?xml encoding='UTF-8'?><nspre:root attribute1=\"value1\">root content part 1<ns:child1>child1 content<grandchild11></grandchild11></ns:child1><child2>child2 content</child2></nspre:root>");
+    
+    // UTF-16 encoding
+    //std::wstring wxml_data(L"\uFFFE<?xml encoding='UTF-8'?><nspre:root attribute1=\"value1\">root content part 1<ns:child1>child1 content<grandchild11></grandchild11></ns:child1><child2>child2 content</child2></nspre:root>");
+    //std::string xml_data((const char*)wxml_data.c_str(), wxml_data.size() * 2);
+
+    // UTF-16 native string (with and without BOM)
+    //std::wstring xml_data(L"<?xml encoding='UTF-8'?><nspre:root attribute1=\"value1\">root content part 1<ns:child1>child1 content<grandchild11/></ns:child1><child2>child2 content</child2></nspre:root>");
+    //std::wstring xml_data(L"\uFFFE<?xml encoding='UTF-8'?><nspre:root attribute1=\"value1\">root content part 1<ns:child1>child1 content<grandchild11></grandchild11></ns:child1><child2>child2 content</child2></nspre:root>");
+
+    // String stream parsing
+    //std::stringstream stream_data("<?xml encoding='UTF-8'?><nspre:root attribute1=\"value1\"  attribute2='value2'>root content part 1<ns:child1>child1 content<grandchild11 a='123' /></ns:child1><child2>child2 content</child2></nspre:root>");
+    //util::streambuf_container<std::streambuf> xml_data(stream_data.rdbuf());
+
+    // File parsing
+    std::ifstream ifs;
+    ifs.open("test\\cfg_test.cfg", std::ios::in | std::ios::binary);
+    std::string xml_data(std::istreambuf_iterator<char>(ifs.rdbuf()), std::istreambuf_iterator<char>());
+    //util::streambuf_container<std::streambuf> xml_data(ifs.rdbuf());
+
+    typedef decltype(xml_data) data_type;
+
+    reader_test::test(xml_data);
+    cursor_test::test(xml_data);
+    event_range_test::test(xml_data);
+    sax_test::test(xml_data);
+    document_stream_test::test(xml_data);
+    xpath_test::test(xml_data);
+    projection_test::test(xml_data);
+    writer_test::test(xml_data);
+    spans_test::test(xml_data);
+    snapshot_test::test(xml_data);
+    document_cache_test::test(xml_data);
+    reparse_test::test(xml_data);
+    diff_test::test(xml_data);
+    shared_test::test(xml_data);
+    string_pool_test::test(xml_data);
+
+    long long t1, t2;
+
+    /* stream performance test */
+#if 1
+    for (int i = 0; i < 2; i++)
+    {
+        unicode::unicode_container<std::string> uc(xml_data);
+        t1 = time();
+        auto begin = uc.begin();
+        auto end = uc.end();
+        for (auto i = begin; i != end; i++);
+        t2 = time();
+        std::cout << "stream iterate time: " << double(t2 - t1)/10000 << std::endl;
+
+        std::string copy;
+        copy.resize(xml_data.size());
+        t1 = time();
+        utf8::utf32to8(uc.begin(), uc.end(), std::back_inserter(copy));
+        t2 = time();
+        std::cout << "stream copy time: " << double(t2 - t1)/10000 << std::endl;
+    }
+#endif
+
+    /* XML Tree Test */
+#if 1
+    t1 = time();
+    xml::tree::document doc(xml_data);
+    t2 = time();
+    std::cout << "tree parse elapsed time: " << double(t2 - t1)/10000 << std::endl;
+#endif
+
+    /* XML Reader Test */
+#if 1
+    std::cout.setstate(std::ios_base::badbit);
+    t1 = time();
+    read_dump(xml_data);
+    t2 = time();
+    std::cout.clear();
+    std::cout << "reader parse time: " << double(t2 - t1)/10000 << std::endl;
+#endif
+
+#if 1
+    /* XML parse-only test */
+    {
+        t1 = time();
+        auto start = xml_data.begin();
+        bool valid = xml::grammar::document::parse_from(start, xml_data.end());
+        t2 = time();
+        std::cout << "parse-only time: " << double(t2 - t1)/10000 << ", valid=" << std::boolalpha << valid << std::endl;
+    }
+#endif
+
+#if 1
+    {
+        t1 = time();
+        auto start = xml_data.begin();
+        parse::parser_ast<xml::grammar::document, data_type::iterator>::type ast;
+        bool valid = xml::grammar::document::parse_from(start, xml_data.end(), ast);
+        t2 = time();
+        std::cout << "parse-only with AST time: " << double(t2 - t1)/10000 << ", valid=" << std::boolalpha << valid << std::endl;
+        auto l = parse::tree::last_match(ast);
+        std::cout << "last match: " << (int)xml_data.begin()._Ptr << ", " << (int)l._Ptr << std::endl;
+
+        auto& root = ast[_0][_3].matches[23][_0].get()[_3].matches[165][_0].get()[_1].matches[0][_1][_1];
+        std::cout << "root element: " << xml::get_string(root) << std::endl;
+
+        auto& tmp = ast[_0][_1];
+    }
+#endif
+
+    /* XML Tree Test */
+    /*
+    // Some typedefs for convenience
+    typedef xml::document<decltype(xml_data)> document;
+    typedef document::element_type element;
+    typedef element::attribute_type attribute;
+
+    try
+    {
+        auto start = GetTimeMs64();
+        document doc(xml_data);
+        auto end = GetTimeMs64();
+
+        std::cout << "Parse time: " << (end - start) << std::endl;
+
+        typedef unicode::unicode_container<decltype(xml_data)>::iterator iterator_t;
+
+        std::cout << "document AST (string iterator) size: " << sizeof(parse::ast_type<xml::parser::element, std::string::iterator>::type) << std::endl;
+        std::cout << "document AST (unicode_iterator) size: " << sizeof(parse::ast_type<xml::parser::document, iterator_t>::type) << std::endl;
+        std::cout << "document parser size: " << sizeof(xml::parser::document) << std::endl;
+        std::cout << "element AST size: " << sizeof(parse::ast_type<xml::parser::element, iterator_t>::type) << std::endl;
+        std::cout << "unicode iterator size: " << sizeof(iterator_t) << std::endl;
+        std::cout << "string iterator size: " << sizeof(std::string::iterator) << std::endl;
+
+        auto root = doc.root();
+
+        auto name = root.name();
+        auto localname = root.local_name();
+        auto prefix = root.prefix();
+
+        auto& attributes = root.attributes;
+    
+        std::for_each(attributes.begin(), attributes.end(), [](attribute& a)
+        {
+            std::cout << "root attribute: " << a.name() << "=" << a.value() << std::endl;
+        });
+
+        auto attribute1 = root.attributes["attribute1"];
+
+        std::for_each(root.elements.begin(), root.elements.end(), [](element& e)
+        {
+            std::cout << "child element: " << e.name() << std::endl;
+        });
+
+        auto text = root.text();
+
+        auto child = *std::find_if(root.elements.begin(), root.elements.end(), [](element& e)
+        {
+            return e.local_name() == "child1";
+        });
+
+        auto gchild = *std::find_if(child.elements.begin(), child.elements.end(), [](element& e)
+        {
+            return e.name() == "grandchild11";
+        });
+
+        auto gchild_text = gchild.text();
+        auto gchild_name = gchild.name();
+
+        auto hasAttribs = gchild.attributes.begin() != gchild.attributes.end();
+    }
+    catch (xml::parse_exception& e)
+    {
+        std::cout << e.what() << std::endl;
+    }
+    */
+
+    return 0;
+}
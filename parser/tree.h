@@ -1,164 +1,1861 @@
-#pragma once
-
-#include <list>
-#include <map>
-#include "reader.h"
-
-namespace xml
-{
-    namespace tree
-    {
-        class document;
-        class element;
-        class attribute;
-        class text;
-
-        class node
-        {
-            enum { textnode, elementnode } type;
-            union
-            {
-                element* element;
-                std::string* text;
-            } node_ptr;
-
-        public:
-            node(element* e)
-            {
-                node_ptr.element = e;
-            }
-
-            node(std::string* s)
-            {
-                node_ptr.text = s;
-            }
-        };
-
-        class element
-        {
-            std::string _name;
-            std::map<std::string, std::string> _attributes;
-            std::list<node> _childnodes;
-            std::list<element> _elements;
-            std::list<std::string> _textnodes;
-
-        public:
-            typedef std::map<std::string, std::string> attribute_list;
-            typedef std::list<element> element_list;
-            typedef std::list<node> node_list;
-
-            typedef std::list<node>::iterator node_iterator;
-            typedef std::list<element>::iterator element_iterator;
-            typedef std::list<std::string>::iterator textnode_iterator;
-            typedef std::map<std::string, std::string>::iterator attribute_iterator;
-
-            template <typename ast_t>
-            void read(ast_t& ast)
-            {
-                _attributes.clear();
-                _elements.clear();
-                _textnodes.clear();
-
-                _name = get_string(ast[_0]);
-
-                auto& attlist_ast = ast[_1].matches;
-                for (auto attr = attlist_ast.begin(); attr != attlist_ast.end(); attr++)
-                {
-                    _attributes[get_string((*attr)[_0])] = qstring_value((*attr)[_1]);
-                }
-
-                auto& childlist_ast = ast[_3].matches;
-                for (auto it = childlist_ast.begin(); it != childlist_ast.end(); it++)
-                {
-                    auto& child = *it;
-                    if (child[_0].matched)
-                    {
-                        _elements.push_back(element());
-                        _elements.back().read(child[_0].get());
-                        _childnodes.push_back(node(&_elements.back()));
-                    }
-                    else if (child[_1].matched)
-                    {
-                        _textnodes.push_back(get_string(child[_1]));
-                        _childnodes.push_back(node(&_textnodes.back()));
-                    }
-                }
-            }
-
-            template <typename iterator_t>
-            void read(xml::reader::element<iterator_t>& e)
-            {
-                _attributes.clear();
-                _elements.clear();
-                _textnodes.clear();
-
-                _name = e.name();
-
-                xml::reader::attribute<iterator_t> attr = e.next_attribute();
-                for (; !attr.is_end(); 
-                    attr = attr.next_attribute())
-                {
-                    _attributes[attr.name()] = attr.value();
-                }
-
-                xml::reader::node<iterator_t> child = attr.next_child();
-                for (; !child.is_end();
-                    child = child.next_sibling())
-                {
-                    if (child.is_text())
-                    {
-                        _textnodes.push_back(child.text());
-                        _childnodes.push_back(node(&textnodes.back()));
-                    }
-                    else
-                    {
-                        assert(child.is_element());
-                        _elements.push_back(element());
-                        _elements.back().read(child.element());
-                        _childnodes.push_back(node(&elements.back()));
-                    }
-                }
-            }
-
-            // Returns the tag name of the element
-            std::string& name() { return _name; }
-
-            // Returns a string -> string map of attributes.
-            attribute_list& attributes() { return _attributes; }
-
-            // Returns a read-only list of child elements.
-            const element_list& elements() { return _elements; }
-
-            node_list& nodes() { return _childnodes; }
-
-            std::string text()
-            {
-                std::string s;
-                for (auto i = _textnodes.begin(); i != _textnodes.end(); i++)
-                {
-                    s += *i;
-                }
-                return s;
-            }
-        };
-
-        class document
-        {
-        public:
-            element root;
-
-            template <typename container_t>
-            document(container_t& c)
-            {
-                typedef typename unicode::unicode_container<container_t> unicode_container;
-	            typedef typename unicode_container::iterator iterator;
-            
-                unicode_container data(c);
-                parse::parser_ast<xml::grammar::document, iterator>::type ast;
-                
-                xml::grammar::document::parse_from(data.begin(), data.end(), ast);
-                root.read(ast[_0]);
-            }
-        };
-    }
-}
\ No newline at end of file
+#pragma once
+
+#include <stdint.h>
+#include <algorithm>
+#include <functional>
+#include <iterator>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+#include "reader.h"
+#include "name_table.h"
+#include "scan.h"
+#include "string_pool.h"
+
+namespace xml
+{
+    // This namespace contains an in-memory representation of an XML document
+    // (a DOM).  All of the nodes of a document are stored in one vector, and
+    // refer to each other by 32-bit indices (first child and next sibling),
+    // rather than pointers.  The attributes of an element are stored next to
+    // each other in a second vector, and all of the text (attribute values
+    // and text nodes) is stored in a single buffer.  This keeps a document in
+    // a handful of allocations, and traversals touch contiguous memory.
+    //
+    // The element, attribute and node classes are lightweight handles (a
+    // document pointer and an index) that are only valid while the document
+    // they came from exists.
+    //
+    // A document can also be loaded lazily (see load_mode), in which case 
+    // each element is only parsed when its attributes or children are first 
+    // accessed, or with repeated subtrees stored once.
+    namespace tree
+    {
+        class document;
+        class element;
+        class attribute;
+        class node;
+        class snapshot;
+
+        typedef uint32_t node_index;
+
+        // Index used for missing nodes (e.g., the first child of an empty
+        // element).
+        const node_index no_node = 0xFFFFFFFF;
+
+        // Offset and length of a string in a document's text buffer.  For a 
+        // string in the document's string_pool, the offset is its handle, 
+        // and the length has the pooled_string bit set.
+        struct string_span
+        {
+            uint32_t offset;
+            uint32_t length;
+        };
+
+        const uint32_t pooled_string = 0x80000000;
+
+        // A lazy element only has a name so far.  Its attributes and children 
+        // are added when they are first accessed, at which point it becomes 
+        // an element_node.
+        enum node_kind { element_node, text_node, lazy_element_node };
+
+        struct node_data
+        {
+            node_kind kind;
+            name_id name;
+            node_index first_child;
+            node_index next_sibling;
+
+            // Range of attributes for elements, or the string for text nodes.
+            // For lazy elements, this is the range of the element's source 
+            // following its name (up to the end of its close tag), in units 
+            // of the source container.  The length isn't known for the root.
+            uint32_t first;
+            uint32_t count;
+        };
+
+        enum load_mode
+        {
+            // The whole document is parsed up front.
+            load_eager,
+
+            // Only the names and positions of the root's children are found 
+            // up front (by skipping over their content, see xml::scan), and 
+            // each element is only parsed when its attributes or children are 
+            // first accessed.  The source container must outlive the 
+            // document, and documents loaded this way can't be used by 
+            // several threads at once (even for reading).
+            load_lazy,
+
+            // The same as load_eager, but the position of each element's 
+            // start tag, attribute and text node in the source is also 
+            // recorded (see source_span), so that an edited document can be 
+            // written by copying the parts of its source that weren't edited 
+            // (see xml::writer).  Only supported for UTF-8 and ISO-8859-1 
+            // sources in contiguous memory.
+            load_spans,
+
+            // The same as load_eager, but an element that is equal to one 
+            // parsed before it (i.e., that has the same name, the same 
+            // attributes in the same order, and equal children) shares that 
+            // element's attributes and descendants, rather than storing a 
+            // copy of them, so documents with many repeated fragments take 
+            // much less memory.  Equal elements are found by their hashes 
+            // (see document::compute_hashes(), which are computed while 
+            // parsing) and compared to confirm.  Documents loaded this way 
+            // can't be edited.  The nodes of a shared subtree are the same 
+            // nodes wherever it occurs, so their indices don't identify a 
+            // place in the document, and aren't in document order.
+            load_shared
+        };
+
+        // A range of bytes in the source of a document loaded with 
+        // load_spans, from the start of the container (including any BOM).  
+        // For an element, [first, last) is its start tag up to the end of 
+        // its last attribute (i.e., without the '>' or '/>' and any 
+        // whitespace before it), for an attribute, the attribute and the 
+        // whitespace before it, and for a text node, its text.  'end' is the 
+        // end of the whole node, i.e., of an element's close tag (and the 
+        // same as 'last' for the others).  Attributes that were added or 
+        // changed after loading have no source.
+        struct source_span
+        {
+            uint32_t first;
+            uint32_t last;
+            uint32_t end;
+        };
+
+        const uint32_t no_source = 0xFFFFFFFF;
+
+        struct attribute_data
+        {
+            name_id name;
+            string_span value;
+        };
+
+        // A vector that can also refer to an array that it doesn't own (a 
+        // section of a mapped snapshot, see xml::tree::snapshot), in which 
+        // case the array is copied the first time it is modified.  Only the 
+        // operations that document needs are defined.
+        template <typename T>
+        class mappable_vector
+        {
+            std::vector<T> owned;
+            const T* items;
+            size_t count;
+            bool mapped;
+
+            void update()
+            {
+                items = owned.data();
+                count = owned.size();
+            }
+
+            void own()
+            {
+                if (!mapped) return;
+                owned.assign(items, items + count);
+                mapped = false;
+                update();
+            }
+
+        public:
+            mappable_vector() : items(nullptr), count(0), mapped(false) {}
+
+            // Refers to an array, which must outlive this object (or the 
+            // next modification).
+            void map(const T* data, size_t size)
+            {
+                std::vector<T>().swap(owned);
+                items = data;
+                count = size;
+                mapped = true;
+            }
+
+            size_t size() const { return count; }
+            bool empty() const { return count == 0; }
+            const T* data() const { return items; }
+
+            const T& operator[] (size_t i) const { return items[i]; }
+
+            T& operator[] (size_t i)
+            {
+                own();
+                return owned[i];
+            }
+
+            void push_back(const T& value)
+            {
+                own();
+                owned.push_back(value);
+                update();
+            }
+
+            template <typename iterator_t>
+            void append(iterator_t first, iterator_t last)
+            {
+                own();
+                owned.insert(owned.end(), first, last);
+                update();
+            }
+
+            void resize(size_t size)
+            {
+                own();
+                owned.resize(size);
+                update();
+            }
+
+            void clear()
+            {
+                std::vector<T>().swap(owned);
+                mapped = false;
+                update();
+            }
+
+            void swap(mappable_vector& other)
+            {
+                owned.swap(other.owned);
+                std::swap(items, other.items);
+                std::swap(count, other.count);
+                std::swap(mapped, other.mapped);
+            }
+        };
+
+        // Iterator over a range of siblings, starting at a node and following
+        // the next_sibling links.  When elements_only is true, text nodes are
+        // skipped.
+        template <typename handle_t, bool elements_only>
+        class sibling_iterator : public std::iterator<std::forward_iterator_tag, handle_t>
+        {
+            const document* doc;
+            node_index index;
+
+            void skip();
+
+        public:
+            sibling_iterator() : doc(nullptr), index(no_node) {}
+
+            sibling_iterator(const document* d, node_index i) : doc(d), index(i)
+            {
+                skip();
+            }
+
+            handle_t operator* () const { return handle_t(doc, index); }
+
+            sibling_iterator& operator++ ();
+
+            sibling_iterator operator++ (int)
+            {
+                sibling_iterator temp(*this);
+                ++*this;
+                return temp;
+            }
+
+            bool operator== (const sibling_iterator& rhs) const { return index == rhs.index; }
+            bool operator!= (const sibling_iterator& rhs) const { return index != rhs.index; }
+        };
+
+        // Iterator over the attributes of an element, which are contiguous.
+        class attribute_iterator : public std::iterator<std::forward_iterator_tag, attribute>
+        {
+            const document* doc;
+            uint32_t index;
+
+        public:
+            attribute_iterator(const document* d, uint32_t i) : doc(d), index(i) {}
+
+            attribute operator* () const;
+
+            attribute_iterator& operator++ () { index++; return *this; }
+
+            attribute_iterator operator++ (int)
+            {
+                attribute_iterator temp(*this);
+                index++;
+                return temp;
+            }
+
+            bool operator== (const attribute_iterator& rhs) const { return index == rhs.index; }
+            bool operator!= (const attribute_iterator& rhs) const { return index != rhs.index; }
+        };
+
+        // A pair of iterators that can be used in a range-based for loop.
+        template <typename iterator_t>
+        class range
+        {
+            iterator_t b, e;
+
+        public:
+            range(const iterator_t& first, const iterator_t& last) : b(first), e(last) {}
+
+            iterator_t begin() const { return b; }
+            iterator_t end() const { return e; }
+            bool empty() const { return b == e; }
+        };
+
+        typedef sibling_iterator<node, false> node_iterator;
+        typedef sibling_iterator<element, true> element_iterator;
+        typedef range<node_iterator> node_list;
+        typedef range<element_iterator> element_list;
+        typedef range<attribute_iterator> attribute_list;
+
+        class attribute
+        {
+            const document* doc;
+            uint32_t index;
+
+        public:
+            attribute(const document* d, uint32_t i) : doc(d), index(i) {}
+
+            uint32_t get_index() const { return index; }
+
+            util::string_view name() const;
+            name_id id() const;
+            util::string_view value() const;
+        };
+
+        class element
+        {
+            const document* doc;
+            node_index index;
+
+            const node_data& data() const;
+
+        public:
+            element() : doc(nullptr), index(no_node) {}
+            element(const document* d, node_index i) : doc(d), index(i) {}
+
+            // Returns false for an element that doesn't exist (e.g., the
+            // result of a child() lookup that didn't find anything).
+            explicit operator bool() const { return index != no_node; }
+
+            node_index get_index() const { return index; }
+
+            const document* get_document() const { return doc; }
+
+            // Returns the tag name of the element
+            util::string_view name() const;
+
+            // Returns the ID of the element's tag name.
+            name_id id() const { return data().name; }
+
+            attribute_list attributes() const;
+
+            // Returns the value of the specified attribute, or an empty
+            // string if the element doesn't have it (see has_attribute).
+            util::string_view attribute(name_id id) const;
+            util::string_view attribute(const util::string_view& name) const;
+
+            bool has_attribute(name_id id) const;
+            bool has_attribute(const util::string_view& name) const;
+
+            // Returns the child elements.
+            element_list elements() const;
+
+            // Returns all of the child nodes (elements and text).
+            node_list nodes() const;
+
+            // Returns the first child element with the specified name, or an
+            // element that evaluates to false if there isn't one.
+            element child(name_id id) const;
+            element child(const util::string_view& name) const;
+
+            // Returns the concatenation of the element's text nodes.
+            std::string text() const;
+
+            // Returns the element's structural hash (see 
+            // document::compute_hashes(), which must have been called).
+            uint64_t hash() const;
+        };
+
+        // A child of an element, which is either an element or text.
+        class node
+        {
+            const document* doc;
+            node_index index;
+
+        public:
+            node(const document* d, node_index i) : doc(d), index(i) {}
+
+            node_index get_index() const { return index; }
+
+            bool is_element() const;
+            bool is_text() const;
+
+            // Only valid if is_element() returns true.
+            xml::tree::element element() const
+            {
+                assert(is_element());
+                return xml::tree::element(doc, index);
+            }
+
+            // Only valid if is_text() returns true.
+            util::string_view text() const;
+        };
+
+        class document
+        {
+            friend class element;
+            friend class attribute;
+            friend class node;
+            template <typename handle_t, bool elements_only> friend class sibling_iterator;
+            friend class attribute_iterator;
+            friend class snapshot;
+
+            std::shared_ptr<name_table> _names;
+
+            // The pool that short strings are kept in, if any (see 
+            // string_pool).
+            std::shared_ptr<string_pool> _pool;
+
+            mappable_vector<node_data> nodes;
+            mappable_vector<attribute_data> attributes;
+            mappable_vector<char> strings;
+
+            // The number of nodes, attributes and bytes of text in the 
+            // vectors above that are no longer part of the document (e.g., 
+            // the old attributes of an element that set_attribute() moved), 
+            // which size() and memory_size() don't count.
+            size_t orphaned_nodes;
+            size_t orphaned_attributes;
+            size_t orphaned_chars;
+
+            // For a document loaded from a snapshot, the mapped file that the 
+            // vectors above refer to (until they're modified).
+            std::shared_ptr<const void> mapping;
+
+            // True for documents loaded with load_spans.
+            bool spans;
+
+            // True if the source of a document loaded with load_spans is 
+            // ISO-8859-1, rather than UTF-8.
+            bool latin1;
+
+            // The source of each node and attribute (in the same order), and 
+            // the parent of each node, for documents loaded with load_spans.  
+            // So that an edit only moves the positions around it (see 
+            // reparse()), the positions are relative: a node's 'first' is 
+            // relative to its parent's (except for the root), its 'last' and 
+            // 'end' are relative to its own 'first', and an attribute's 
+            // positions are relative to its element's 'first'.  node_source() 
+            // and attribute_source() return positions in the whole source.
+            std::vector<source_span> node_sources;
+            std::vector<source_span> attribute_sources;
+            std::vector<node_index> node_parents;
+
+            // True for documents loaded with load_shared.
+            bool shared;
+
+            // A flag for each node, which is set when the node is edited 
+            // (for an element, when its attributes are), and the indices of 
+            // the edited nodes.  The flags are only allocated by the first 
+            // edit.
+            std::vector<bool> dirty;
+            std::vector<node_index> edited;
+
+            // The structural hash of each node, once compute_hashes() has 
+            // been called (until the document is edited), and always for 
+            // documents loaded with load_shared.
+            mappable_vector<uint64_t> hashes;
+
+            // Parses a lazy element (set when the document is loaded lazily).  
+            // The handles only have const access to the document, but 
+            // loading an element doesn't change the result of any accessor, 
+            // so this refers to a non-const document.
+            std::function<void(node_index)> load;
+
+            // Used while loading a document with load_shared: the hashes of 
+            // the names (by ID), and the elements that others are shared 
+            // with, by hash.
+            struct share_table
+            {
+                std::vector<uint64_t> name_hashes;
+                std::unordered_multimap<uint64_t, node_index> elements;
+            };
+
+            document(const document&);
+            document& operator= (const document&);
+
+            // Used by snapshot, which fills in the rest.
+            explicit document(const std::shared_ptr<name_table>& names) : _names(names), spans(false), latin1(false), shared(false), orphaned_nodes(0), orphaned_attributes(0), orphaned_chars(0) {}
+
+            // Copies a string into the text buffer, or finds it in the pool 
+            // if the document has one, and the string is short enough.
+            string_span copy_string(const util::string_view& s)
+            {
+                string_span span;
+                if (_pool && s.size() <= _pool->max_length())
+                {
+                    span.offset = _pool->intern(s);
+                    span.length = pooled_string | static_cast<uint32_t>(s.size());
+                    return span;
+                }
+
+                span.offset = static_cast<uint32_t>(strings.size());
+                strings.append(s.begin(), s.end());
+
+                if (strings.size() > 0xFFFFFFFF || s.size() >= pooled_string) throw std::exception("Document too large");
+                span.length = static_cast<uint32_t>(s.size());
+                return span;
+            }
+
+            template <typename string_t>
+            string_span add_string(const string_t& s)
+            {
+                if (s.has_bytes()) return copy_string(s.bytes());
+
+                std::string str = s.str();
+                return copy_string(util::string_view(str));
+            }
+
+            template <typename string_t>
+            name_id intern(const string_t& s)
+            {
+                return s.has_bytes() ? _names->intern(s.bytes()) : _names->intern(s.str());
+            }
+
+            // Appends a node to the document, and links it after 'prev' (the
+            // previous sibling), or as the first child of 'parent' if there
+            // isn't one.
+            node_index add_node(node_kind kind, node_index parent, node_index prev)
+            {
+                if (nodes.size() >= no_node) throw std::exception("Document too large");
+
+                node_data n;
+                n.kind = kind;
+                n.name = no_name;
+                n.first_child = n.next_sibling = no_node;
+                n.first = n.count = 0;
+
+                node_index index = static_cast<node_index>(nodes.size());
+                nodes.push_back(n);
+
+                if (spans)
+                {
+                    source_span none = { no_source, no_source, no_source };
+                    node_sources.push_back(none);
+                    node_parents.push_back(parent);
+                }
+
+                if (prev != no_node) nodes[prev].next_sibling = index;
+                else if (parent != no_node) nodes[parent].first_child = index;
+                return index;
+            }
+
+            template <typename string_t>
+            node_index add_text(const string_t& text, node_index parent, node_index prev)
+            {
+                string_span s = add_string(text);
+                node_index index = add_node(text_node, parent, prev);
+                nodes[index].first = s.offset;
+                nodes[index].count = s.length;
+                return index;
+            }
+
+            // Parses a document, adding each node as soon as it is matched.  
+            // The data is parsed one tag (or text node) at a time, in the 
+            // same way as the reader does, so only the small AST of the 
+            // current tag exists at any time, rather than the AST of the 
+            // whole document.  The ancestors of the current node are kept on 
+            // an explicit stack, along with their last child (to link the 
+            // next sibling to).  An element's attributes are added before any 
+            // of its children, so that they are contiguous.  With 
+            // 'record_spans', the source of each node and attribute is also 
+            // recorded, and with 'share', repeated elements are shared (see 
+            // load_shared).
+            template <typename unicode_container>
+            void build(unicode_container& data, bool record_spans, bool share = false)
+            {
+                typedef typename unicode_container::iterator iterator_t;
+                iterator_t it = data.begin(), end = data.end();
+
+                // The positions are offsets of bytes, which are the same for 
+                // both encodings.
+                if (record_spans && it != end && !it.has_ascii_bytes()) throw std::exception("Source spans require UTF-8 or ISO-8859-1 in contiguous memory");
+                spans = record_spans;
+                latin1 = record_spans && it != end && !it.has_bytes();
+
+                if (!grammar::prolog::parse_from(it, end)) throw parse_exception(it, end);
+
+                share_table table;
+                shared = share;
+                build_element(data, it, end, add_node(element_node, no_node, no_node), share ? &table : nullptr);
+            }
+
+            // Parses an element, from its start tag to the end of its close 
+            // tag, into an existing node (keeping its next sibling), and 
+            // adds its attributes and descendants (see build()).  With a 
+            // table, each element is shared with an equal one that was parsed 
+            // before it, if there is one, once it is complete.
+            template <typename unicode_container>
+            void build_element(unicode_container& data, typename unicode_container::iterator& it, 
+                typename unicode_container::iterator end, node_index index, share_table* table = nullptr)
+            {
+                using namespace xml::grammar;
+
+                typedef typename unicode_container::iterator iterator_t;
+                typedef decltype(lt >> grammar::name[_0]) open_tag;
+                typedef decltype((!ws >> grammar::name[_0] >> eq >> qstring()[_1]) | (!ws >> !fslash[_2] >> gt)) attribute_or_end;
+                typedef decltype((lt >> fslash >> grammar::name[_0] >> gt) | ((lt >> grammar::name[_1]) | comment() | textnode()[_2])) content;
+
+                struct open_element
+                {
+                    node_index index;
+                    node_index last_child;
+
+                    // The size of the text buffer before the element's start 
+                    // tag, to remove its text if it is shared.
+                    size_t first_char;
+                };
+
+                std::vector<open_element> stack;
+                enum { in_tag, in_content } state = in_tag;
+                size_t first_node = nodes.size();
+
+                iterator_t root_start = it;
+                typename parse::parser_ast<open_tag, iterator_t>::type root_ast;
+                if (!open_tag::parse_from(it, end, root_ast)) throw parse_exception(it, end);
+
+                open_element root = { index, no_node, strings.size() };
+                node_data& r = nodes[index];
+                r.kind = element_node;
+                r.name = intern(get_string(root_ast[_0]));
+                r.first_child = no_node;
+                r.first = static_cast<uint32_t>(attributes.size());
+                r.count = 0;
+                if (spans) node_sources[index].first = to_uint32(data.offset(root_start));
+                stack.push_back(root);
+
+                while (!stack.empty())
+                {
+                    open_element& top = stack.back();
+
+                    if (state == in_tag)
+                    {
+                        iterator_t start = it;
+                        typename parse::parser_ast<attribute_or_end, iterator_t>::type a;
+                        if (!attribute_or_end::parse_from(it, end, a)) throw parse_exception(it, end);
+
+                        if (a[_0].matched)
+                        {
+                            attribute_data attr;
+                            attr.name = intern(get_string(a[_0]));
+                            attr.value = add_string(qstring_value(a[_1]));
+                            attributes.push_back(attr);
+
+                            if (spans)
+                            {
+                                source_span source = { to_uint32(data.offset(start)), to_uint32(data.offset(it)), to_uint32(data.offset(it)) };
+                                attribute_sources.push_back(source);
+                            }
+                            continue;
+                        }
+
+                        node_data& n = nodes[top.index];
+                        n.count = static_cast<uint32_t>(attributes.size()) - n.first;
+                        if (spans) node_sources[top.index].last = to_uint32(data.offset(start));
+
+                        // Either way, the next thing is content (of this 
+                        // element, or of its parent if it is empty).
+                        if (a[_2].matched)
+                        {
+                            if (spans) node_sources[top.index].end = to_uint32(data.offset(it));
+                            if (table) share(top.index, top.first_char, *table);
+                            stack.pop_back();
+                        }
+                        state = in_content;
+                    }
+                    else
+                    {
+                        iterator_t start = it;
+                        typename parse::parser_ast<content, iterator_t>::type a;
+                        if (!content::parse_from(it, end, a)) throw parse_exception(it, end);
+
+                        // An empty match means that only the (empty) text 
+                        // node matched, e.g., at a truncated close tag.  This 
+                        // is checked first, since the captures of a partially 
+                        // matched alternative may also be set.
+                        if (it == start) throw parse_exception(it, end);
+
+                        if (a[_0].matched)
+                        {
+                            if (spans) node_sources[top.index].end = to_uint32(data.offset(it));
+                            if (table) share(top.index, top.first_char, *table);
+                            stack.pop_back();
+                        }
+                        else if (a[_1].matched)
+                        {
+                            open_element child = { add_node(element_node, top.index, top.last_child), no_node, strings.size() };
+                            top.last_child = child.index;
+                            nodes[child.index].name = intern(get_string(a[_1]));
+                            nodes[child.index].first = static_cast<uint32_t>(attributes.size());
+                            if (spans) node_sources[child.index].first = to_uint32(data.offset(start));
+                            stack.push_back(child);
+                            state = in_tag;
+                        }
+                        else if (a[_2].matched)
+                        {
+                            top.last_child = add_text(get_string(a[_2]), top.index, top.last_child);
+                            if (spans)
+                            {
+                                source_span source = { to_uint32(data.offset(start)), to_uint32(data.offset(it)), to_uint32(data.offset(it)) };
+                                node_sources[top.last_child] = source;
+                            }
+                        }
+                        // else it's a comment, which is skipped
+                    }
+                }
+
+                if (spans) make_relative(index, first_node);
+            }
+
+            // Converts the positions recorded by build_element() (which are 
+            // offsets in the whole source) to relative ones (see 
+            // node_sources), given the element that was built, and the first 
+            // node that was added for it.  A parent always comes before its 
+            // children, so going backwards, each node's parent still has its 
+            // offset in the whole source.
+            void make_relative(node_index index, size_t first_node)
+            {
+                for (size_t i = nodes.size(); i-- > first_node; ) make_relative(static_cast<node_index>(i), node_sources[node_parents[i]].first);
+
+                node_index parent = node_parents[index];
+                make_relative(index, parent == no_node ? 0 : source_first(parent));
+            }
+
+            void make_relative(node_index index, uint32_t parent_first)
+            {
+                source_span& s = node_sources[index];
+                if (nodes[index].kind != text_node)
+                {
+                    const node_data& n = nodes[index];
+                    for (uint32_t i = n.first; i < n.first + n.count; i++)
+                    {
+                        source_span& a = attribute_sources[i];
+                        a.first -= s.first;
+                        a.last -= s.first;
+                        a.end -= s.first;
+                    }
+                }
+
+                s.last -= s.first;
+                s.end -= s.first;
+                s.first -= parent_first;
+            }
+
+            // Returns the offset of a node's source in the whole source.
+            uint32_t source_first(node_index index) const
+            {
+                uint32_t first = 0;
+                for (; index != no_node; index = node_parents[index]) first += node_sources[index].first;
+                return first;
+            }
+
+            // Parses the attributes and children of a lazy element, from the 
+            // end of its name to the end of its close tag.  Child elements 
+            // are added as lazy elements, and skipped with xml::scan.
+            template <typename unicode_container>
+            void load_element(unicode_container& data, node_index index)
+            {
+                using namespace xml::grammar;
+
+                typedef typename unicode_container::iterator iterator_t;
+                typedef decltype((!ws >> grammar::name[_0] >> eq >> qstring()[_1]) | (!ws >> !fslash[_2] >> gt)) attribute_or_end;
+                typedef decltype((lt >> fslash >> grammar::name[_0] >> gt) | ((lt >> grammar::name[_1]) | comment() | textnode()[_2])) content;
+
+                assert(nodes[index].kind == lazy_element_node);
+                iterator_t it = data.at(nodes[index].first), end = data.end();
+
+                uint32_t first_attribute = static_cast<uint32_t>(attributes.size());
+                bool empty = false;
+
+                while (true)
+                {
+                    typename parse::parser_ast<attribute_or_end, iterator_t>::type a;
+                    if (!attribute_or_end::parse_from(it, end, a)) throw parse_exception(it, end);
+
+                    if (!a[_0].matched)
+                    {
+                        empty = a[_2].matched;
+                        break;
+                    }
+
+                    attribute_data attr;
+                    attr.name = intern(get_string(a[_0]));
+                    attr.value = add_string(qstring_value(a[_1]));
+                    attributes.push_back(attr);
+                }
+
+                node_index prev = no_node;
+                while (!empty)
+                {
+                    iterator_t start = it;
+                    typename parse::parser_ast<content, iterator_t>::type a;
+                    if (!content::parse_from(it, end, a)) throw parse_exception(it, end);
+
+                    // See build()
+                    if (it == start) throw parse_exception(it, end);
+
+                    if (a[_0].matched)
+                    {
+                        break;
+                    }
+                    else if (a[_1].matched)
+                    {
+                        node_index child = add_node(lazy_element_node, index, prev);
+                        nodes[child].name = intern(get_string(a[_1]));
+
+                        size_t offset = data.offset(it);
+                        if (!scan::skip_element(it, end)) throw parse_exception(it, end);
+
+                        nodes[child].first = to_uint32(offset);
+                        nodes[child].count = to_uint32(data.offset(it) - offset);
+                        prev = child;
+                    }
+                    else if (a[_2].matched)
+                    {
+                        prev = add_text(get_string(a[_2]), index, prev);
+                    }
+                }
+
+                node_data& n = nodes[index];
+                n.kind = element_node;
+                n.first = first_attribute;
+                n.count = static_cast<uint32_t>(attributes.size()) - first_attribute;
+            }
+
+            template <typename unicode_container>
+            void build_lazy(const std::shared_ptr<unicode_container>& data)
+            {
+                typedef typename unicode_container::iterator iterator_t;
+                typedef decltype(grammar::lt >> grammar::name[_0]) open_tag;
+
+                iterator_t it = data->begin(), end = data->end();
+                if (!grammar::prolog::parse_from(it, end)) throw parse_exception(it, end);
+
+                typename parse::parser_ast<open_tag, iterator_t>::type root_ast;
+                if (!open_tag::parse_from(it, end, root_ast)) throw parse_exception(it, end);
+
+                node_index root = add_node(lazy_element_node, no_node, no_node);
+                nodes[root].name = intern(get_string(root_ast[_0]));
+                nodes[root].first = to_uint32(data->offset(it));
+
+                load = [this, data](node_index index) { load_element(*data, index); };
+                load_element(*data, root);
+            }
+
+            // Makes sure that an element's attributes and children are 
+            // available.  Loading an element interns the names in its 
+            // content, so lookups by string (e.g., element::attribute()) 
+            // must expand the element before they look up the name, or 
+            // they'd miss names that are only used in it.
+            void expand(node_index index) const
+            {
+                if (nodes[index].kind == lazy_element_node) load(index);
+            }
+
+            static uint32_t to_uint32(size_t n)
+            {
+                if (n > 0xFFFFFFFF) throw std::exception("Document too large");
+                return static_cast<uint32_t>(n);
+            }
+
+            void mark_dirty(node_index index)
+            {
+                hashes.clear();
+                if (dirty.size() < nodes.size()) dirty.resize(nodes.size());
+                if (dirty[index]) return;
+
+                dirty[index] = true;
+                edited.push_back(index);
+            }
+
+            // Counts a string that is no longer used (see orphaned_chars).
+            void orphan_string(const string_span& s)
+            {
+                if (!(s.length & pooled_string)) orphaned_chars += s.length;
+            }
+
+            // Counts an attribute that is no longer used, and clears its 
+            // value, whose text may be reused (see reclaim()).
+            void orphan_attribute(uint32_t index)
+            {
+                string_span empty = { 0, 0 };
+                attributes[index].value = empty;
+                orphaned_attributes++;
+            }
+
+            // Clears the dirty flags of a list of siblings and their 
+            // descendants.
+            void clear_dirty(node_index first)
+            {
+                for (node_index i = first; i != no_node; i = nodes[i].next_sibling)
+                {
+                    if (i < dirty.size()) dirty[i] = false;
+                    if (nodes[i].kind != text_node) clear_dirty(nodes[i].first_child);
+                }
+            }
+
+            // Returns true if an edit of the source is within an element, 
+            // i.e., after its '<' and before the end of its close tag, given 
+            // the offset of the element in the whole source.
+            bool contains(node_index index, size_t first, size_t offset, size_t removed) const
+            {
+                const source_span& s = node_sources[index];
+                return s.first != no_source && first < offset && offset + removed < first + s.end;
+            }
+
+            // Moves a position after an edit (see reparse()).
+            static void move(uint32_t& position, size_t removed, size_t inserted)
+            {
+                position = to_uint32(position + inserted - removed);
+            }
+
+            // Combines a hash with another (in an order-dependent way).
+            static uint64_t combine(uint64_t h, uint64_t value)
+            {
+                value *= 0xFF51AFD7ED558CCDULL;
+                value ^= value >> 33;
+                return (h ^ value) * 0x9E3779B97F4A7C15ULL + 0x632BE59BD9B4E019ULL;
+            }
+
+            // Returns the hash of a name, extending the hashes of the names 
+            // (by ID) as needed.
+            uint64_t name_hash(std::vector<uint64_t>& name_hashes, name_id name) const
+            {
+                while (name_hashes.size() <= name)
+                {
+                    util::string_view s = _names->name(static_cast<name_id>(name_hashes.size()));
+                    name_hashes.push_back(util::hash_bytes64(s.data(), s.size()));
+                }
+                return name_hashes[name];
+            }
+
+            // Returns the hash of a node (see compute_hashes()), given those 
+            // of its children.
+            uint64_t hash_node(node_index index, std::vector<uint64_t>& name_hashes) const
+            {
+                const node_data& n = nodes[index];
+                if (n.kind == text_node)
+                {
+                    string_span s = { n.first, n.count };
+                    util::string_view text = view(s);
+                    return combine(1, util::hash_bytes64(text.data(), text.size()));
+                }
+
+                // The attributes' hashes are added, so that their order 
+                // doesn't matter.
+                uint64_t attribute_hashes = 0;
+                for (uint32_t a = n.first; a < n.first + n.count; a++)
+                {
+                    util::string_view value = view(attributes[a].value);
+                    attribute_hashes += combine(name_hash(name_hashes, attributes[a].name), util::hash_bytes64(value.data(), value.size()));
+                }
+
+                uint64_t h = combine(combine(2, name_hash(name_hashes, n.name)), attribute_hashes);
+                for (node_index child = n.first_child; child != no_node; child = nodes[child].next_sibling)
+                {
+                    h = combine(h, hashes[child]);
+                }
+                return h;
+            }
+
+            // Returns true if two elements of a document loaded with 
+            // load_shared are equal (see load_shared).  Their children have 
+            // already been shared, so equal child elements refer to the same 
+            // attributes and children, and don't need to be compared deeply.
+            bool is_equal(node_index a, node_index b) const
+            {
+                const node_data& x = nodes[a];
+                const node_data& y = nodes[b];
+                if (x.name != y.name || x.count != y.count) return false;
+
+                for (uint32_t i = 0; i < x.count; i++)
+                {
+                    const attribute_data& p = attributes[x.first + i];
+                    const attribute_data& q = attributes[y.first + i];
+                    if (p.name != q.name || view(p.value) != view(q.value)) return false;
+                }
+
+                node_index i = x.first_child, j = y.first_child;
+                for (; i != no_node && j != no_node; i = nodes[i].next_sibling, j = nodes[j].next_sibling)
+                {
+                    const node_data& c = nodes[i];
+                    const node_data& d = nodes[j];
+                    if (c.kind != d.kind || hashes[i] != hashes[j]) return false;
+
+                    if (c.kind == text_node)
+                    {
+                        string_span s = { c.first, c.count }, t = { d.first, d.count };
+                        if (view(s) != view(t)) return false;
+                    }
+                    else if (c.name != d.name || c.first_child != d.first_child || c.count != d.count || (c.count != 0 && c.first != d.first))
+                    {
+                        return false;
+                    }
+                }
+                return i == j;
+            }
+
+            // Called when an element of a document loaded with load_shared 
+            // is complete.  Its descendants (and their attributes and text) 
+            // are the last ones in the arrays, and if an equal element was 
+            // parsed before, they are removed, and the element refers to the 
+            // attributes and children of that one instead.
+            void share(node_index index, size_t first_char, share_table& table)
+            {
+                // The text children are hashed here, and the element 
+                // children were hashed when they were complete.
+                hashes.resize(nodes.size());
+                for (node_index child = nodes[index].first_child; child != no_node; child = nodes[child].next_sibling)
+                {
+                    if (nodes[child].kind == text_node) hashes[child] = hash_node(child, table.name_hashes);
+                }
+
+                uint64_t h = hash_node(index, table.name_hashes);
+                hashes[index] = h;
+
+                auto range = table.elements.equal_range(h);
+                for (auto it = range.first; it != range.second; ++it)
+                {
+                    if (!is_equal(it->second, index)) continue;
+
+                    node_data other = nodes[it->second];
+                    attributes.resize(nodes[index].first);
+                    strings.resize(first_char);
+                    nodes.resize(index + 1);
+                    hashes.resize(index + 1);
+
+                    node_data& n = nodes[index];
+                    n.first_child = other.first_child;
+                    n.first = other.first;
+                    n.count = other.count;
+                    return;
+                }
+                table.elements.insert(std::make_pair(h, index));
+            }
+
+            void check_editable() const
+            {
+                if (shared) throw std::exception("Documents loaded with load_shared can't be edited");
+            }
+
+            static void expand_all(const xml::tree::element& e)
+            {
+                for (auto child : e.elements()) expand_all(child);
+            }
+
+            // The part of one of the document's vectors that an element's old 
+            // content took (see reclaim()), and the number of items in it 
+            // that were part of the old content.
+            struct old_range
+            {
+                size_t first, last, count;
+
+                old_range() : first(0), last(0), count(0) {}
+
+                void add(size_t index, size_t n)
+                {
+                    if (n == 0) return;
+                    if (count == 0 || index < first) first = index;
+                    if (index + n > last) last = index + n;
+                    count += n;
+                }
+
+                // Returns true if the old content took all of the range.
+                bool is_whole() const { return count != 0 && count == last - first; }
+            };
+
+            struct old_content
+            {
+                old_range nodes, attributes, strings;
+            };
+
+            static void add_old_string(const string_span& s, old_content& c)
+            {
+                if (!(s.length & pooled_string)) c.strings.add(s.offset, s.length);
+            }
+
+            // Adds an element's attributes to its old content, and clears 
+            // them.
+            void add_old_attributes(const node_data& n, old_content& c)
+            {
+                c.attributes.add(n.first, n.count);
+                for (uint32_t i = n.first; i < n.first + n.count; i++)
+                {
+                    string_span empty = { 0, 0 };
+                    add_old_string(attributes[i].value, c);
+                    attributes[i].value = empty;
+                }
+            }
+
+            // Adds a list of siblings and their descendants to an element's 
+            // old content, and turns them into empty text nodes, so that 
+            // they don't refer to anything that may be reused.
+            void add_old_nodes(node_index first, old_content& c)
+            {
+                for (node_index i = first; i != no_node; )
+                {
+                    node_data n = nodes[i];
+                    c.nodes.add(i, 1);
+                    if (n.kind == text_node)
+                    {
+                        string_span s = { n.first, n.count };
+                        add_old_string(s, c);
+                    }
+                    else
+                    {
+                        add_old_attributes(n, c);
+                        add_old_nodes(n.first_child, c);
+                    }
+
+                    node_data& orphan = nodes[i];
+                    orphan.kind = text_node;
+                    orphan.name = no_name;
+                    orphan.first_child = orphan.next_sibling = no_node;
+                    orphan.first = orphan.count = 0;
+                    i = n.next_sibling;
+                }
+            }
+
+            // Returns where the items that were added to one of the 
+            // document's vectors (from 'first' to 'size') should go, given 
+            // the range of the old content, and sets 'size' to the size that 
+            // the vector should have afterwards.  The old range is reused if 
+            // the old content took all of it, and the new items fit in it, or 
+            // it is at the end of the vector (e.g., when the same element is 
+            // parsed again repeatedly).  Otherwise, the old items are counted 
+            // as orphaned.
+            static size_t reuse(const old_range& old, size_t first, size_t& size, size_t& orphaned)
+            {
+                size_t count = size - first;
+                if (old.is_whole() && old.last == first)
+                {
+                    size = old.first + count;
+                    return old.first;
+                }
+
+                if (old.is_whole() && count <= old.last - old.first)
+                {
+                    orphaned += old.last - old.first - count;
+                    size = first;
+                    return old.first;
+                }
+
+                orphaned += old.count;
+                return first;
+            }
+
+            // Moves the items of a vector from 'from' to its end down to 
+            // 'to', and resizes it.
+            template <typename vector_t>
+            static void move_down(vector_t& v, size_t from, size_t to, size_t size)
+            {
+                if (from != to)
+                {
+                    for (size_t i = from; i < v.size(); i++) v[to + i - from] = v[i];
+                }
+                v.resize(size);
+            }
+
+            static void shift(uint32_t& index, size_t from, size_t distance)
+            {
+                if (index != no_node && index >= from) index = static_cast<uint32_t>(index - distance);
+            }
+
+            // Moves the new content of an element that was parsed again (its 
+            // attributes and descendants, and their text, which were added at 
+            // the end of each vector) into the place of its old content, 
+            // where possible (see reuse()), given the old element and the 
+            // size of each vector before parsing.  The new nodes keep their 
+            // order, so a parent still comes before its children.
+            void reclaim(node_index index, const node_data& old, size_t first_node, size_t first_attribute, size_t first_char)
+            {
+                old_content c;
+                add_old_attributes(old, c);
+                add_old_nodes(old.first_child, c);
+
+                size_t node_size = nodes.size(), attribute_size = attributes.size(), char_size = strings.size();
+                size_t node_to = reuse(c.nodes, first_node, node_size, orphaned_nodes);
+                size_t attribute_to = reuse(c.attributes, first_attribute, attribute_size, orphaned_attributes);
+                size_t char_to = reuse(c.strings, first_char, char_size, orphaned_chars);
+
+                size_t node_distance = first_node - node_to;
+                size_t attribute_distance = first_attribute - attribute_to;
+                size_t char_distance = first_char - char_to;
+
+                shift(nodes[index].first_child, first_node, node_distance);
+                nodes[index].first = static_cast<uint32_t>(nodes[index].first - attribute_distance);
+                for (size_t i = first_node; i < nodes.size(); i++)
+                {
+                    node_data& n = nodes[i];
+                    shift(n.first_child, first_node, node_distance);
+                    shift(n.next_sibling, first_node, node_distance);
+                    shift(node_parents[i], first_node, node_distance);
+
+                    if (n.kind != text_node)
+                        n.first = static_cast<uint32_t>(n.first - attribute_distance);
+                    else if (!(n.count & pooled_string))
+                        n.first = static_cast<uint32_t>(n.first - char_distance);
+                }
+
+                for (size_t i = first_attribute; i < attributes.size(); i++)
+                {
+                    string_span& value = attributes[i].value;
+                    if (!(value.length & pooled_string)) value.offset = static_cast<uint32_t>(value.offset - char_distance);
+                }
+
+                move_down(nodes, first_node, node_to, node_size);
+                move_down(node_sources, first_node, node_to, node_size);
+                move_down(node_parents, first_node, node_to, node_size);
+                move_down(attributes, first_attribute, attribute_to, attribute_size);
+                move_down(attribute_sources, first_attribute, attribute_to, attribute_size);
+                move_down(strings, first_char, char_to, char_size);
+                compact();
+            }
+
+            // Copies a string (unless it is pooled) to the end of another 
+            // text buffer (see compact()).
+            void copy_string_to(string_span& s, mappable_vector<char>& to) const
+            {
+                if (s.length & pooled_string) return;
+
+                const char* p = s.length == 0 ? nullptr : &strings[s.offset];
+                s.offset = static_cast<uint32_t>(to.size());
+                to.append(p, p + s.length);
+            }
+
+            // Copies the attributes and text that are still used to new 
+            // vectors, once the orphaned ones take more space than they do, 
+            // so the time this takes is proportional to the size of the edits 
+            // that orphaned them.  The nodes keep their indices (and only 
+            // documents loaded with load_spans, which have no lazy elements, 
+            // are compacted).
+            void compact()
+            {
+                if (orphaned_attributes * 2 <= attributes.size() && orphaned_chars * 2 <= strings.size()) return;
+
+                mappable_vector<attribute_data> new_attributes;
+                std::vector<source_span> new_sources;
+                mappable_vector<char> new_strings;
+                for (size_t i = 0; i < nodes.size(); i++)
+                {
+                    node_data& n = nodes[i];
+                    if (n.kind == text_node)
+                    {
+                        string_span s = { n.first, n.count };
+                        copy_string_to(s, new_strings);
+                        n.first = s.offset;
+                        continue;
+                    }
+
+                    uint32_t first = static_cast<uint32_t>(new_attributes.size());
+                    for (uint32_t j = n.first; j < n.first + n.count; j++)
+                    {
+                        attribute_data a = attributes[j];
+                        copy_string_to(a.value, new_strings);
+                        new_attributes.push_back(a);
+                        new_sources.push_back(attribute_sources[j]);
+                    }
+                    n.first = first;
+                }
+
+                attributes.swap(new_attributes);
+                attribute_sources.swap(new_sources);
+                strings.swap(new_strings);
+                orphaned_attributes = orphaned_chars = 0;
+            }
+
+            // Parses an element again after an edit within it (see 
+            // reparse()), given its offset in the whole source.  Returns 
+            // false, without changing anything, if the element isn't well 
+            // formed, or doesn't end where its close tag now is (e.g., if the 
+            // edit added or removed a tag).
+            template <typename unicode_container>
+            bool reparse_element(unicode_container& data, node_index index, size_t first, size_t removed, size_t inserted)
+            {
+                node_data old = nodes[index];
+                source_span old_source = node_sources[index];
+                size_t new_end = first + old_source.end - removed + inserted;
+                size_t first_node = nodes.size();
+                size_t first_attribute = attributes.size();
+                size_t first_char = strings.size();
+
+                bool parsed;
+                try
+                {
+                    typename unicode_container::iterator it = data.at(first);
+                    build_element(data, it, data.end(), index);
+                    parsed = data.offset(it) == new_end;
+                }
+                catch (const parse_exception&)
+                {
+                    parsed = false;
+                }
+
+                if (!parsed)
+                {
+                    nodes.resize(first_node);
+                    attributes.resize(first_attribute);
+                    strings.resize(first_char);
+                    node_sources.resize(first_node);
+                    attribute_sources.resize(first_attribute);
+                    node_parents.resize(first_node);
+                    nodes[index] = old;
+                    node_sources[index] = old_source;
+                    return false;
+                }
+
+                // The positions after the element move, but since they're 
+                // relative (see node_sources), only those of the siblings 
+                // that follow the element and its ancestors, and the ends of 
+                // its ancestors, change.
+                for (node_index i = index; i != no_node; i = node_parents[i])
+                {
+                    for (node_index j = nodes[i].next_sibling; j != no_node; j = nodes[j].next_sibling) move(node_sources[j].first, removed, inserted);
+                    if (node_parents[i] != no_node) move(node_sources[node_parents[i]].end, removed, inserted);
+                }
+                hashes.clear();
+
+                // The element now matches its source, and its old 
+                // descendants are no longer part of the document.
+                if (!edited.empty())
+                {
+                    if (index < dirty.size()) dirty[index] = false;
+                    clear_dirty(old.first_child);
+
+                    std::vector<node_index> still_edited;
+                    for (auto i : edited)
+                    {
+                        if (dirty[i]) still_edited.push_back(i);
+                    }
+                    edited.swap(still_edited);
+                }
+
+                reclaim(index, old, first_node, first_attribute, first_char);
+                return true;
+            }
+
+            template <typename iterator_t>
+            node_index read(xml::reader::element<iterator_t>& e, node_index parent, node_index prev)
+            {
+                node_index index = add_node(element_node, parent, prev);
+                nodes[index].name = intern(e.name());
+                nodes[index].first = static_cast<uint32_t>(attributes.size());
+
+                xml::reader::attribute<iterator_t> attr = e.next_attribute();
+                for (; !attr.is_end();
+                    attr = attr.next_attribute())
+                {
+                    attribute_data a;
+                    a.name = intern(attr.name());
+                    a.value = add_string(attr.value());
+                    attributes.push_back(a);
+                }
+                nodes[index].count = static_cast<uint32_t>(attributes.size()) - nodes[index].first;
+
+                node_index child_prev = no_node;
+                xml::reader::node<iterator_t> child = attr.next_child();
+                for (; !child.is_end();
+                    child = child.next_sibling())
+                {
+                    if (child.is_text())
+                    {
+                        child_prev = add_text(child.text(), index, child_prev);
+                    }
+                    else
+                    {
+                        assert(child.is_element());
+                        xml::reader::element<iterator_t> child_element = child.element();
+                        child_prev = read(child_element, index, child_prev);
+                    }
+                }
+                return index;
+            }
+
+        public:
+            // Names are interned in a new table, unless one is specified
+            // (e.g., to share names, and their IDs, with other documents).  
+            // With a string pool, the attribute values and text nodes that 
+            // aren't longer than its max_length() are kept in the pool 
+            // rather than in the document (e.g., to share them with other 
+            // documents).
+            template <typename container_t>
+            document(container_t& c, const std::shared_ptr<name_table>& names = std::make_shared<name_table>(),
+                const std::shared_ptr<string_pool>& pool = std::shared_ptr<string_pool>())
+                : _names(names), _pool(pool), spans(false), latin1(false), shared(false), orphaned_nodes(0), orphaned_attributes(0), orphaned_chars(0)
+            {
+                typedef typename unicode::unicode_container<container_t> unicode_container;
+
+                unicode_container data(c);
+                build(data, false);
+            }
+
+            template <typename container_t>
+            document(container_t& c, load_mode mode, const std::shared_ptr<name_table>& names = std::make_shared<name_table>(),
+                const std::shared_ptr<string_pool>& pool = std::shared_ptr<string_pool>())
+                : _names(names), _pool(pool), spans(false), latin1(false), shared(false), orphaned_nodes(0), orphaned_attributes(0), orphaned_chars(0)
+            {
+                typedef typename unicode::unicode_container<container_t> unicode_container;
+
+                if (mode == load_lazy)
+                {
+                    build_lazy(std::make_shared<unicode_container>(c));
+                }
+                else
+                {
+                    unicode_container data(c);
+                    build(data, mode == load_spans, mode == load_shared);
+                }
+            }
+
+            // Builds a document from an element of a reader.
+            template <typename iterator_t>
+            explicit document(xml::reader::element<iterator_t>& e, const std::shared_ptr<name_table>& names = std::make_shared<name_table>(),
+                const std::shared_ptr<string_pool>& pool = std::shared_ptr<string_pool>())
+                : _names(names), _pool(pool), spans(false), latin1(false), shared(false), orphaned_nodes(0), orphaned_attributes(0), orphaned_chars(0)
+            {
+                read(e, no_node, no_node);
+            }
+
+            xml::tree::element root() const
+            {
+                return xml::tree::element(this, nodes.empty() ? no_node : 0);
+            }
+
+            name_table& names() const { return *_names; }
+
+            const std::shared_ptr<name_table>& shared_names() const { return _names; }
+
+            // Returns the document's string pool, which is empty if it 
+            // doesn't have one.
+            const std::shared_ptr<string_pool>& pool() const { return _pool; }
+
+            // Returns the number of nodes (elements and text) in the document.
+            size_t size() const { return nodes.size() - orphaned_nodes; }
+
+            // Returns the number of bytes used by the document's nodes, 
+            // attributes, text and hashes (but not by its names or pooled 
+            // strings, which may be shared with other documents).
+            size_t memory_size() const
+            {
+                return size() * sizeof(node_data) + (attributes.size() - orphaned_attributes) * sizeof(attribute_data) + 
+                    strings.size() - orphaned_chars + (has_hashes() ? size() * sizeof(uint64_t) : 0);
+            }
+
+            // Sets the value of an element's attribute, adding the attribute 
+            // if the element doesn't have it.  Like the values read from the 
+            // source (in which references aren't replaced), the value is 
+            // stored and written as it is, so it must already be escaped.
+            void set_attribute(const xml::tree::element& e, name_id name, const util::string_view& value)
+            {
+                check_editable();
+                node_index index = e.get_index();
+                expand(index);
+                mark_dirty(index);
+
+                string_span s = copy_string(value);
+                node_data& n = nodes[index];
+                for (uint32_t i = n.first; i < n.first + n.count; i++)
+                {
+                    if (attributes[i].name != name) continue;
+
+                    orphan_string(attributes[i].value);
+                    attributes[i].value = s;
+                    if (spans) attribute_sources[i].first = attribute_sources[i].last = attribute_sources[i].end = no_source;
+                    return;
+                }
+
+                // The attributes of an element must be contiguous, so unless 
+                // they are the last ones, they are moved to the end first.
+                if (n.first + n.count != attributes.size())
+                {
+                    uint32_t first = to_uint32(attributes.size());
+                    for (uint32_t i = 0; i < n.count; i++)
+                    {
+                        attribute_data a = attributes[n.first + i];
+                        attributes.push_back(a);
+                        orphan_attribute(n.first + i);
+                        if (spans)
+                        {
+                            source_span source = attribute_sources[n.first + i];
+                            attribute_sources.push_back(source);
+                        }
+                    }
+                    n.first = first;
+                }
+
+                attribute_data a = { name, s };
+                attributes.push_back(a);
+                if (spans)
+                {
+                    source_span none = { no_source, no_source, no_source };
+                    attribute_sources.push_back(none);
+                }
+                n.count++;
+            }
+
+            void set_attribute(const xml::tree::element& e, const util::string_view& name, const util::string_view& value)
+            {
+                set_attribute(e, _names->intern(name), value);
+            }
+
+            // Removes an attribute, and returns false if the element doesn't 
+            // have it.
+            bool remove_attribute(const xml::tree::element& e, name_id name)
+            {
+                check_editable();
+                node_index index = e.get_index();
+                expand(index);
+
+                node_data& n = nodes[index];
+                for (uint32_t i = n.first; i < n.first + n.count; i++)
+                {
+                    if (attributes[i].name != name) continue;
+
+                    orphan_string(attributes[i].value);
+                    for (uint32_t j = i + 1; j < n.first + n.count; j++)
+                    {
+                        attributes[j - 1] = attributes[j];
+                        if (spans) attribute_sources[j - 1] = attribute_sources[j];
+                    }
+                    n.count--;
+                    orphan_attribute(n.first + n.count);
+                    mark_dirty(index);
+                    return true;
+                }
+                return false;
+            }
+
+            // Replaces the text of a text node (which must already be 
+            // escaped, see set_attribute()).
+            void set_text(const xml::tree::node& t, const util::string_view& text)
+            {
+                assert(t.is_text());
+                check_editable();
+
+                string_span s = copy_string(text);
+                string_span old = { nodes[t.get_index()].first, nodes[t.get_index()].count };
+                orphan_string(old);
+                nodes[t.get_index()].first = s.offset;
+                nodes[t.get_index()].count = s.length;
+                mark_dirty(t.get_index());
+            }
+
+            // Returns true if the document was loaded with load_spans.
+            bool has_sources() const { return spans; }
+
+            // Returns true if the document was loaded with load_spans from an 
+            // ISO-8859-1 source (in which case xml::writer converts the parts 
+            // that it writes from the document to ISO-8859-1).
+            bool has_latin1_source() const { return latin1; }
+
+            // Return the source of a node, or of one of an element's 
+            // attributes (given their indices), as offsets in the whole 
+            // source.  Only valid if has_sources() returns true.
+            source_span node_source(node_index index) const
+            {
+                uint32_t first = source_first(index);
+                const source_span& s = node_sources[index];
+                source_span result = { first, first + s.last, first + s.end };
+                return result;
+            }
+
+            source_span attribute_source(node_index element, uint32_t index) const
+            {
+                source_span result = attribute_sources[index];
+                if (result.first == no_source) return result;
+
+                uint32_t first = source_first(element);
+                result.first += first;
+                result.last += first;
+                result.end += first;
+                return result;
+            }
+
+            bool is_dirty(node_index index) const { return index < dirty.size() && dirty[index]; }
+
+            // Updates a document that was loaded with load_spans after an 
+            // edit of its source, in which the 'removed' bytes at 'offset' 
+            // were replaced with 'inserted' bytes, given the whole edited 
+            // source.  Only the smallest element that contains the edit, and 
+            // is still well formed, is parsed again (keeping its index), and 
+            // only the positions of the siblings that follow it and its 
+            // ancestors are moved (see node_sources), so the time taken 
+            // depends on the size of that element rather than that of the 
+            // document.  If no element qualifies (e.g., for an edit 
+            // outside the root element), the whole document is parsed again, 
+            // and if that fails, its exception is thrown and the document 
+            // doesn't change.  Returns the index of the element that was 
+            // parsed again.
+            //
+            // The element's new attributes and descendants take the place of 
+            // its old ones where they fit (see reclaim()).  Otherwise, the 
+            // old nodes are left unused until the document is loaded again 
+            // (size() and memory_size() don't count them), and the old 
+            // attributes and text are reclaimed once they take more space 
+            // than the rest (see compact()), which may move any attribute.  
+            // Either way, the indices of the element's descendants change, 
+            // and edits of them made with set_attribute(), etc. are lost.
+            template <typename container_t>
+            node_index reparse(container_t& c, size_t offset, size_t removed, size_t inserted)
+            {
+                typedef typename unicode::unicode_container<container_t> unicode_container;
+
+                if (!spans) throw std::exception("Only documents loaded with load_spans can be parsed incrementally");
+
+                // The elements that contain the edit, from the root down, 
+                // and their offsets.
+                std::vector<std::pair<node_index, size_t>> path;
+                node_index current = nodes.empty() ? no_node : 0;
+                size_t current_first = current == no_node ? 0 : node_sources[current].first;
+                while (current != no_node && contains(current, current_first, offset, removed))
+                {
+                    path.push_back(std::make_pair(current, current_first));
+
+                    node_index next = no_node;
+                    size_t next_first = 0;
+                    for (node_index i = nodes[current].first_child; i != no_node && next == no_node; i = nodes[i].next_sibling)
+                    {
+                        size_t first = current_first + node_sources[i].first;
+                        if (nodes[i].kind != text_node && contains(i, first, offset, removed))
+                        {
+                            next = i;
+                            next_first = first;
+                        }
+                    }
+                    current = next;
+                    current_first = next_first;
+                }
+
+                unicode_container data(c);
+                for (; !path.empty(); path.pop_back())
+                {
+                    if (reparse_element(data, path.back().first, path.back().second, removed, inserted)) return path.back().first;
+                }
+
+                document fresh(c, load_spans, _names, _pool);
+                nodes.swap(fresh.nodes);
+                attributes.swap(fresh.attributes);
+                strings.swap(fresh.strings);
+                mapping.swap(fresh.mapping);
+                node_sources.swap(fresh.node_sources);
+                attribute_sources.swap(fresh.attribute_sources);
+                node_parents.swap(fresh.node_parents);
+                orphaned_nodes = orphaned_attributes = orphaned_chars = 0;
+                dirty.swap(fresh.dirty);
+                edited.swap(fresh.edited);
+                hashes.clear();
+
+                // The edit may have changed the encoding declaration.
+                latin1 = fresh.latin1;
+                return 0;
+            }
+
+            // Computes a hash of each node, which covers an element's name, 
+            // its attributes (regardless of their order), and the hashes of 
+            // its children, in order, and a text node's text.  Equal subtrees 
+            // have equal hashes, even in documents that use different name 
+            // tables, so they can be compared in constant time (see 
+            // xml::diff).  A parent always comes before its children in the 
+            // array of nodes, so the hashes are computed bottom-up in a 
+            // single pass over it, from the end.  Lazily loaded documents are 
+            // fully parsed first.  The hashes are discarded when the document 
+            // is edited (or parsed again), and have to be computed again.  
+            // Documents loaded with load_shared already have them.
+            void compute_hashes()
+            {
+                if (has_hashes()) return;
+                if (load && !nodes.empty()) expand_all(root());
+
+                std::vector<uint64_t> name_hashes;
+                hashes.resize(nodes.size());
+                for (size_t i = nodes.size(); i-- > 0; )
+                {
+                    hashes[i] = hash_node(static_cast<node_index>(i), name_hashes);
+                }
+            }
+
+            // Returns true if the document was loaded with load_shared (or 
+            // from a snapshot of such a document).
+            bool is_shared() const { return shared; }
+
+            bool has_hashes() const { return !nodes.empty() && hashes.size() == nodes.size(); }
+
+            // Returns the indices of the nodes that were edited.  For 
+            // documents loaded with load_spans, they're in the order of their 
+            // sources (which xml::writer relies on), and otherwise in the 
+            // order of their indices, which isn't necessarily document order 
+            // (e.g., after lazy elements are expanded, or an element is 
+            // parsed again by reparse(), its descendants follow all of the 
+            // other nodes).
+            std::vector<node_index> dirty_nodes() const
+            {
+                std::vector<node_index> result(edited);
+                if (spans)
+                {
+                    std::vector<std::pair<uint32_t, node_index>> sorted;
+                    for (auto index : result) sorted.push_back(std::make_pair(source_first(index), index));
+                    std::sort(sorted.begin(), sorted.end());
+                    for (size_t i = 0; i < sorted.size(); i++) result[i] = sorted[i].second;
+                }
+                else
+                {
+                    std::sort(result.begin(), result.end());
+                }
+                return result;
+            }
+
+        private:
+            util::string_view view(const string_span& s) const
+            {
+                if (s.length & pooled_string) return _pool->view(s.offset);
+                return s.length == 0 ? util::string_view() : util::string_view(&strings[s.offset], s.length);
+            }
+        };
+
+        template <typename handle_t, bool elements_only>
+        inline void sibling_iterator<handle_t, elements_only>::skip()
+        {
+            if (!elements_only) return;
+            while (index != no_node && doc->nodes[index].kind == text_node)
+                index = doc->nodes[index].next_sibling;
+        }
+
+        template <typename handle_t, bool elements_only>
+        inline sibling_iterator<handle_t, elements_only>& sibling_iterator<handle_t, elements_only>::operator++ ()
+        {
+            index = doc->nodes[index].next_sibling;
+            skip();
+            return *this;
+        }
+
+        inline attribute attribute_iterator::operator* () const
+        {
+            return attribute(doc, index);
+        }
+
+        inline util::string_view attribute::name() const { return doc->_names->name(id()); }
+        inline name_id attribute::id() const { return doc->attributes[index].name; }
+        inline util::string_view attribute::value() const { return doc->view(doc->attributes[index].value); }
+
+        inline const node_data& element::data() const
+        {
+            assert(index != no_node);
+            return doc->nodes[index];
+        }
+
+        inline util::string_view element::name() const
+        {
+            return doc->_names->name(data().name);
+        }
+
+        inline attribute_list element::attributes() const
+        {
+            doc->expand(index);
+            const node_data& n = data();
+            return attribute_list(attribute_iterator(doc, n.first), attribute_iterator(doc, n.first + n.count));
+        }
+
+        inline bool element::has_attribute(name_id id) const
+        {
+            doc->expand(index);
+            const node_data& n = data();
+            for (uint32_t i = n.first; i < n.first + n.count; i++)
+            {
+                if (doc->attributes[i].name == id) return true;
+            }
+            return false;
+        }
+
+        inline bool element::has_attribute(const util::string_view& name) const
+        {
+            doc->expand(index);
+            name_id id = doc->_names->find(name);
+            return id != no_name && has_attribute(id);
+        }
+
+        inline util::string_view element::attribute(name_id id) const
+        {
+            doc->expand(index);
+            const node_data& n = data();
+            for (uint32_t i = n.first; i < n.first + n.count; i++)
+            {
+                if (doc->attributes[i].name == id) return doc->view(doc->attributes[i].value);
+            }
+            return util::string_view();
+        }
+
+        inline util::string_view element::attribute(const util::string_view& name) const
+        {
+            doc->expand(index);
+            name_id id = doc->_names->find(name);
+            return id == no_name ? util::string_view() : attribute(id);
+        }
+
+        inline element_list element::elements() const
+        {
+            doc->expand(index);
+            return element_list(element_iterator(doc, data().first_child), element_iterator(doc, no_node));
+        }
+
+        inline node_list element::nodes() const
+        {
+            doc->expand(index);
+            return node_list(node_iterator(doc, data().first_child), node_iterator(doc, no_node));
+        }
+
+        inline element element::child(name_id id) const
+        {
+            doc->expand(index);
+            for (node_index i = data().first_child; i != no_node; i = doc->nodes[i].next_sibling)
+            {
+                const node_data& n = doc->nodes[i];
+                if (n.kind != text_node && n.name == id) return element(doc, i);
+            }
+            return element();
+        }
+
+        inline element element::child(const util::string_view& name) const
+        {
+            doc->expand(index);
+            name_id id = doc->_names->find(name);
+            return id == no_name ? element() : child(id);
+        }
+
+        inline uint64_t element::hash() const
+        {
+            assert(doc->has_hashes());
+            return doc->hashes[index];
+        }
+
+        inline std::string element::text() const
+        {
+            doc->expand(index);
+            std::string s;
+            for (node_index i = data().first_child; i != no_node; i = doc->nodes[i].next_sibling)
+            {
+                const node_data& n = doc->nodes[i];
+                if (n.kind == text_node)
+                {
+                    string_span span = { n.first, n.count };
+                    util::string_view v = doc->view(span);
+                    s.append(v.data(), v.size());
+                }
+            }
+            return s;
+        }
+
+        inline bool node::is_element() const { return doc->nodes[index].kind != text_node; }
+        inline bool node::is_text() const { return doc->nodes[index].kind == text_node; }
+
+        inline util::string_view node::text() const
+        {
+            assert(is_text());
+            const node_data& n = doc->nodes[index];
+            string_span s = { n.first, n.count };
+            return doc->view(s);
+        }
+    }
+}
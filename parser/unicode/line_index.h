@@ -0,0 +1,117 @@
+#pragma once
+
+#include <algorithm>
+#include <iterator>
+#include <vector>
+#include "..\simd.h"
+
+namespace unicode
+{
+    // This class maps offsets within an encoded string to line numbers.  The
+    // table of line start offsets is only built the first time a line is
+    // requested, since positions are normally only needed to report errors.
+    // Offsets are measured in code units of the underlying iterator (i.e.,
+    // bytes for an octet iterator), relative to the first character.
+    //
+    // A newline is a code unit with the value 'newline' that is located at
+    // position 'lane' within a character of 'stride' units, where every
+    // other unit in the character is zero.  For example, '\n' in UTF-16LE is
+    // matched with stride = 2 and lane = 0.
+    template <typename unit_iterator>
+    class line_index
+    {
+        typedef typename std::iterator_traits<unit_iterator>::value_type unit_type;
+
+        unit_iterator first, last;
+        unit_type newline;
+        size_t stride, lane;
+        std::vector<size_t> starts;
+        bool built;
+
+        bool is_newline(const unit_type* unit) const
+        {
+            for (size_t i = 0; i < stride; i++)
+            {
+                if (unit[i] != (i == lane ? newline : 0)) return false;
+            }
+            return true;
+        }
+
+        // SIMD version, used for contiguous, single byte code units.
+        void build(std::true_type)
+        {
+            if (first == last) return;
+
+            const char* begin = util::to_pointer(first, last);
+            const char* end = begin + (last - first);
+
+            starts.reserve(util::simd::count(begin, end, newline) + 1);
+
+            for (const char* p = util::simd::find(begin, end, newline); p != end;
+                p = util::simd::find(p + 1, end, newline))
+            {
+                size_t offset = p - begin;
+                if (offset % stride != lane) continue;
+
+                const char* unit = p - lane;
+                if (unit + stride <= end && is_newline(unit))
+                    starts.push_back(offset - lane + stride);
+            }
+        }
+
+        // Generic version for any other iterator.
+        void build(std::false_type)
+        {
+            unit_type unit[4];
+            size_t offset = 0, i = 0;
+            for (auto it = first; it != last; ++it, ++offset)
+            {
+                unit[i++] = *it;
+                if (i == stride)
+                {
+                    if (is_newline(unit)) starts.push_back(offset + 1);
+                    i = 0;
+                }
+            }
+        }
+
+        void build()
+        {
+            if (built) return;
+            starts.push_back(0);
+            build(std::integral_constant<bool,
+                util::is_contiguous<unit_iterator>::value && sizeof(unit_type) == 1>());
+            built = true;
+        }
+
+    public:
+        line_index(const unit_iterator& from, const unit_iterator& to, unit_type nl, size_t s, size_t l)
+            : first(from), last(to), newline(nl), stride(s), lane(l), built(false)
+        {
+            assert(stride <= 4 && lane < stride);
+        }
+
+        // Returns the offset of a position, relative to the first character.
+        size_t offset(const unit_iterator& it) const
+        {
+            return it - first;
+        }
+
+        // Returns the (1-based) line number that contains the specified
+        // offset.
+        size_t line(size_t offset)
+        {
+            build();
+            return std::upper_bound(starts.begin(), starts.end(), offset) - starts.begin();
+        }
+
+        // Returns an iterator to the first code unit of the specified
+        // (1-based) line.
+        unit_iterator line_start(size_t line)
+        {
+            build();
+            assert(line > 0 && line <= starts.size());
+            return first + starts[line - 1];
+        }
+    };
+}
\ No newline at end of file
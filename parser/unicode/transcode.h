@@ -0,0 +1,344 @@
+#pragma once
+
+#include <exception>
+#include <string>
+#include <string.h>
+#include "unicode.h"
+
+namespace unicode
+{
+    // Thrown when UTF-16 or UTF-32 data being transcoded contains an invalid
+    // code unit (e.g., an unpaired surrogate).  The offset, in bytes, is
+    // relative to the start of the source data.
+    class invalid_encoding : public std::exception
+    {
+        size_t pos;
+
+    public:
+        explicit invalid_encoding(size_t p) : pos(p) {}
+
+        virtual const char* what() const throw() { return "Invalid UTF-16/UTF-32 data"; }
+
+        size_t offset() const { return pos; }
+    };
+
+    // This namespace contains functions that convert a whole buffer from one
+    // of the supported encodings to UTF-8 at once.  Runs of ASCII characters
+    // (the bulk of most XML documents) are converted 8 (UTF-16) or 4
+    // (UTF-32) at a time using SSE2, including any byte swapping, and blocks
+    // that are known not to contain surrogates skip the pairing checks.
+    namespace transcode
+    {
+        inline bool native_little_endian()
+        {
+            const utf8::uint16_t one = 1;
+            return *reinterpret_cast<const unsigned char*>(&one) == 1;
+        }
+
+        // Writes a code point known to be valid, and returns the new output
+        // position.
+        inline char* append(utf8::uint32_t cp, char* out)
+        {
+            return utf8::unchecked::append(cp, out);
+        }
+
+        inline utf8::uint16_t load16(const unsigned char* p, bool little_endian)
+        {
+            return little_endian ?
+                static_cast<utf8::uint16_t>(p[0] | (p[1] << 8)) :
+                static_cast<utf8::uint16_t>((p[0] << 8) | p[1]);
+        }
+
+        inline utf8::uint32_t load32(const unsigned char* p, bool little_endian)
+        {
+            return little_endian ?
+                (utf8::uint32_t(p[0]) | (utf8::uint32_t(p[1]) << 8) | (utf8::uint32_t(p[2]) << 16) | (utf8::uint32_t(p[3]) << 24)) :
+                ((utf8::uint32_t(p[0]) << 24) | (utf8::uint32_t(p[1]) << 16) | (utf8::uint32_t(p[2]) << 8) | utf8::uint32_t(p[3]));
+        }
+
+        // Converts one UTF-16 character starting at unit i (of n), and
+        // returns the index of the next one.
+        inline size_t utf16_char(const unsigned char* p, size_t i, size_t n, bool little_endian, char*& out)
+        {
+            utf8::uint32_t cp = load16(p + 2 * i, little_endian);
+            if (utf8::internal::is_lead_surrogate(cp))
+            {
+                utf8::uint32_t trail = i + 1 < n ? load16(p + 2 * i + 2, little_endian) : 0;
+                if (!utf8::internal::is_trail_surrogate(trail)) throw invalid_encoding(2 * i);
+                cp = (cp << 10) + trail + utf8::internal::SURROGATE_OFFSET;
+                out = append(cp, out);
+                return i + 2;
+            }
+            else if (utf8::internal::is_trail_surrogate(cp))
+                throw invalid_encoding(2 * i);
+
+            out = append(cp, out);
+            return i + 1;
+        }
+
+        // Appends the UTF-8 form of the UTF-16 data in [data, data + size)
+        // to the output string.
+        inline void utf16_to_utf8(const char* data, size_t size, bool little_endian, std::string& output)
+        {
+            const unsigned char* p = reinterpret_cast<const unsigned char*>(data);
+            size_t n = size / 2;
+            if (size % 2 != 0) throw invalid_encoding(size - 1);
+
+            // Each unit produces at most 3 bytes (a surrogate pair produces
+            // 4), so the output is sized for the worst case and trimmed.
+            size_t base = output.size();
+            output.resize(base + 3 * n);
+            char* start = &output[0];
+            char* out = start + base;
+            size_t i = 0;
+
+#if defined(UTIL_SIMD_SSE2)
+            const __m128i zero = _mm_setzero_si128();
+            const __m128i non_ascii = _mm_set1_epi16(static_cast<short>(0xFF80));
+            const __m128i surrogate_mask = _mm_set1_epi16(static_cast<short>(0xF800));
+            const __m128i surrogate = _mm_set1_epi16(static_cast<short>(0xD800));
+
+            while (i + 8 <= n)
+            {
+                __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + 2 * i));
+                if (!little_endian)
+                    v = _mm_or_si128(_mm_slli_epi16(v, 8), _mm_srli_epi16(v, 8));
+
+                if (_mm_movemask_epi8(_mm_cmpeq_epi16(_mm_and_si128(v, non_ascii), zero)) == 0xFFFF)
+                {
+                    _mm_storel_epi64(reinterpret_cast<__m128i*>(out), _mm_packus_epi16(v, v));
+                    out += 8;
+                    i += 8;
+                }
+                else if (_mm_movemask_epi8(_mm_cmpeq_epi16(_mm_and_si128(v, surrogate_mask), surrogate)) == 0)
+                {
+                    utf8::uint16_t units[8];
+                    _mm_storeu_si128(reinterpret_cast<__m128i*>(units), v);
+                    for (size_t k = 0; k < 8; k++) out = append(units[k], out);
+                    i += 8;
+                }
+                else
+                {
+                    // A surrogate pair may straddle the end of the block, so
+                    // the scalar conversion can finish past it.
+                    size_t block_end = i + 8;
+                    while (i < block_end) i = utf16_char(p, i, n, little_endian, out);
+                }
+            }
+#endif
+            while (i < n) i = utf16_char(p, i, n, little_endian, out);
+
+            output.resize(out - start);
+        }
+
+        inline void utf32_char(const unsigned char* p, size_t i, bool little_endian, char*& out)
+        {
+            utf8::uint32_t cp = load32(p + 4 * i, little_endian);
+            if (!utf8::internal::is_code_point_valid(cp)) throw invalid_encoding(4 * i);
+            out = append(cp, out);
+        }
+
+        // Appends the UTF-8 form of the UTF-32 data in [data, data + size)
+        // to the output string.
+        inline void utf32_to_utf8(const char* data, size_t size, bool little_endian, std::string& output)
+        {
+            const unsigned char* p = reinterpret_cast<const unsigned char*>(data);
+            size_t n = size / 4;
+            if (size % 4 != 0) throw invalid_encoding(size - size % 4);
+
+            // Each unit produces at most 4 bytes.
+            size_t base = output.size();
+            output.resize(base + 4 * n);
+            char* start = &output[0];
+            char* out = start + base;
+            size_t i = 0;
+
+#if defined(UTIL_SIMD_SSE2)
+            const __m128i zero = _mm_setzero_si128();
+            const __m128i non_ascii = _mm_set1_epi32(static_cast<int>(0xFFFFFF80));
+
+            while (i + 4 <= n)
+            {
+                __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + 4 * i));
+                if (!little_endian)
+                {
+                    v = _mm_or_si128(_mm_slli_epi16(v, 8), _mm_srli_epi16(v, 8));
+                    v = _mm_shufflehi_epi16(_mm_shufflelo_epi16(v, _MM_SHUFFLE(2, 3, 0, 1)), _MM_SHUFFLE(2, 3, 0, 1));
+                }
+
+                if (_mm_movemask_epi8(_mm_cmpeq_epi32(_mm_and_si128(v, non_ascii), zero)) == 0xFFFF)
+                {
+                    __m128i packed = _mm_packus_epi16(_mm_packs_epi32(v, v), zero);
+                    int bytes = _mm_cvtsi128_si32(packed);
+                    memcpy(out, &bytes, 4);
+                    out += 4;
+                }
+                else
+                {
+                    for (size_t k = 0; k < 4; k++) utf32_char(p, i + k, little_endian, out);
+                }
+                i += 4;
+            }
+#endif
+            for (; i < n; i++) utf32_char(p, i, little_endian, out);
+
+            output.resize(out - start);
+        }
+
+        // Appends the UTF-8 form of the ISO-8859-1 data in [data, data + 
+        // size) to the output string.  Runs of ASCII are copied 16 bytes at a 
+        // time, and every other byte becomes a 2-byte sequence.
+        inline void latin1_to_utf8(const char* data, size_t size, std::string& output)
+        {
+            size_t base = output.size();
+            output.resize(base + 2 * size);
+            char* start = &output[0];
+            char* out = start + base;
+            size_t i = 0;
+
+#if defined(UTIL_SIMD_SSE2)
+            while (i + 16 <= size)
+            {
+                __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i));
+                unsigned mask = _mm_movemask_epi8(v);
+                if (mask == 0)
+                {
+                    _mm_storeu_si128(reinterpret_cast<__m128i*>(out), v);
+                    out += 16;
+                    i += 16;
+                }
+                else
+                {
+                    // Copy the ASCII prefix, then convert the first 
+                    // non-ASCII byte.
+                    size_t ascii = util::simd::first_bit(mask);
+                    memcpy(out, data + i, ascii);
+                    out += ascii;
+                    i += ascii;
+                    out = append(static_cast<unsigned char>(data[i++]), out);
+                }
+            }
+#endif
+            for (; i < size; i++) out = append(static_cast<unsigned char>(data[i]), out);
+
+            output.resize(out - start);
+        }
+
+        // Appends the UTF-8 form of the data in [data, data + size), which
+        // is in the specified encoding (without a BOM), to the output
+        // string.
+        inline void to_utf8(const char* data, size_t size, encoding enc, std::string& output)
+        {
+            switch (enc)
+            {
+            case utf8:
+                {
+                    size_t invalid = validate_utf8(data, size);
+                    if (invalid != size) throw invalid_utf8_sequence(invalid);
+                }
+                // fall through
+            case utf8_valid:
+                output.append(data, size);
+                break;
+
+            case utf16le: utf16_to_utf8(data, size, true, output); break;
+            case utf16be: utf16_to_utf8(data, size, false, output); break;
+            case utf32le: utf32_to_utf8(data, size, true, output); break;
+            case utf32be: utf32_to_utf8(data, size, false, output); break;
+            case latin1: latin1_to_utf8(data, size, output); break;
+
+            default:
+                throw std::exception("Unexpected encoding");
+            }
+        }
+    }
+
+    // This class converts a container in any of the encodings supported by
+    // unicode_container into a buffer of UTF-8 data, all at once.  It can be
+    // used in place of the original container (e.g., to construct an
+    // xml::tree::document), so that parsing runs over the fastest path
+    // (validated UTF-8), rather than assembling each UTF-16/UTF-32 character
+    // from individual bytes.  The cost is a copy of the data, which is
+    // usually far cheaper than decoding it character by character.
+    template <typename source_container>
+    class utf8_container
+    {
+        typedef unicode_container<source_container> source_unicode_container;
+        typedef typename source_container::iterator source_iterator;
+        typedef typename std::iterator_traits<source_iterator>::value_type source_value_type;
+
+        std::string buffer;
+
+        // Contiguous 8-bit data: convert the whole buffer at once
+        void convert(source_container& c, source_unicode_container& source, std::true_type, std::false_type)
+        {
+            auto first = c.begin() + source.bom_length();
+            auto last = c.end();
+            if (first == last) return;
+            // Errors are reported relative to the start of the container, 
+            // like unicode_container does.
+            try
+            {
+                transcode::to_utf8(util::to_pointer(first, last), last - first, source.get_encoding(), buffer);
+            }
+            catch (invalid_encoding& e)
+            {
+                throw invalid_encoding(source.bom_length() + e.offset());
+            }
+            catch (invalid_utf8_sequence& e)
+            {
+                throw invalid_utf8_sequence(source.bom_length() + e.offset());
+            }
+        }
+
+        // Contiguous 16-bit data (e.g., std::wstring)
+        void convert(source_container& c, source_unicode_container& source, std::false_type, std::true_type)
+        {
+            auto first = c.begin() + source.bom_length();
+            auto last = c.end();
+            if (first == last) return;
+            try
+            {
+                transcode::utf16_to_utf8(
+                    reinterpret_cast<const char*>(util::to_pointer(first, last)),
+                    (last - first) * 2,
+                    transcode::native_little_endian() != source.swapped(),
+                    buffer);
+            }
+            catch (invalid_encoding& e)
+            {
+                throw invalid_encoding(2 * source.bom_length() + e.offset());
+            }
+        }
+
+        // Anything else is converted one character at a time.
+        template <typename bytes_t, typename words_t>
+        void convert(source_container&, source_unicode_container& source, bytes_t, words_t)
+        {
+            for (auto it = source.begin(), end = source.end(); it != end; ++it)
+                utf8::unchecked::append(*it, std::back_inserter(buffer));
+        }
+
+    public:
+        typedef char value_type;
+        typedef std::string::iterator iterator;
+
+        static const bool is_valid_utf8 = true;
+
+        explicit utf8_container(source_container& c)
+        {
+            source_unicode_container source(c);
+
+            const bool contiguous = util::is_contiguous<source_iterator>::value;
+            convert(c, source,
+                std::integral_constant<bool, contiguous && sizeof(source_value_type) == 1>(),
+                std::integral_constant<bool, contiguous && sizeof(source_value_type) == 2>());
+        }
+
+        iterator begin() { return buffer.begin(); }
+        iterator end() { return buffer.end(); }
+
+        // Returns the UTF-8 data.
+        const std::string& str() const { return buffer; }
+    };
+}
\ No newline at end of file
@@ -1,660 +1,969 @@
-#pragma once
-
-#include <iterator>
-#include <type_traits>
-#include "utf8.h"
-
-namespace unicode
-{
-    // Template constant that always evaluates to false.  Useful for 
-    // static_assert's that shouldn't fire unless the containing template is 
-    // instanciated.
-    template <typename T>
-    struct always_false { enum { value = false }; };
-
-    // This class takes an octet_iterator (with an 8-bit value_type, i.e., 
-    // char), and converts it into a 16-bit iterator with the specified 
-    // endianness.
-    template <typename octet_iterator, bool little_endian>
-    class char16_iterator : public std::iterator <std::bidirectional_iterator_tag, char16_t>
-    { 
-        octet_iterator it;
-        octet_iterator start;
-        octet_iterator end;
-        value_type c;
-
-        static_assert(sizeof(typename octet_iterator::value_type) == 1, "Illegal value_type size for octet iterator");
-    
-    public:
-        explicit char16_iterator (const octet_iterator& from, const octet_iterator& to) : it(from), start(from), end(to)
-        {
-            get();
-        }
-
-        octet_iterator base()
-        {
-            return it;
-        }
-
-        value_type operator * () const
-        {
-            return c;
-        }
-
-        bool operator == (const char16_iterator& rhs) const 
-        { 
-            return (it == rhs.it);
-        }
-
-        bool operator != (const char16_iterator& rhs) const
-        {
-            return !(operator == (rhs));
-        }
-
-        char16_iterator& operator ++ () 
-        {
-            if (it != end)
-            {
-                std::advance(it, sizeof(value_type));
-                get();
-            }
-            return *this;
-        }
-
-        char16_iterator operator ++ (int)
-        {
-            char16_iterator temp(*this);
-            if (it != end)
-            {
-                std::advance(it, sizeof(value_type));
-                get();
-            }
-            return temp;
-        }  
-
-        char16_iterator& operator -- ()
-        {
-            if (it != start)
-            {
-                std::advance(it, -sizeof(value_type));
-                get();
-            }
-            return *this;
-        }
-
-        char16_iterator operator -- (int)
-        {
-            iterator temp(*this);
-            if (it != start)
-            {
-                std::advance(it, -sizeof(value_type));
-                get();
-            }
-            return temp;
-        }
-
-    protected:
-        void get()
-        {
-            char b1, b2;
-
-            if (it == end)
-            {
-                c = std::char_traits<char16_t>::eof();
-                return;
-            }
-            else b1 = *it;
-
-            octet_iterator next = it + 1;
-
-            if (next == end)
-            {
-                c = std::char_traits<char16_t>::eof();
-                return;
-            }
-            else b2 = *next;
-
-            c = little_endian ? 
-                ((b2 << 8) & 0xFF00) | (b1 & 0x00FF) :
-                ((b1 << 8) & 0xFF00) | (b2 & 0x00FF);
-        }
-
-    };
-
-    // This class converts a container with an 8-bit (char) value_type into 
-    // one with a 16-bit value_type.
-    template <typename octet_container, bool little_endian>
-    class char16_container
-    {
-        typedef char16_iterator<typename octet_container::iterator, little_endian> iterator;
-
-        octet_container container;
-
-    public:
-        char16_container(octet_container& c) : container(c)
-        {
-        }
-
-        iterator begin()
-        {
-            return iterator(container.begin(), container.end());
-        }
-
-        iterator end()
-        {
-            return iterator(container.end(), container.end());
-        }
-    };
-
-    // This class converts an 8-bit iterator (char) into a 32-bit iterator.
-    template <typename octet_iterator, bool little_endian>
-    class char32_iterator : public std::iterator <std::bidirectional_iterator_tag, char32_t>
-    { 
-        octet_iterator it;
-        octet_iterator start;
-        octet_iterator end;
-        value_type c;
-
-        static_assert(sizeof(typename octet_iterator::value_type) == 1, "Illegal value_type size for octet iterator");
-    
-    public:
-        explicit char32_iterator (const octet_iterator& from, const octet_iterator& to) : it(from), start(from), end(to)
-        {
-            get();
-        }
-
-        octet_iterator base()
-        {
-            return it;
-        }
-
-        value_type operator * () const
-        {
-            return c;
-        }
-
-        bool operator == (const char32_iterator& rhs) const 
-        { 
-            return (it == rhs.it);
-        }
-
-        bool operator != (const char32_iterator& rhs) const
-        {
-            return !(operator == (rhs));
-        }
-
-        char32_iterator& operator ++ () 
-        {
-            if (it != end)
-            {
-                std::advance(it, sizeof(value_type));
-                get();
-            }
-            return *this;
-        }
-
-        char32_iterator operator ++ (int)
-        {
-            char32_iterator temp(*this);
-            if (it != end)
-            {
-                std::advance(it, sizeof(value_type));
-                get();
-            }
-            return temp;
-        }  
-
-        char32_iterator& operator -- ()
-        {
-            if (it != start)
-            {
-                std::advance(it, -sizeof(value_type));
-                get();
-            }
-            return *this;
-        }
-
-        char32_iterator operator -- (int)
-        {
-            char32_iterator temp(*this);
-            if (it != start)
-            {
-                std::advance(it, -sizeof(value_type));
-                get();
-            }
-            return temp;
-        }
-
-    protected:
-        void get()
-        {
-            char b1, b2, b3, b4;
-            octet_iterator next1 = it + 1;
-            octet_iterator next2 = it + 2;
-            octet_iterator next3 = it + 3;
-
-            if (it == end) { c = std::char_traits<char32_t>::eof(); return; }
-            else b1 = *it;
-
-            if (next1 == end) { c = std::char_traits<char32_t>::eof(); return; }
-            else b2 = *next1;
-
-            if (next2 == end) { c = std::char_traits<char32_t>::eof(); return; }
-            else b3 = *next2;
-
-            if (next3 == end) { c = std::char_traits<char32_t>::eof(); return; }
-            else b4 = *next3;
-
-            c = little_endian ? 
-                ((b4 << 24) & 0xFF000000) | ((b3 << 16) & 0x00FF0000) | ((b2 << 8) & 0x0000FF00) | (b1 & 0x000000FF) :
-                ((b1 << 24) & 0xFF000000) | ((b2 << 16) & 0x00FF0000) | ((b3 << 8) & 0x0000FF00) | (b4 & 0x000000FF);
-        }
-
-    };
-
-    // This class converts a container with an 8-bit (char) value_type info 
-    // one with a 32-bit value_type.
-    template <typename octet_container, bool little_endian>
-    class char32_container
-    {
-        typedef char32_iterator<typename octet_container::iterator, little_endian> iterator;
-
-        octet_container container;
-
-    public:
-        char32_container(octet_container& c) : container(c)
-        {
-        }
-
-        iterator begin()
-        {
-            return iterator(container.begin(), container.end());
-        }
-
-        iterator end()
-        {
-            return iterator(container.end(), container.end());
-        }
-    };
-
-    // This function (is probably implemented in some Boost or C++11/14 library) 
-    // checks whether a container starts with another container by iteratively 
-    // comparing the elements of each.  If 'c' does not start with elements in
-    // 'sub' (all of them), the function returns false.
-    template <typename container, typename sub_container>
-    bool starts_with(container& c, sub_container& sub)
-    {
-        auto c_it = c.begin();
-        auto c_end = c.end();
-
-        auto sub_it = sub.begin();
-        auto sub_end = sub.end();
-
-        while (c_it != c_end && sub_it != sub_end)
-        {
-            if (*c_it != *sub_it) return false;
-            c_it++;
-            sub_it++;
-        }
-
-        return (sub_it == sub_end);
-    }
-
-    // UTF encodings supported by unicode_iterator
-    enum encoding { utf8, utf16le, utf16be, utf32le, utf32be };
-
-    template <typename octet_iterator, typename enable = void>
-    class unicode_iterator
-    {
-        static_assert(always_false<octet_iterator>::value, "unicode_iterator doesn't support the specified container type.");
-    };
-
-    // This class implements an iterator that wraps an octet-based (char) 
-    // iterator and a specified UTF encoding.  The resulting object then iterates
-    // unicode characters (char32_t).
-    template <typename octet_iterator>
-    class unicode_iterator<octet_iterator, typename std::enable_if<sizeof(typename octet_iterator::value_type) == sizeof(char)>::type>
-        : public std::iterator<std::forward_iterator_tag, char32_t>
-    {
-        octet_iterator current;
-        octet_iterator next;
-        octet_iterator end;
-        value_type c;
-        encoding enc;
-        size_t line, column;
-
-    public:
-        unicode_iterator() : c(std::char_traits<char32_t>::eof()), line(-1), column(-1)
-        {
-        }
-
-        explicit unicode_iterator(const octet_iterator& from, const octet_iterator& to, encoding e)
-            : current(from), next(from), end(to), enc(e), line(1), column(0)
-        {
-            get();
-        }
-
-        size_t get_line() { return line; }
-        size_t get_column() { return column; }
-
-        value_type operator * () const
-        {
-            return c;
-        }
-
-        bool operator == (const unicode_iterator& rhs) const 
-        { 
-            return (current == rhs.current);
-        }
-
-        bool operator != (const unicode_iterator& rhs) const
-        {
-            return !(operator == (rhs));
-        }
-
-        bool operator< (const unicode_iterator& rhs) const
-        {
-            return current < rhs.current;
-        }
-
-        unicode_iterator& operator ++ () 
-        {
-            if (current != end)
-            {
-                get();
-            }
-            return *this;
-        }
-
-        unicode_iterator operator ++ (int)
-        {
-            unicode_iterator temp(*this);
-            if (current != end)
-            {
-                get();
-            }
-            return temp;
-        }
-
-    private:
-        void get()
-        {
-            current = next;
-
-            if (current == end)
-            {
-                c = std::char_traits<value_type>::eof();
-                return;
-            }
-
-            switch (enc)
-            {
-            case utf8:
-                c = utf8::next(next, end);
-                break;
-
-            case utf16le:
-                {
-                    unicode::char16_iterator<decltype(next), true> it16(next, end);
-                    unicode::char16_iterator<decltype(next), true> end16(end, end);
-                    c = utf8::utf16::next(it16, end16);
-                    next = it16.base();
-                }
-                break;
-
-            case utf16be:
-                {
-                    unicode::char16_iterator<decltype(next), false> it16(next, end);
-                    unicode::char16_iterator<decltype(next), false> end16(end, end);
-                    c = utf8::utf16::next(it16, end16);
-                    next = it16.base();
-                }
-                break;
-
-            case utf32le:
-                {
-                    unicode::char32_iterator<decltype(next), true> it32(next, end);
-                    c = *it32++;
-                    next = it32.base();
-                }
-                break;
-
-            case utf32be:
-                {
-                    unicode::char32_iterator<decltype(next), false> it32(next, end);
-                    c = *it32++;
-                    next = it32.base();
-                }
-                break;
-
-            default:
-                throw std::exception("Unexpected encoding");
-            }
-
-            if (c == '\n')
-            {
-                line++;
-                column = 0;
-            }
-            else column++;
-        }
-    };
-
-    // This class is the same as above, but appropriate for wchar_t/char16_t 
-    // iterators.  It is used in conjunction with the wchar_t unicode_iterator.
-    template <typename wchar_iterator>
-    class unicode_iterator<wchar_iterator, typename std::enable_if<sizeof(typename wchar_iterator::value_type) == sizeof(char16_t)>::type>
-        : public std::iterator<std::forward_iterator_tag, char32_t>
-    {
-        wchar_iterator current;
-        wchar_iterator next;
-        wchar_iterator end;
-        value_type c;
-        bool swap_bytes;
-        size_t line;
-
-    public:
-        unicode_iterator() : swap_bytes(false), c(std::char_traits<value_type>::eof()), line(-1), column(-1)
-        {
-        }
-
-        explicit unicode_iterator(const wchar_iterator& from, const wchar_iterator& to, bool swap) 
-            : current(from), next(from), end(to), swap_bytes(swap), line(1), column(0)
-        {
-            get();
-        }
-
-        size_t get_line() { return line; }
-        size_t get_column() { return column; }
-
-        value_type operator * () const
-        {
-            return c;
-        }
-
-        bool operator == (const unicode_iterator& rhs) const
-        {
-            return (current == rhs.current);
-        }
-
-        bool operator != (const unicode_iterator& rhs) const
-        {
-            return !(operator == (rhs));
-        }
-
-        unicode_iterator& operator ++ ()
-        {
-            if (current != end)
-            {
-                get();
-            }
-            return *this;
-        }
-
-        unicode_iterator operator ++ (int)
-        {
-            unicode_iterator temp(*this);
-            if (current != end)
-            {
-                get();
-            }
-            return temp;
-        }
-
-    private:
-        void get()
-        {
-            current = next;
-
-            if (current == end)
-            {
-                c = std::char_traits<value_type>::eof();
-                return;
-            }
-
-            c = utf8::utf16::next(next, end);
-
-            if (swap_bytes) c =
-                ((c >> 8) & 0x00FF) |
-                ((c << 8) & 0xFF00);
-
-            if (c == '\n')
-            {
-                line++;
-                column = 0;
-            }
-            else column++;
-        }
-    };
-
-    template <typename octet_container, typename Enable = void>
-    class unicode_container
-    {
-        static_assert(always_false<octet_container>::value, "unicode_container doesn't support the specified container type.");
-    };
-
-    // This class implements a container that wraps other STL-style containers 
-    // with begin()/end() methods that return iterators.  The wrapped container
-    // must contain single byte elements (i.e., char) type.  Examples of such 
-    // STL containers are std::string, std::vector<char>, etc.  This class treats
-    // the underlying container as housing a UTF-encoded string with an optional 
-    // BOM (mandatory for UTF-16 and UTF-32 strings).  The begin() method returns
-    // an iterator that points to the first unicode character following the BOM.
-    // The value_type for the iterator is char32_t, which is large enough to hold
-    // any unicode character.
-    template <typename octet_container>
-    class unicode_container<octet_container, typename std::enable_if<sizeof(typename octet_container::value_type) == sizeof(char)>::type>
-    {
-        typedef typename octet_container::iterator octet_iterator;
-
-        encoding enc;
-        octet_container& octets;
-        size_t bom_size;
-
-        template <encoding e>
-        bool try_encoding(const char* bom, size_t size)
-        {
-            bool matches = starts_with(octets, std::string(bom, size));
-            if (matches) { enc = e; bom_size = size; }
-            return matches;
-        }
-
-        void detect_encoding()
-        {
-            if (!(
-                try_encoding<utf8>("\xEF\xBB\xBF", 3) ||
-                try_encoding<utf32be>("\xFF\xFE\x00\x00", 4) ||
-                try_encoding<utf32le>("\x00\x00\xFE\xFF", 4) ||
-                try_encoding<utf16be>("\xFF\xFE", 2) ||
-                try_encoding<utf16le>("\xFE\xFF", 2)))
-            {
-                // No BOM present, assume UTF-8.  This will also work for ASCII.
-                enc = utf8;
-                bom_size = 0;
-            }
-        }
-
-    public:
-        typedef unicode_iterator<octet_iterator> iterator;
-
-        unicode_container(octet_container& c) : octets(c)
-        {
-            detect_encoding();
-        }
-
-        iterator begin()
-        {
-            return iterator(octets.begin() + bom_size, octets.end(), enc);
-        }
-
-        iterator end()
-        {
-            return iterator(octets.end(), octets.end(), enc);
-        }
-    };
-
-    // This class does the same as the one above, but appropriate for 
-    // containers that have 2-byte value types.  It assumes that each 2-byte 
-    // value is a UTF-16 encoded character.  This is mainly useful in cases 
-    // where the user is dealing with a std::wstring (or wchar_t/char16_t 
-    // array, etc).  Currently, this class doesn't support UTF-32.
-    template <typename wchar_container>
-    class unicode_container<wchar_container, typename std::enable_if<sizeof(typename wchar_container::value_type) == sizeof(char16_t)>::type>
-    {
-        typedef typename wchar_container::iterator wchar_iterator;
-        
-        wchar_container& container;
-        size_t bom_size;
-        bool swap_bytes;
-
-        void detect_encoding()
-        {
-            if (starts_with(container, std::wstring(L"\uFEFF", 1)))
-            {
-                swap_bytes = true;
-                size_t bom_size = 1;
-            }
-            else if (starts_with(container, std::wstring(L"\uFFFE", 1)))
-            {
-                swap_bytes = false;
-                bom_size = 1;
-            }
-            else
-            {
-                swap_bytes = false;
-                bom_size = 0;
-            }
-        }
-
-    public:
-        typedef unicode_iterator<wchar_iterator> iterator;
-
-        unicode_container(wchar_container& c) : container(c)
-        {
-            detect_encoding();
-        }
-
-        iterator begin()
-        {
-            return iterator(container.begin() + bom_size, container.end(), swap_bytes);
-        }
-
-        iterator end()
-        {
-            return iterator(container.end(), container.end(), swap_bytes);
-        }
-    };
-
-    // Returns a UTF-8 encoded string
-    template <typename octet_iterator>
-    std::string get_string(unicode_iterator<octet_iterator> start, unicode_iterator<octet_iterator> end)
-    {
-        std::string ret;
-        utf8::utf32to8(start, end, std::back_inserter(ret));
-        return ret;
-    }
-
-    // Returns a UTF-16 encoded string
-    template <typename iterator_t>
-    std::wstring get_wstring(iterator_t start, iterator_t end);
+#pragma once
+
+#include <iterator>
+#include <type_traits>
+#include "utf8.h"
+#include "..\string_view.h"
+#include "line_index.h"
+#include "validate.h"
+
+namespace unicode
+{
+    // Template constant that always evaluates to false.  Useful for 
+    // static_assert's that shouldn't fire unless the containing template is 
+    // instanciated.
+    template <typename T>
+    struct always_false { enum { value = false }; };
+
+    // This class takes an octet_iterator (with an 8-bit value_type, i.e., 
+    // char), and converts it into a 16-bit iterator with the specified 
+    // endianness.
+    template <typename octet_iterator, bool little_endian>
+    class char16_iterator : public std::iterator <std::bidirectional_iterator_tag, char16_t>
+    { 
+        octet_iterator it;
+        octet_iterator start;
+        octet_iterator end;
+        value_type c;
+
+        static_assert(sizeof(typename std::iterator_traits<octet_iterator>::value_type) == 1, "Illegal value_type size for octet iterator");
+    
+    public:
+        explicit char16_iterator (const octet_iterator& from, const octet_iterator& to) : it(from), start(from), end(to)
+        {
+            get();
+        }
+
+        octet_iterator base()
+        {
+            return it;
+        }
+
+        value_type operator * () const
+        {
+            return c;
+        }
+
+        bool operator == (const char16_iterator& rhs) const 
+        { 
+            return (it == rhs.it);
+        }
+
+        bool operator != (const char16_iterator& rhs) const
+        {
+            return !(operator == (rhs));
+        }
+
+        char16_iterator& operator ++ () 
+        {
+            if (it != end)
+            {
+                std::advance(it, sizeof(value_type));
+                get();
+            }
+            return *this;
+        }
+
+        char16_iterator operator ++ (int)
+        {
+            char16_iterator temp(*this);
+            if (it != end)
+            {
+                std::advance(it, sizeof(value_type));
+                get();
+            }
+            return temp;
+        }  
+
+        char16_iterator& operator -- ()
+        {
+            if (it != start)
+            {
+                std::advance(it, -sizeof(value_type));
+                get();
+            }
+            return *this;
+        }
+
+        char16_iterator operator -- (int)
+        {
+            iterator temp(*this);
+            if (it != start)
+            {
+                std::advance(it, -sizeof(value_type));
+                get();
+            }
+            return temp;
+        }
+
+    protected:
+        void get()
+        {
+            char b1, b2;
+
+            if (it == end)
+            {
+                c = std::char_traits<char16_t>::eof();
+                return;
+            }
+            else b1 = *it;
+
+            octet_iterator next = it + 1;
+
+            if (next == end)
+            {
+                c = std::char_traits<char16_t>::eof();
+                return;
+            }
+            else b2 = *next;
+
+            c = little_endian ? 
+                ((b2 << 8) & 0xFF00) | (b1 & 0x00FF) :
+                ((b1 << 8) & 0xFF00) | (b2 & 0x00FF);
+        }
+
+    };
+
+    // This class converts a container with an 8-bit (char) value_type into 
+    // one with a 16-bit value_type.
+    template <typename octet_container, bool little_endian>
+    class char16_container
+    {
+        typedef char16_iterator<typename octet_container::iterator, little_endian> iterator;
+
+        octet_container container;
+
+    public:
+        char16_container(octet_container& c) : container(c)
+        {
+        }
+
+        iterator begin()
+        {
+            return iterator(container.begin(), container.end());
+        }
+
+        iterator end()
+        {
+            return iterator(container.end(), container.end());
+        }
+    };
+
+    // This class converts an 8-bit iterator (char) into a 32-bit iterator.
+    template <typename octet_iterator, bool little_endian>
+    class char32_iterator : public std::iterator <std::bidirectional_iterator_tag, char32_t>
+    { 
+        octet_iterator it;
+        octet_iterator start;
+        octet_iterator end;
+        value_type c;
+
+        static_assert(sizeof(typename std::iterator_traits<octet_iterator>::value_type) == 1, "Illegal value_type size for octet iterator");
+    
+    public:
+        explicit char32_iterator (const octet_iterator& from, const octet_iterator& to) : it(from), start(from), end(to)
+        {
+            get();
+        }
+
+        octet_iterator base()
+        {
+            return it;
+        }
+
+        value_type operator * () const
+        {
+            return c;
+        }
+
+        bool operator == (const char32_iterator& rhs) const 
+        { 
+            return (it == rhs.it);
+        }
+
+        bool operator != (const char32_iterator& rhs) const
+        {
+            return !(operator == (rhs));
+        }
+
+        char32_iterator& operator ++ () 
+        {
+            if (it != end)
+            {
+                std::advance(it, sizeof(value_type));
+                get();
+            }
+            return *this;
+        }
+
+        char32_iterator operator ++ (int)
+        {
+            char32_iterator temp(*this);
+            if (it != end)
+            {
+                std::advance(it, sizeof(value_type));
+                get();
+            }
+            return temp;
+        }  
+
+        char32_iterator& operator -- ()
+        {
+            if (it != start)
+            {
+                std::advance(it, -sizeof(value_type));
+                get();
+            }
+            return *this;
+        }
+
+        char32_iterator operator -- (int)
+        {
+            char32_iterator temp(*this);
+            if (it != start)
+            {
+                std::advance(it, -sizeof(value_type));
+                get();
+            }
+            return temp;
+        }
+
+    protected:
+        void get()
+        {
+            char b1, b2, b3, b4;
+            octet_iterator next1 = it + 1;
+            octet_iterator next2 = it + 2;
+            octet_iterator next3 = it + 3;
+
+            if (it == end) { c = std::char_traits<char32_t>::eof(); return; }
+            else b1 = *it;
+
+            if (next1 == end) { c = std::char_traits<char32_t>::eof(); return; }
+            else b2 = *next1;
+
+            if (next2 == end) { c = std::char_traits<char32_t>::eof(); return; }
+            else b3 = *next2;
+
+            if (next3 == end) { c = std::char_traits<char32_t>::eof(); return; }
+            else b4 = *next3;
+
+            c = little_endian ? 
+                ((b4 << 24) & 0xFF000000) | ((b3 << 16) & 0x00FF0000) | ((b2 << 8) & 0x0000FF00) | (b1 & 0x000000FF) :
+                ((b1 << 24) & 0xFF000000) | ((b2 << 16) & 0x00FF0000) | ((b3 << 8) & 0x0000FF00) | (b4 & 0x000000FF);
+        }
+
+    };
+
+    // This class converts a container with an 8-bit (char) value_type info 
+    // one with a 32-bit value_type.
+    template <typename octet_container, bool little_endian>
+    class char32_container
+    {
+        typedef char32_iterator<typename octet_container::iterator, little_endian> iterator;
+
+        octet_container container;
+
+    public:
+        char32_container(octet_container& c) : container(c)
+        {
+        }
+
+        iterator begin()
+        {
+            return iterator(container.begin(), container.end());
+        }
+
+        iterator end()
+        {
+            return iterator(container.end(), container.end());
+        }
+    };
+
+    // This function (is probably implemented in some Boost or C++11/14 library) 
+    // checks whether a container starts with another container by iteratively 
+    // comparing the elements of each.  If 'c' does not start with elements in
+    // 'sub' (all of them), the function returns false.
+    template <typename container, typename sub_container>
+    bool starts_with(container& c, const sub_container& sub)
+    {
+        auto c_it = c.begin();
+        auto c_end = c.end();
+
+        auto sub_it = sub.begin();
+        auto sub_end = sub.end();
+
+        while (c_it != c_end && sub_it != sub_end)
+        {
+            if (*c_it != *sub_it) return false;
+            c_it++;
+            sub_it++;
+        }
+
+        return (sub_it == sub_end);
+    }
+
+    // Encodings supported by unicode_iterator.  utf8_valid is UTF-8 data 
+    // that has already been validated (see unicode_container), and is 
+    // decoded without any checks.  latin1 is ISO-8859-1, where each byte is 
+    // the code point of a character.
+    enum encoding { utf8, utf16le, utf16be, utf32le, utf32be, utf8_valid, latin1 };
+
+    inline bool is_utf8(encoding e) { return e == utf8 || e == utf8_valid; }
+
+    // This meta-function returns true for containers that are guaranteed to 
+    // hold valid UTF-8 data (i.e., that define a static is_valid_utf8 member 
+    // that is true, such as utf8_container), so that unicode_container can 
+    // skip validating them.
+    template <typename container_t, typename enable = void>
+    struct has_valid_utf8 : std::false_type {};
+
+    template <typename container_t>
+    struct has_valid_utf8<container_t, typename std::enable_if<container_t::is_valid_utf8>::type> : std::true_type {};
+
+    template <typename octet_iterator, typename enable = void>
+    class unicode_iterator
+    {
+        static_assert(always_false<octet_iterator>::value, "unicode_iterator doesn't support the specified container type.");
+    };
+
+    // This class implements an iterator that wraps an octet-based (char) 
+    // iterator and a specified UTF encoding.  The resulting object then iterates
+    // unicode characters (char32_t).  The line and column of the current 
+    // character aren't tracked while iterating, but are computed on demand 
+    // using the line_index of the container the iterator came from.
+    template <typename octet_iterator>
+    class unicode_iterator<octet_iterator, typename std::enable_if<sizeof(typename std::iterator_traits<octet_iterator>::value_type) == sizeof(char)>::type>
+        : public std::iterator<std::forward_iterator_tag, char32_t>
+    {
+        octet_iterator current;
+        octet_iterator next;
+        octet_iterator end;
+        value_type c;
+        encoding enc;
+        line_index<octet_iterator>* lines;
+
+    public:
+        unicode_iterator() : c(std::char_traits<char32_t>::eof()), enc(utf8), lines(nullptr)
+        {
+        }
+
+        explicit unicode_iterator(const octet_iterator& from, const octet_iterator& to, encoding e, line_index<octet_iterator>* l = nullptr)
+            : current(from), next(from), end(to), enc(e), lines(l)
+        {
+            get();
+        }
+
+        // Returns the underlying octet iterator, pointing at the first byte 
+        // of the current character.
+        octet_iterator base() const { return current; }
+
+        encoding get_encoding() const { return enc; }
+
+        // Returns true if the characters are UTF-8 encoded in contiguous 
+        // memory, in which case bytes_to() returns the raw bytes between two 
+        // iterators.
+        bool has_bytes() const
+        {
+            return util::is_contiguous<octet_iterator>::value && is_utf8(enc);
+        }
+
+        // Returns the bytes from the current character up to (but not 
+        // including) 'last'.  Only valid if has_bytes() returns true.
+        util::string_view bytes_to(const unicode_iterator& last) const
+        {
+            assert(has_bytes());
+            return bytes_to(last, std::integral_constant<bool, util::is_contiguous<octet_iterator>::value>());
+        }
+
+        // Returns true if markup characters can be found by scanning the 
+        // raw bytes, i.e., the data is in contiguous memory and every ASCII 
+        // character is a single byte that can't occur within another 
+        // character (UTF-8 or ISO-8859-1).
+        bool has_ascii_bytes() const
+        {
+            return util::is_contiguous<octet_iterator>::value && (is_utf8(enc) || enc == latin1);
+        }
+
+        // Returns the raw bytes from the current character up to (but not 
+        // including) 'last'.  Only valid if has_ascii_bytes() returns true.
+        util::string_view ascii_bytes_to(const unicode_iterator& last) const
+        {
+            assert(has_ascii_bytes());
+            return bytes_to(last, std::integral_constant<bool, util::is_contiguous<octet_iterator>::value>());
+        }
+
+        // Returns an iterator to the character 'n' bytes after the current 
+        // one, which must be the start of a character.
+        unicode_iterator skip_bytes(size_t n) const
+        {
+            return unicode_iterator(std::next(current, n), end, enc, lines);
+        }
+
+        // Returns the 1-based line number of the current character, or -1 if 
+        // the iterator isn't associated with a container.
+        size_t get_line() const
+        {
+            if (lines == nullptr) return -1;
+            return lines->line(lines->offset(current));
+        }
+
+        // Returns the 1-based column (in characters) of the current 
+        // character, or -1 if the iterator isn't associated with a container.
+        size_t get_column() const
+        {
+            if (lines == nullptr) return -1;
+
+            unicode_iterator it(lines->line_start(get_line()), end, enc);
+            size_t column = 1;
+            for (; it.current != current && it.current != end; ++it) column++;
+            return column;
+        }
+
+        value_type operator * () const
+        {
+            return c;
+        }
+
+        bool operator == (const unicode_iterator& rhs) const 
+        { 
+            return (current == rhs.current);
+        }
+
+        bool operator != (const unicode_iterator& rhs) const
+        {
+            return !(operator == (rhs));
+        }
+
+        bool operator< (const unicode_iterator& rhs) const
+        {
+            return current < rhs.current;
+        }
+
+        unicode_iterator& operator ++ () 
+        {
+            if (current != end)
+            {
+                get();
+            }
+            return *this;
+        }
+
+        unicode_iterator operator ++ (int)
+        {
+            unicode_iterator temp(*this);
+            if (current != end)
+            {
+                get();
+            }
+            return temp;
+        }
+
+    private:
+        util::string_view bytes_to(const unicode_iterator& last, std::true_type) const
+        {
+            if (current == last.current) return util::string_view();
+            return util::string_view(
+                reinterpret_cast<const char*>(util::to_pointer(current, last.current)),
+                last.current - current);
+        }
+
+        util::string_view bytes_to(const unicode_iterator&, std::false_type) const
+        {
+            return util::string_view();
+        }
+
+        void get()
+        {
+            current = next;
+
+            if (current == end)
+            {
+                c = std::char_traits<value_type>::eof();
+                return;
+            }
+
+            switch (enc)
+            {
+            case utf8_valid:
+                c = utf8::unchecked::next(next);
+                break;
+
+            case utf8:
+                c = utf8::next(next, end);
+                break;
+
+            case latin1:
+                c = static_cast<unsigned char>(*next);
+                ++next;
+                break;
+
+            case utf16le:
+                {
+                    unicode::char16_iterator<decltype(next), true> it16(next, end);
+                    unicode::char16_iterator<decltype(next), true> end16(end, end);
+                    c = utf8::utf16::next(it16, end16);
+                    next = it16.base();
+                }
+                break;
+
+            case utf16be:
+                {
+                    unicode::char16_iterator<decltype(next), false> it16(next, end);
+                    unicode::char16_iterator<decltype(next), false> end16(end, end);
+                    c = utf8::utf16::next(it16, end16);
+                    next = it16.base();
+                }
+                break;
+
+            case utf32le:
+                {
+                    unicode::char32_iterator<decltype(next), true> it32(next, end);
+                    c = *it32++;
+                    next = it32.base();
+                }
+                break;
+
+            case utf32be:
+                {
+                    unicode::char32_iterator<decltype(next), false> it32(next, end);
+                    c = *it32++;
+                    next = it32.base();
+                }
+                break;
+
+            default:
+                throw std::exception("Unexpected encoding");
+            }
+        }
+    };
+
+    // This class is the same as above, but appropriate for wchar_t/char16_t 
+    // iterators.  It is used in conjunction with the wchar_t unicode_iterator.
+    template <typename wchar_iterator>
+    class unicode_iterator<wchar_iterator, typename std::enable_if<sizeof(typename std::iterator_traits<wchar_iterator>::value_type) == sizeof(char16_t)>::type>
+        : public std::iterator<std::forward_iterator_tag, char32_t>
+    {
+        wchar_iterator current;
+        wchar_iterator next;
+        wchar_iterator end;
+        value_type c;
+        bool swap_bytes;
+        line_index<wchar_iterator>* lines;
+
+    public:
+        unicode_iterator() : c(std::char_traits<value_type>::eof()), swap_bytes(false), lines(nullptr)
+        {
+        }
+
+        explicit unicode_iterator(const wchar_iterator& from, const wchar_iterator& to, bool swap, line_index<wchar_iterator>* l = nullptr) 
+            : current(from), next(from), end(to), swap_bytes(swap), lines(l)
+        {
+            get();
+        }
+
+        // Returns the underlying iterator, pointing at the first code unit 
+        // of the current character.
+        wchar_iterator base() const { return current; }
+
+        // UTF-16 data can't be used as UTF-8 bytes (see the octet version).
+        bool has_bytes() const { return false; }
+
+        util::string_view bytes_to(const unicode_iterator&) const { return util::string_view(); }
+
+        bool has_ascii_bytes() const { return false; }
+
+        util::string_view ascii_bytes_to(const unicode_iterator&) const { return util::string_view(); }
+
+        unicode_iterator skip_bytes(size_t n) const
+        {
+            return unicode_iterator(std::next(current, n), end, swap_bytes, lines);
+        }
+
+        size_t get_line() const
+        {
+            if (lines == nullptr) return -1;
+            return lines->line(lines->offset(current));
+        }
+
+        size_t get_column() const
+        {
+            if (lines == nullptr) return -1;
+
+            unicode_iterator it(lines->line_start(get_line()), end, swap_bytes);
+            size_t column = 1;
+            for (; it.current != current && it.current != end; ++it) column++;
+            return column;
+        }
+
+        value_type operator * () const
+        {
+            return c;
+        }
+
+        bool operator == (const unicode_iterator& rhs) const
+        {
+            return (current == rhs.current);
+        }
+
+        bool operator != (const unicode_iterator& rhs) const
+        {
+            return !(operator == (rhs));
+        }
+
+        unicode_iterator& operator ++ ()
+        {
+            if (current != end)
+            {
+                get();
+            }
+            return *this;
+        }
+
+        unicode_iterator operator ++ (int)
+        {
+            unicode_iterator temp(*this);
+            if (current != end)
+            {
+                get();
+            }
+            return temp;
+        }
+
+    private:
+        void get()
+        {
+            current = next;
+
+            if (current == end)
+            {
+                c = std::char_traits<value_type>::eof();
+                return;
+            }
+
+            // Units are swapped before surrogate pairs are combined, since a 
+            // swapped surrogate doesn't look like one.
+            c = unit(next++);
+            if (utf8::internal::is_lead_surrogate(c))
+            {
+                utf8::uint32_t trail = next != end ? unit(next) : 0;
+                if (!utf8::internal::is_trail_surrogate(trail)) throw utf8::invalid_utf16(static_cast<utf8::uint16_t>(c));
+                ++next;
+                c = (c << 10) + trail + utf8::internal::SURROGATE_OFFSET;
+            }
+            else if (utf8::internal::is_trail_surrogate(c))
+                throw utf8::invalid_utf16(static_cast<utf8::uint16_t>(c));
+        }
+
+        utf8::uint32_t unit(const wchar_iterator& it) const
+        {
+            utf8::uint32_t u = utf8::internal::mask16(*it);
+            return swap_bytes ? ((u >> 8) & 0x00FF) | ((u << 8) & 0xFF00) : u;
+        }
+    };
+
+    template <typename octet_container, typename Enable = void>
+    class unicode_container
+    {
+        static_assert(always_false<octet_container>::value, "unicode_container doesn't support the specified container type.");
+    };
+
+    // This class implements a container that wraps other STL-style containers 
+    // with begin()/end() methods that return iterators.  The wrapped container
+    // must contain single byte elements (i.e., char) type.  Examples of such 
+    // STL containers are std::string, std::vector<char>, etc.  This class treats
+    // the underlying container as housing a UTF-encoded string with an optional 
+    // BOM.  Without a BOM, the encoding is detected from the first bytes of 
+    // the XML declaration (as described in Appendix F of the XML spec), and 
+    // the declaration's encoding is used if it names ISO-8859-1.  The begin() 
+    // method returns an iterator that points to the first unicode character 
+    // following the BOM.
+    // The value_type for the iterator is char32_t, which is large enough to hold
+    // any unicode character.
+    //
+    // When the data is UTF-8 and the container is contiguous (e.g., 
+    // std::string or std::vector<char>), the whole buffer is validated up 
+    // front, and invalid_utf8_sequence is thrown if it is malformed.  The 
+    // characters are then decoded without any further checks.  Other 
+    // containers (e.g., a streambuf_container, whose data isn't available 
+    // yet) are checked one character at a time as they are decoded.  
+    // Containers that are known to hold valid UTF-8 (see has_valid_utf8) 
+    // aren't checked at all.
+    //
+    // UTF-16 and UTF-32 data can be converted to UTF-8 all at once with a 
+    // utf8_container (see transcode.h), which is much faster to parse than 
+    // decoding the original one character at a time.
+    template <typename octet_container>
+    class unicode_container<octet_container, typename std::enable_if<sizeof(typename octet_container::value_type) == sizeof(char)>::type>
+    {
+        typedef typename octet_container::iterator octet_iterator;
+
+        encoding enc;
+        octet_container& octets;
+        size_t bom_size;
+        line_index<octet_iterator> lines;
+
+        // Iterators refer to the container's line index, so copying isn't 
+        // allowed.
+        unicode_container(const unicode_container&);
+        unicode_container& operator= (const unicode_container&);
+
+        template <encoding e>
+        bool try_encoding(const char* bom, size_t size)
+        {
+            bool matches = starts_with(octets, std::string(bom, size));
+            if (matches) { enc = e; bom_size = size; }
+            return matches;
+        }
+
+        // Returns true if the data starts with the specified (non-BOM) 
+        // bytes, which identify the encoding without being skipped.
+        template <encoding e>
+        bool try_signature(const char* signature, size_t size)
+        {
+            bool matches = starts_with(octets, std::string(signature, size));
+            if (matches) { enc = e; bom_size = 0; }
+            return matches;
+        }
+
+        void detect_encoding()
+        {
+            // UTF-32 is checked first, since its little-endian BOM starts 
+            // with the UTF-16LE one.
+            if (!(
+                try_encoding<utf8>("\xEF\xBB\xBF", 3) ||
+                try_encoding<utf32le>("\xFF\xFE\x00\x00", 4) ||
+                try_encoding<utf32be>("\x00\x00\xFE\xFF", 4) ||
+                try_encoding<utf16le>("\xFF\xFE", 2) ||
+                try_encoding<utf16be>("\xFE\xFF", 2) ||
+                try_signature<utf32be>("\x00\x00\x00<", 4) ||
+                try_signature<utf32le>("<\x00\x00\x00", 4) ||
+                try_signature<utf16be>("\x00<\x00?", 4) ||
+                try_signature<utf16le>("<\x00?\x00", 4)))
+            {
+                // No BOM present, assume UTF-8 (which also works for ASCII) 
+                // unless the XML declaration says otherwise.  Containers 
+                // that hold valid UTF-8 (e.g., the output of a 
+                // utf8_container) are UTF-8 regardless of the declaration, 
+                // which was copied from the data they were converted from.
+                enc = utf8;
+                bom_size = 0;
+                if (!has_valid_utf8<octet_container>::value && starts_with(octets, std::string("<?xml", 5)) && is_latin1(declared_encoding()))
+                    enc = latin1;
+            }
+        }
+
+        // Returns the value of the encoding pseudo-attribute of an XML 
+        // declaration at the start of the data, or an empty string if there 
+        // isn't one.  Only ASCII characters can appear before the value, so 
+        // the declaration is scanned one byte at a time, up to the '?>'.
+        std::string declared_encoding()
+        {
+            const size_t max_length = 256;
+            std::string decl;
+            for (auto it = octets.begin(), end = octets.end(); it != end && decl.size() < max_length; ++it)
+            {
+                decl.push_back(*it);
+                if (*it == '>') break;
+            }
+
+            size_t pos = decl.find("encoding");
+            if (pos == std::string::npos) return std::string();
+            pos = decl.find_first_not_of(" \t\r\n", pos + 8);
+            if (pos == std::string::npos || decl[pos] != '=') return std::string();
+            pos = decl.find_first_not_of(" \t\r\n", pos + 1);
+            if (pos == std::string::npos || (decl[pos] != '"' && decl[pos] != '\'')) return std::string();
+
+            size_t stop = decl.find(decl[pos], pos + 1);
+            if (stop == std::string::npos) return std::string();
+            return decl.substr(pos + 1, stop - pos - 1);
+        }
+
+        // Encoding names are case-insensitive, and ISO-8859-1 has a number 
+        // of registered aliases.
+        static bool is_latin1(const std::string& name)
+        {
+            static const char* aliases[] = { "iso-8859-1", "iso_8859-1", "iso8859-1", "latin1", "l1", "cp819", "ibm819" };
+
+            std::string lower(name);
+            for (auto it = lower.begin(); it != lower.end(); ++it)
+            {
+                if (*it >= 'A' && *it <= 'Z') *it = *it - 'A' + 'a';
+            }
+
+            for (size_t i = 0; i < sizeof(aliases) / sizeof(aliases[0]); i++)
+            {
+                if (lower == aliases[i]) return true;
+            }
+            return false;
+        }
+
+        void validate()
+        {
+            if (has_valid_utf8<octet_container>::value) enc = utf8_valid;
+            else validate(std::integral_constant<bool, util::is_contiguous<octet_iterator>::value>());
+        }
+
+        void validate(std::true_type)
+        {
+            auto first = octets.begin() + bom_size;
+            auto last = octets.end();
+            if (first != last)
+            {
+                size_t size = last - first;
+                size_t invalid = validate_utf8(util::to_pointer(first, last), size);
+                if (invalid != size) throw invalid_utf8_sequence(bom_size + invalid);
+            }
+            enc = utf8_valid;
+        }
+
+        void validate(std::false_type)
+        {
+        }
+
+    public:
+        typedef unicode_iterator<octet_iterator> iterator;
+
+        unicode_container(octet_container& c) 
+            : octets(c), lines(c.begin(), c.end(), '\n', 1, 0)
+        {
+            detect_encoding();
+            if (enc == utf8) validate();
+
+            // The position of the '\n' byte within a character depends on 
+            // the width and byte order of the encoding.
+            switch (enc)
+            {
+            case utf16le: lines = line_index<octet_iterator>(octets.begin() + bom_size, octets.end(), '\n', 2, 0); break;
+            case utf16be: lines = line_index<octet_iterator>(octets.begin() + bom_size, octets.end(), '\n', 2, 1); break;
+            case utf32le: lines = line_index<octet_iterator>(octets.begin() + bom_size, octets.end(), '\n', 4, 0); break;
+            case utf32be: lines = line_index<octet_iterator>(octets.begin() + bom_size, octets.end(), '\n', 4, 3); break;
+            default: lines = line_index<octet_iterator>(octets.begin() + bom_size, octets.end(), '\n', 1, 0); break;
+            }
+        }
+
+        encoding get_encoding() const { return enc; }
+
+        // Returns the size of the BOM, in bytes.
+        size_t bom_length() const { return bom_size; }
+
+        iterator begin()
+        {
+            return iterator(octets.begin() + bom_size, octets.end(), enc, &lines);
+        }
+
+        // Returns the position of an iterator, in bytes from the start of 
+        // the container.  Together with at(), this can be used to record 
+        // positions compactly and return to them later, for containers with 
+        // random access iterators.
+        size_t offset(const iterator& it)
+        {
+            return it.base() - octets.begin();
+        }
+
+        // Returns an iterator to the character at the specified offset (see 
+        // offset()), which must be the start of a character.
+        iterator at(size_t offset)
+        {
+            return iterator(octets.begin() + offset, octets.end(), enc, &lines);
+        }
+
+        iterator end()
+        {
+            return iterator(octets.end(), octets.end(), enc, &lines);
+        }
+    };
+
+    // This class does the same as the one above, but appropriate for 
+    // containers that have 2-byte value types.  It assumes that each 2-byte 
+    // value is a UTF-16 encoded character.  This is mainly useful in cases 
+    // where the user is dealing with a std::wstring (or wchar_t/char16_t 
+    // array, etc).  Currently, this class doesn't support UTF-32.
+    template <typename wchar_container>
+    class unicode_container<wchar_container, typename std::enable_if<sizeof(typename wchar_container::value_type) == sizeof(char16_t)>::type>
+    {
+        typedef typename wchar_container::iterator wchar_iterator;
+        
+        wchar_container& container;
+        size_t bom_size;
+        bool swap_bytes;
+        line_index<wchar_iterator> lines;
+
+        unicode_container(const unicode_container&);
+        unicode_container& operator= (const unicode_container&);
+
+        // A BOM that reads as U+FEFF means the data is in the native byte 
+        // order, and one that reads as U+FFFE means it must be swapped.
+        void detect_encoding()
+        {
+            if (starts_with(container, std::wstring(L"\uFEFF", 1)))
+            {
+                swap_bytes = false;
+                bom_size = 1;
+            }
+            else if (starts_with(container, std::wstring(L"\uFFFE", 1)))
+            {
+                swap_bytes = true;
+                bom_size = 1;
+            }
+            else
+            {
+                swap_bytes = false;
+                bom_size = 0;
+            }
+        }
+
+    public:
+        typedef unicode_iterator<wchar_iterator> iterator;
+
+        unicode_container(wchar_container& c) 
+            : container(c), lines(c.begin(), c.end(), L'\n', 1, 0)
+        {
+            detect_encoding();
+            lines = line_index<wchar_iterator>(container.begin() + bom_size, container.end(), 
+                swap_bytes ? 0x0A00 : L'\n', 1, 0);
+        }
+
+        // Returns true if the data isn't in the native byte order.
+        bool swapped() const { return swap_bytes; }
+
+        // Returns the size of the BOM, in units.
+        size_t bom_length() const { return bom_size; }
+
+        iterator begin()
+        {
+            return iterator(container.begin() + bom_size, container.end(), swap_bytes, &lines);
+        }
+
+        // Returns the position of an iterator, in units from the start of 
+        // the container.
+        size_t offset(const iterator& it)
+        {
+            return it.base() - container.begin();
+        }
+
+        // Returns an iterator to the character at the specified offset.
+        iterator at(size_t offset)
+        {
+            return iterator(container.begin() + offset, container.end(), swap_bytes, &lines);
+        }
+
+        iterator end()
+        {
+            return iterator(container.end(), container.end(), swap_bytes, &lines);
+        }
+    };
+
+    // Returns a UTF-8 encoded string
+    template <typename octet_iterator>
+    std::string get_string(unicode_iterator<octet_iterator> start, unicode_iterator<octet_iterator> end)
+    {
+        std::string ret;
+        utf8::utf32to8(start, end, std::back_inserter(ret));
+        return ret;
+    }
+
+    // Returns a UTF-16 encoded string
+    template <typename iterator_t>
+    std::wstring get_wstring(iterator_t start, iterator_t end);
 }
\ No newline at end of file
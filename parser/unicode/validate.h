@@ -0,0 +1,243 @@
+#pragma once
+
+#include <exception>
+#include <string.h>
+#include "..\simd.h"
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__)
+#define UNICODE_VALIDATE_SSSE3
+#include <tmmintrin.h>
+#if defined(_MSC_VER)
+#define UNICODE_SSSE3_TARGET
+#else
+#include <cpuid.h>
+#define UNICODE_SSSE3_TARGET __attribute__((target("ssse3")))
+#endif
+#endif
+
+namespace unicode
+{
+    // Thrown when a buffer that is supposed to hold UTF-8 data contains an
+    // invalid sequence.  The offset is relative to the start of the buffer.
+    class invalid_utf8_sequence : public std::exception
+    {
+        size_t pos;
+
+    public:
+        explicit invalid_utf8_sequence(size_t p) : pos(p) {}
+
+        virtual const char* what() const throw() { return "Invalid UTF-8 sequence"; }
+
+        size_t offset() const { return pos; }
+    };
+
+    namespace validate
+    {
+        // Checks one character at a time, starting at offset i.  Returns the
+        // offset of the first byte of the first invalid sequence, or size if
+        // the data is valid.
+        inline size_t scalar(const unsigned char* s, size_t i, size_t size)
+        {
+            while (i < size)
+            {
+                unsigned char c = s[i];
+                size_t length;
+
+                if (c < 0x80) { i++; continue; }
+                else if ((c & 0xE0) == 0xC0) { if (c < 0xC2) return i; length = 2; }
+                else if ((c & 0xF0) == 0xE0) length = 3;
+                else if ((c & 0xF8) == 0xF0) { if (c > 0xF4) return i; length = 4; }
+                else return i;
+
+                if (size - i < length) return i;
+
+                for (size_t k = 1; k < length; k++)
+                {
+                    if ((s[i + k] & 0xC0) != 0x80) return i;
+                }
+
+                // Overlong encodings, surrogates and code points beyond
+                // U+10FFFF are only detectable from the second byte.
+                if ((c == 0xE0 && s[i + 1] < 0xA0) ||
+                    (c == 0xED && s[i + 1] > 0x9F) ||
+                    (c == 0xF0 && s[i + 1] < 0x90) ||
+                    (c == 0xF4 && s[i + 1] > 0x8F))
+                    return i;
+
+                i += length;
+            }
+            return size;
+        }
+
+#if defined(UNICODE_VALIDATE_SSSE3)
+
+        inline bool has_ssse3()
+        {
+#if defined(_MSC_VER)
+            int info[4];
+            __cpuid(info, 1);
+            return (info[2] & (1 << 9)) != 0;
+#else
+            unsigned int eax, ebx, ecx, edx;
+            return __get_cpuid(1, &eax, &ebx, &ecx, &edx) && (ecx & bit_SSSE3) != 0;
+#endif
+        }
+
+        // This implements the "lookup" algorithm by Keiser and Lemire
+        // (Validating UTF-8 In Less Than One Instruction Per Byte, 2021), as
+        // used by simdjson.  Each byte is classified by three 16-entry
+        // tables, indexed by the high and low nibbles of the previous byte
+        // and the high nibble of the current one.  Each bit of the result
+        // represents an error condition, and a byte is in error if all three
+        // lookups agree.  Missing or unexpected 3rd/4th continuation bytes
+        // are checked separately.
+        struct ssse3_state
+        {
+            __m128i error;
+            __m128i prev_input;
+            __m128i prev_incomplete;
+        };
+
+        UNICODE_SSSE3_TARGET inline void ssse3_check(ssse3_state& st, __m128i input)
+        {
+            const char TOO_SHORT = 1 << 0;
+            const char TOO_LONG = 1 << 1;
+            const char OVERLONG_3 = 1 << 2;
+            const char TOO_LARGE = 1 << 3;
+            const char SURROGATE = 1 << 4;
+            const char OVERLONG_2 = 1 << 5;
+            const char TOO_LARGE_1000 = 1 << 6;
+            const char OVERLONG_4 = 1 << 6;
+            const char TWO_CONTS = (char)(1 << 7);
+            const char CARRY = TOO_SHORT | TOO_LONG | TWO_CONTS;
+
+            const __m128i nibble = _mm_set1_epi8(0x0F);
+
+            if (_mm_movemask_epi8(input) == 0)
+            {
+                // An ASCII block is only in error if the previous block
+                // ended in the middle of a character.
+                st.error = _mm_or_si128(st.error, st.prev_incomplete);
+                st.prev_input = input;
+                st.prev_incomplete = _mm_setzero_si128();
+                return;
+            }
+
+            const __m128i byte_1_high_table = _mm_setr_epi8(
+                TOO_LONG, TOO_LONG, TOO_LONG, TOO_LONG,
+                TOO_LONG, TOO_LONG, TOO_LONG, TOO_LONG,
+                TWO_CONTS, TWO_CONTS, TWO_CONTS, TWO_CONTS,
+                TOO_SHORT | OVERLONG_2,
+                TOO_SHORT,
+                TOO_SHORT | OVERLONG_3 | SURROGATE,
+                TOO_SHORT | TOO_LARGE | TOO_LARGE_1000 | OVERLONG_4);
+
+            const __m128i byte_1_low_table = _mm_setr_epi8(
+                CARRY | OVERLONG_3 | OVERLONG_2 | OVERLONG_4,
+                CARRY | OVERLONG_2,
+                CARRY,
+                CARRY,
+                CARRY | TOO_LARGE,
+                CARRY | TOO_LARGE | TOO_LARGE_1000,
+                CARRY | TOO_LARGE | TOO_LARGE_1000,
+                CARRY | TOO_LARGE | TOO_LARGE_1000,
+                CARRY | TOO_LARGE | TOO_LARGE_1000,
+                CARRY | TOO_LARGE | TOO_LARGE_1000,
+                CARRY | TOO_LARGE | TOO_LARGE_1000,
+                CARRY | TOO_LARGE | TOO_LARGE_1000,
+                CARRY | TOO_LARGE | TOO_LARGE_1000,
+                CARRY | TOO_LARGE | TOO_LARGE_1000 | SURROGATE,
+                CARRY | TOO_LARGE | TOO_LARGE_1000,
+                CARRY | TOO_LARGE | TOO_LARGE_1000);
+
+            const __m128i byte_2_high_table = _mm_setr_epi8(
+                TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT,
+                TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT,
+                TOO_LONG | OVERLONG_2 | TWO_CONTS | OVERLONG_3 | TOO_LARGE_1000 | OVERLONG_4,
+                TOO_LONG | OVERLONG_2 | TWO_CONTS | OVERLONG_3 | TOO_LARGE,
+                TOO_LONG | OVERLONG_2 | TWO_CONTS | SURROGATE | TOO_LARGE,
+                TOO_LONG | OVERLONG_2 | TWO_CONTS | SURROGATE | TOO_LARGE,
+                TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT);
+
+            __m128i prev1 = _mm_alignr_epi8(input, st.prev_input, 15);
+
+            __m128i byte_1_high = _mm_shuffle_epi8(byte_1_high_table, _mm_and_si128(_mm_srli_epi16(prev1, 4), nibble));
+            __m128i byte_1_low = _mm_shuffle_epi8(byte_1_low_table, _mm_and_si128(prev1, nibble));
+            __m128i byte_2_high = _mm_shuffle_epi8(byte_2_high_table, _mm_and_si128(_mm_srli_epi16(input, 4), nibble));
+            __m128i special = _mm_and_si128(_mm_and_si128(byte_1_high, byte_1_low), byte_2_high);
+
+            // Bytes that must be the 3rd or 4th byte of a character (only
+            // 111_____ and 1111____ leads are >= 0x80 after subtraction).
+            __m128i prev2 = _mm_alignr_epi8(input, st.prev_input, 14);
+            __m128i prev3 = _mm_alignr_epi8(input, st.prev_input, 13);
+            __m128i is_third_byte = _mm_subs_epu8(prev2, _mm_set1_epi8(0xE0 - 0x80));
+            __m128i is_fourth_byte = _mm_subs_epu8(prev3, _mm_set1_epi8(0xF0 - 0x80));
+            __m128i must23_80 = _mm_and_si128(_mm_or_si128(is_third_byte, is_fourth_byte), _mm_set1_epi8((char)0x80));
+
+            st.error = _mm_or_si128(st.error, _mm_xor_si128(must23_80, special));
+
+            // Lead bytes at the end of the block that still need
+            // continuation bytes from the next one.
+            const __m128i max_value = _mm_setr_epi8(
+                -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+                (char)(0xF0 - 1), (char)(0xE0 - 1), (char)(0xC0 - 1));
+            st.prev_incomplete = _mm_subs_epu8(input, max_value);
+            st.prev_input = input;
+        }
+
+        UNICODE_SSSE3_TARGET inline bool ssse3_failed(const ssse3_state& st)
+        {
+            return _mm_movemask_epi8(_mm_cmpeq_epi8(st.error, _mm_setzero_si128())) != 0xFFFF;
+        }
+
+        // Returns the offset of the first invalid sequence, or size.  Blocks
+        // are validated 16 bytes at a time, and when an error is found, the
+        // exact position is located by the scalar validator, starting at the
+        // last character boundary before the preceding block (which is the
+        // earliest byte that can be involved in the error).
+        UNICODE_SSSE3_TARGET inline size_t ssse3(const char* data, size_t size)
+        {
+            const unsigned char* bytes = reinterpret_cast<const unsigned char*>(data);
+
+            ssse3_state st;
+            st.error = st.prev_input = st.prev_incomplete = _mm_setzero_si128();
+
+            size_t i = 0, prev = 0;
+            for (; i + 16 <= size; prev = i, i += 16)
+            {
+                ssse3_check(st, _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i)));
+                if (ssse3_failed(st)) break;
+            }
+
+            if (!ssse3_failed(st))
+            {
+                // The tail is padded with zeros, followed by a block of zeros
+                // that catches a character that is cut off by the end of the
+                // data.
+                char tail[16] = { 0 };
+                memcpy(tail, data + i, size - i);
+                ssse3_check(st, _mm_loadu_si128(reinterpret_cast<const __m128i*>(tail)));
+                if (!ssse3_failed(st)) ssse3_check(st, _mm_setzero_si128());
+                if (!ssse3_failed(st)) return size;
+            }
+
+            while (prev > 0 && (bytes[prev] & 0xC0) == 0x80) prev--;
+            return scalar(bytes, prev, size);
+        }
+
+#endif
+    }
+
+    // Validates a buffer of UTF-8 data, returning the offset of the first
+    // byte of the first invalid sequence, or size if the data is valid.
+    // Overlong forms, surrogates, code points above U+10FFFF and truncated
+    // sequences are all treated as invalid.
+    inline size_t validate_utf8(const char* data, size_t size)
+    {
+#if defined(UNICODE_VALIDATE_SSSE3)
+        static const bool use_ssse3 = validate::has_ssse3();
+        if (use_ssse3) return validate::ssse3(data, size);
+#endif
+        return validate::scalar(reinterpret_cast<const unsigned char*>(data), 0, size);
+    }
+}
\ No newline at end of file
@@ -0,0 +1,407 @@
+#pragma once
+
+#include <assert.h>
+#include <stdint.h>
+#include <string.h>
+#include <exception>
+#include <functional>
+#include <string>
+#include <vector>
+#include "unicode\unicode.h"
+#include "grammar.h"
+#include "name_table.h"
+#include "simd.h"
+#include "string_view.h"
+#include "tree.h"
+
+namespace xml
+{
+    // This class writes UTF-8 XML into a buffer, one piece at a time (start
+    // tags, attributes, text, etc.), taking care of escaping and of closing
+    // tags.  The buffer is either:
+    //
+    //   - owned by the writer, and grows as needed (writer()),
+    //   - provided by the caller (writer(buffer, size)), in which case
+    //     writing more than fits throws, unless there's also a sink, or
+    //   - owned by the writer, with a fixed size, and passed to a sink (a
+    //     function that receives the bytes) whenever it fills up
+    //     (writer(sink)).
+    //
+    // When there's a sink, flush() must be called after the last write.
+    // Strings can be given as util::string_view's (e.g., names from a
+    // name_table), std::string's, or match_strings, whose bytes are copied
+    // directly when they're UTF-8 in memory.
+    class writer
+    {
+    public:
+        typedef std::function<void(const char*, size_t)> sink_type;
+
+    private:
+        std::vector<char> storage;
+        char* buffer;
+        size_t capacity;
+        size_t used;
+        bool growable;
+        sink_type sink;
+
+        // True after start_element(), until the start tag's '>' has been
+        // written (so that attributes can still be added).
+        bool tag_open;
+
+        // The names of the open elements, stored back to back.
+        std::vector<char> names;
+        std::vector<size_t> name_offsets;
+
+        writer(const writer&);
+        writer& operator= (const writer&);
+
+        void reserve(size_t n)
+        {
+            if (sink)
+            {
+                drain();
+                return;
+            }
+
+            if (!growable) throw std::exception("The writer's buffer is full");
+
+            size_t size = capacity * 2 > used + n ? capacity * 2 : used + n;
+            storage.resize(size);
+            buffer = storage.data();
+            capacity = size;
+        }
+
+        void drain()
+        {
+            if (used == 0) return;
+
+            sink(buffer, used);
+            used = 0;
+        }
+
+        void put(const char* p, size_t n)
+        {
+            // Empty strings (e.g., default string_views) may have no data.
+            if (n == 0) return;
+
+            if (capacity - used < n)
+            {
+                reserve(n);
+
+                // Data larger than the whole buffer goes straight to the sink.
+                if (capacity - used < n)
+                {
+                    sink(p, n);
+                    return;
+                }
+            }
+
+            memcpy(buffer + used, p, n);
+            used += n;
+        }
+
+        void put(const util::string_view& s) { put(s.data(), s.size()); }
+
+        void put(char c)
+        {
+            if (used == capacity) reserve(1);
+            buffer[used++] = c;
+        }
+
+        // Writes a string, replacing the characters that can't appear in
+        // text or attribute values with references.
+        void escape(const util::string_view& s)
+        {
+            const char* p = s.begin();
+            const char* end = s.end();
+            while (p != end)
+            {
+                const char* next = util::simd::find_any(p, end, '<', '>', '&', '"', '\'');
+                put(p, next - p);
+                if (next == end) break;
+
+                switch (*next)
+                {
+                case '<': put("&lt;", 4); break;
+                case '>': put("&gt;", 4); break;
+                case '&': put("&amp;", 5); break;
+                case '"': put("&quot;", 6); break;
+                default: put("&apos;", 6); break;
+                }
+                p = next + 1;
+            }
+        }
+
+        void close_tag()
+        {
+            if (tag_open)
+            {
+                put('>');
+                tag_open = false;
+            }
+        }
+
+        static util::string_view view(const util::string_view& s, std::string&)
+        {
+            return s;
+        }
+
+        template <typename iterator_t>
+        static util::string_view view(const match_string<iterator_t>& s, std::string& temp)
+        {
+            if (s.has_bytes()) return s.bytes();
+            temp = s.str();
+            return util::string_view(temp);
+        }
+
+        // Converts a string from a document (i.e., UTF-8) to ISO-8859-1, to 
+        // write it into an ISO-8859-1 source.  The characters that can't be 
+        // represented are written as character references, which is only 
+        // possible in attribute values and text, so names that have any 
+        // throw std::exception.
+        static util::string_view to_latin1(const util::string_view& s, bool is_name, std::string& temp)
+        {
+            if (util::simd::is_ascii(s.begin(), s.end())) return s;
+
+            static const char digits[] = "0123456789ABCDEF";
+            temp.clear();
+            for (const char* it = s.begin(); it != s.end(); )
+            {
+                uint32_t c = utf8::unchecked::next(it);
+                if (c < 0x100)
+                {
+                    temp.push_back(static_cast<char>(c));
+                    continue;
+                }
+
+                if (is_name) throw std::exception("The name can't be written in ISO-8859-1");
+
+                temp.append("&#x");
+                int shift = 20;
+                while (shift > 0 && (c >> shift) == 0) shift -= 4;
+                for (; shift >= 0; shift -= 4) temp.push_back(digits[(c >> shift) & 0xF]);
+                temp.push_back(';');
+            }
+            return util::string_view(temp);
+        }
+
+        // Writes an attribute whose value is already escaped, quoting it with
+        // apostrophes if it contains quotes (e.g., if it was quoted with
+        // apostrophes in the source).
+        void raw_attribute(const util::string_view& name, const util::string_view& value)
+        {
+            char quote = util::simd::find(value.begin(), value.end(), '"') == value.end() ? '"' : '\'';
+            put(' ');
+            put(name);
+            put('=');
+            put(quote);
+            put(value);
+            put(quote);
+        }
+
+    public:
+        writer()
+            : storage(4096), buffer(storage.data()), capacity(storage.size()), used(0), growable(true), tag_open(false)
+        {
+        }
+
+        writer(char* buf, size_t size, const sink_type& s = sink_type())
+            : buffer(buf), capacity(size), used(0), growable(false), sink(s), tag_open(false)
+        {
+        }
+
+        explicit writer(const sink_type& s, size_t buffer_size = 64 * 1024)
+            : storage(buffer_size), buffer(storage.data()), capacity(buffer_size), used(0), growable(false), sink(s), tag_open(false)
+        {
+        }
+
+        void declaration()
+        {
+            put("<?xml version=\"1.0\" encoding=\"UTF-8\"?>", 38);
+        }
+
+        template <typename string_t>
+        void start_element(const string_t& name)
+        {
+            std::string temp;
+            util::string_view n = view(name, temp);
+
+            close_tag();
+            put('<');
+            put(n);
+            tag_open = true;
+
+            name_offsets.push_back(names.size());
+            names.insert(names.end(), n.begin(), n.end());
+        }
+
+        void start_element(const name_table& table, name_id id)
+        {
+            start_element(table.name(id));
+        }
+
+        // Adds an attribute to the element that was just started (i.e.,
+        // before any content has been written).  The value is escaped.
+        template <typename name_t, typename value_t>
+        void attribute(const name_t& name, const value_t& value)
+        {
+            assert(tag_open);
+
+            std::string temp;
+            put(' ');
+            put(view(name, temp));
+            put("=\"", 2);
+            escape(view(value, temp));
+            put('"');
+        }
+
+        template <typename value_t>
+        void attribute(const name_table& table, name_id id, const value_t& value)
+        {
+            attribute(table.name(id), value);
+        }
+
+        // Writes text, which is escaped.
+        template <typename string_t>
+        void text(const string_t& value)
+        {
+            std::string temp;
+            close_tag();
+            escape(view(value, temp));
+        }
+
+        template <typename string_t>
+        void comment(const string_t& value)
+        {
+            std::string temp;
+            close_tag();
+            put("<!--", 4);
+            put(view(value, temp));
+            put("-->", 3);
+        }
+
+        // Writes markup or text that is already escaped, as it is.
+        template <typename string_t>
+        void raw(const string_t& value)
+        {
+            std::string temp;
+            close_tag();
+            put(view(value, temp));
+        }
+
+        // Ends the innermost open element, with "/>" if it has no content.
+        void end_element()
+        {
+            assert(!name_offsets.empty());
+
+            size_t offset = name_offsets.back();
+            if (tag_open)
+            {
+                put("/>", 2);
+                tag_open = false;
+            }
+            else
+            {
+                put("</", 2);
+                put(&names[offset], names.size() - offset);
+                put('>');
+            }
+
+            names.resize(offset);
+            name_offsets.pop_back();
+        }
+
+        // Writes an element of a document, with its attributes and content.
+        // The parser doesn't replace references, so the text and attribute
+        // values in a document are still escaped, and are copied as they
+        // are.
+        void write(const tree::element& e)
+        {
+            start_element(e.name());
+            for (auto a : e.attributes()) raw_attribute(a.name(), a.value());
+
+            for (auto n : e.nodes())
+            {
+                if (n.is_text())
+                    raw(n.text());
+                else
+                    write(n.element());
+            }
+            end_element();
+        }
+
+        // Writes a document that was loaded with tree::load_spans, given 
+        // its source (i.e., the whole container it was loaded from).  The 
+        // parts of the source that weren't edited (see tree::document's 
+        // set_attribute(), etc.), including the prolog, comments and 
+        // formatting, are copied as they are, and only the start tags of 
+        // edited elements and edited text nodes are written from the 
+        // document.  With a sink, unchanged ranges that are larger than the 
+        // buffer are passed to it directly, rather than through the buffer.  
+        // The output is in the encoding of the source (for an ISO-8859-1 
+        // source, see to_latin1()).
+        void write(const tree::document& doc, const util::string_view& source)
+        {
+            if (!doc.has_sources()) throw std::exception("The document wasn't loaded with load_spans");
+
+            bool latin1 = doc.has_latin1_source();
+            std::string temp, temp_value;
+            auto encode = [&](const util::string_view& s, bool is_name, std::string& t) {
+                return latin1 ? to_latin1(s, is_name, t) : s;
+            };
+
+            close_tag();
+            size_t pos = 0;
+            for (auto index : doc.dirty_nodes())
+            {
+                tree::source_span s = doc.node_source(index);
+                assert(s.first >= pos && s.last <= source.size());
+                put(source.data() + pos, s.first - pos);
+                pos = s.last;
+
+                tree::node n(&doc, index);
+                if (n.is_text())
+                {
+                    put(encode(n.text(), false, temp));
+                    continue;
+                }
+
+                // The '>' or '/>' (and the whitespace before it) is copied 
+                // from the source, as are the attributes that didn't change.
+                tree::element e = n.element();
+                put('<');
+                put(encode(e.name(), true, temp));
+                for (auto a : e.attributes())
+                {
+                    tree::source_span as = doc.attribute_source(index, a.get_index());
+                    if (as.first == tree::no_source)
+                        raw_attribute(encode(a.name(), true, temp), encode(a.value(), false, temp_value));
+                    else
+                        put(source.data() + as.first, as.last - as.first);
+                }
+            }
+            put(source.data() + pos, source.size() - pos);
+        }
+
+        // Passes the buffered data to the sink, if there is one.
+        void flush()
+        {
+            close_tag();
+            if (sink) drain();
+        }
+
+        // The data in the buffer (i.e., all of it, if there's no sink).
+        const char* data() const { return buffer; }
+        size_t size() const { return used; }
+        std::string str() const { return std::string(buffer, used); }
+
+        // Discards the data in the buffer (e.g., to reuse the writer).
+        void clear()
+        {
+            used = 0;
+            tag_open = false;
+            names.clear();
+            name_offsets.clear();
+        }
+    };
+}
\ No newline at end of file
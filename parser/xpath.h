@@ -0,0 +1,447 @@
+#pragma once
+
+#include <assert.h>
+#include <stdint.h>
+#include <algorithm>
+#include <exception>
+#include <string>
+#include <vector>
+#include "name_table.h"
+#include "string_view.h"
+#include "tree.h"
+
+namespace xml
+{
+    // This namespace contains a small subset of XPath, for finding elements
+    // and attributes in an xml::tree::document.  A query is compiled once,
+    // against a name_table, and can then be evaluated any number of times
+    // against documents that use that table.  The supported syntax is:
+    //
+    //   path      := ('/' | '//')? step (('/' | '//') step)*
+    //   step      := nametest predicate* | '@' nametest
+    //   nametest  := name | '*'
+    //   predicate := '[' '@' name ('=' literal)? ']'
+    //
+    // where literal is a single- or double-quoted string, and an attribute
+    // step may only be the last one.  For example:
+    //
+    //   //event[@label='CDMA_L3_PDU_TO_L2']/@msgtype
+    //
+    // Names are resolved to name_id's when the query is compiled, so
+    // matching elements and attributes only compares integers (predicates
+    // with a literal also compare the attribute's value).
+    //
+    // In documents loaded with tree::load_shared, an element is returned 
+    // once for each place where it occurs (the occurrences are the same 
+    // element, and share its index), in document order.
+    namespace xpath
+    {
+        // Thrown by query's constructor if the path isn't in the supported
+        // subset.  The offset is that of the character that couldn't be
+        // parsed.
+        class syntax_error : public std::exception
+        {
+            size_t pos;
+
+        public:
+            explicit syntax_error(size_t p) : pos(p) {}
+
+            virtual const char* what() const throw() { return "Invalid or unsupported XPath expression"; }
+
+            size_t offset() const { return pos; }
+        };
+
+        class query
+        {
+        public:
+            // An attribute test, i.e., [@name] or [@name='value'].
+            struct predicate
+            {
+                name_id name;
+                bool has_value;
+                std::string value;
+            };
+
+            struct step
+            {
+                // True for '//' (descendant-or-self) rather than '/'.
+                bool descendant;
+
+                // True for an attribute step ('@').
+                bool attribute;
+
+                // True for '*', in which case 'name' isn't used.
+                bool any;
+
+                name_id name;
+                std::vector<predicate> predicates;
+            };
+
+        private:
+            const name_table* table;
+            bool absolute;
+            std::vector<step> steps;
+
+            static bool is_name_char(char c)
+            {
+                return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') ||
+                    c == '.' || c == '-' || c == '_' || c == ':' || (c & 0x80) != 0;
+            }
+
+            // This class parses a path, appending its steps to the query.
+            class compiler
+            {
+                query& q;
+                name_table& names;
+                const char* first;
+                const char* p;
+                const char* end;
+
+                void fail() { throw syntax_error(p - first); }
+
+                bool next_is(char c) const { return p != end && *p == c; }
+
+                void expect(char c)
+                {
+                    if (!next_is(c)) fail();
+                    ++p;
+                }
+
+                void skip_ws()
+                {
+                    while (p != end && (*p == ' ' || *p == '\t' || *p == '\r' || *p == '\n')) ++p;
+                }
+
+                name_id parse_name()
+                {
+                    const char* start = p;
+                    while (p != end && is_name_char(*p)) ++p;
+                    if (p == start) fail();
+                    return names.intern(util::string_view(start, p - start));
+                }
+
+                void parse_nametest(step& s)
+                {
+                    s.any = next_is('*');
+                    if (s.any)
+                    {
+                        ++p;
+                        s.name = no_name;
+                    }
+                    else
+                    {
+                        s.name = parse_name();
+                    }
+                }
+
+                void parse_predicate(step& s)
+                {
+                    predicate pred;
+                    expect('[');
+                    skip_ws();
+                    expect('@');
+                    pred.name = parse_name();
+                    skip_ws();
+
+                    pred.has_value = next_is('=');
+                    if (pred.has_value)
+                    {
+                        ++p;
+                        skip_ws();
+                        if (!next_is('\'') && !next_is('"')) fail();
+
+                        char quote = *p++;
+                        const char* start = p;
+                        while (p != end && *p != quote) ++p;
+                        if (p == end) fail();
+                        pred.value.assign(start, p - start);
+                        ++p;
+                        skip_ws();
+                    }
+
+                    expect(']');
+                    s.predicates.push_back(pred);
+                }
+
+                void parse_step(bool descendant)
+                {
+                    step s;
+                    s.descendant = descendant;
+                    s.attribute = next_is('@');
+                    if (s.attribute) ++p;
+
+                    parse_nametest(s);
+                    while (!s.attribute && next_is('[')) parse_predicate(s);
+
+                    q.steps.push_back(s);
+                }
+
+                // Parses a '/' or '//' separator, and returns true for '//'.
+                bool parse_separator()
+                {
+                    expect('/');
+                    if (!next_is('/')) return false;
+                    ++p;
+                    return true;
+                }
+
+            public:
+                compiler(query& qry, name_table& t, const util::string_view& path)
+                    : q(qry), names(t), first(path.data()), p(path.data()), end(path.data() + path.size())
+                {
+                }
+
+                void compile()
+                {
+                    q.absolute = next_is('/');
+                    parse_step(q.absolute ? parse_separator() : false);
+
+                    while (p != end)
+                    {
+                        // Only the last step can select attributes.
+                        if (q.steps.back().attribute) fail();
+                        parse_step(parse_separator());
+                    }
+                }
+            };
+
+            static bool matches(const tree::element& e, const step& s)
+            {
+                if (!s.any && e.id() != s.name) return false;
+
+                for (auto& p : s.predicates)
+                {
+                    if (!e.has_attribute(p.name)) return false;
+                    if (p.has_value && e.attribute(p.name) != util::string_view(p.value)) return false;
+                }
+                return true;
+            }
+
+            // An element, and where it occurs.  In a shared document (see 
+            // tree::load_shared), a repeated subtree is stored once, so its 
+            // elements occur in several places, and can't be told apart (or 
+            // ordered) by index.  An occurrence is identified by its path 
+            // instead: the element's position among its parent's child 
+            // elements, and that of each of its ancestors, from the context 
+            // of the query down.  Comparing paths also gives document order.  
+            // In other documents, the paths are left empty.
+            struct occurrence
+            {
+                tree::element e;
+                std::vector<uint32_t> path;
+            };
+
+            typedef std::vector<occurrence> occurrences;
+
+            static occurrence child_of(const occurrence& parent, const tree::element& child, uint32_t position)
+            {
+                occurrence o;
+                o.e = child;
+                if (child.get_document()->is_shared())
+                {
+                    o.path = parent.path;
+                    o.path.push_back(position);
+                }
+                return o;
+            }
+
+            static bool is_before(const occurrence& a, const occurrence& b) { return a.e.get_index() < b.e.get_index(); }
+            static bool is_same(const occurrence& a, const occurrence& b) { return a.e.get_index() == b.e.get_index(); }
+            static bool is_before_path(const occurrence& a, const occurrence& b) { return a.path < b.path; }
+            static bool is_same_path(const occurrence& a, const occurrence& b) { return a.path == b.path; }
+
+            // Sorts a set of elements into document order, and removes 
+            // duplicates (i.e., repeated occurrences).
+            static void remove_duplicates(occurrences& found)
+            {
+                if (found.empty()) return;
+
+                if (found.front().e.get_document()->is_shared())
+                {
+                    std::sort(found.begin(), found.end(), is_before_path);
+                    found.erase(std::unique(found.begin(), found.end(), is_same_path), found.end());
+                }
+                else
+                {
+                    std::sort(found.begin(), found.end(), is_before);
+                    found.erase(std::unique(found.begin(), found.end(), is_same), found.end());
+                }
+            }
+
+            // Appends the descendants of an element that match a step.
+            static void add_descendants(const occurrence& o, const step& s, occurrences& out)
+            {
+                uint32_t position = 0;
+                for (auto child : o.e.elements())
+                {
+                    occurrence c = child_of(o, child, position++);
+                    if (matches(child, s)) out.push_back(c);
+                    add_descendants(c, s, out);
+                }
+            }
+
+            // Appends an element and its descendants, regardless of names.
+            static void add_self_and_descendants(const occurrence& o, occurrences& out)
+            {
+                out.push_back(o);
+
+                uint32_t position = 0;
+                for (auto child : o.e.elements()) add_self_and_descendants(child_of(o, child, position++), out);
+            }
+
+            // Applies an element step to a set of elements.  The result is
+            // sorted in document order (by node index, for documents that 
+            // aren't shared, which is document order unless they were 
+            // loaded lazily) and has no duplicates.
+            static occurrences apply(const occurrences& context, const step& s)
+            {
+                occurrences result;
+                for (auto& o : context)
+                {
+                    if (s.descendant)
+                    {
+                        add_descendants(o, s, result);
+                    }
+                    else
+                    {
+                        uint32_t position = 0;
+                        for (auto child : o.e.elements())
+                        {
+                            if (matches(child, s)) result.push_back(child_of(o, child, position));
+                            position++;
+                        }
+                    }
+                }
+
+                // Nested context elements can have descendants in common.
+                if (s.descendant && context.size() > 1) remove_duplicates(result);
+                return result;
+            }
+
+            // Evaluates the element steps (i.e., all but an attribute step)
+            // from a set of elements.
+            occurrences evaluate(occurrences context, size_t first_step) const
+            {
+                size_t count = selects_attributes() ? steps.size() - 1 : steps.size();
+                for (size_t i = first_step; i < count && !context.empty(); i++)
+                {
+                    context = apply(context, steps[i]);
+                }
+                return context;
+            }
+
+            // Evaluates the element steps of an absolute path, for which the
+            // first step is applied to the document as a whole (i.e., the
+            // parent of the root element).
+            occurrences evaluate(const tree::document& doc) const
+            {
+                assert(absolute);
+                assert(&doc.names() == table);
+
+                occurrences context;
+                occurrence root;
+                root.e = doc.root();
+                if (!root.e) return context;
+
+                const step& s = steps[0];
+                if (s.attribute)
+                {
+                    if (s.descendant) add_self_and_descendants(root, context);
+                    return context;
+                }
+
+                if (matches(root.e, s)) context.push_back(root);
+                if (s.descendant) add_descendants(root, s, context);
+                return evaluate(context, 1);
+            }
+
+            static occurrences start(const tree::element& context)
+            {
+                occurrence o;
+                o.e = context;
+                return occurrences(1, o);
+            }
+
+            static std::vector<tree::element> elements_of(const occurrences& found)
+            {
+                std::vector<tree::element> result;
+                result.reserve(found.size());
+                for (auto& o : found) result.push_back(o.e);
+                return result;
+            }
+
+            std::vector<tree::attribute> attributes_of(const occurrences& elements, bool descendants) const
+            {
+                const step& s = steps.back();
+                occurrences owners;
+                if (descendants)
+                {
+                    for (auto& o : elements) add_self_and_descendants(o, owners);
+                    remove_duplicates(owners);
+                }
+
+                std::vector<tree::attribute> result;
+                for (auto& o : descendants ? owners : elements)
+                {
+                    for (auto a : o.e.attributes())
+                    {
+                        if (s.any || a.id() == s.name) result.push_back(a);
+                    }
+                }
+                return result;
+            }
+
+        public:
+            // Compiles a path.  Names that aren't in the table yet are added
+            // to it, so the query also works with documents loaded later.
+            query(const util::string_view& path, name_table& names)
+                : table(&names), absolute(false)
+            {
+                compiler(*this, names, path).compile();
+            }
+
+            bool is_absolute() const { return absolute; }
+
+            // Returns the compiled steps (e.g., for xml::projection).
+            const std::vector<step>& get_steps() const { return steps; }
+
+            // Returns true if the path ends with an attribute step, in which
+            // case the query's results are returned by select_attributes().
+            bool selects_attributes() const { return steps.back().attribute; }
+
+            // Returns the elements selected by an absolute path.  The
+            // document must use the name_table the query was compiled with.
+            std::vector<tree::element> select(const tree::document& doc) const
+            {
+                assert(!selects_attributes());
+                return elements_of(evaluate(doc));
+            }
+
+            // Returns the elements selected by a relative path, starting at
+            // the specified element.
+            std::vector<tree::element> select(const tree::element& context) const
+            {
+                assert(!absolute && !selects_attributes());
+                return elements_of(evaluate(start(context), 0));
+            }
+
+            // Returns the attributes selected by an absolute path.
+            std::vector<tree::attribute> select_attributes(const tree::document& doc) const
+            {
+                assert(selects_attributes());
+
+                // For "//@name", evaluate() already returns every element.
+                if (steps.size() == 1) return attributes_of(evaluate(doc), false);
+                return attributes_of(evaluate(doc), steps.back().descendant);
+            }
+
+            // Returns the attributes selected by a relative path, starting
+            // at the specified element.
+            std::vector<tree::attribute> select_attributes(const tree::element& context) const
+            {
+                assert(!absolute && selects_attributes());
+                return attributes_of(evaluate(start(context), 0), steps.back().descendant);
+            }
+        };
+    }
+}
\ No newline at end of file